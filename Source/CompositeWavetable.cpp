@@ -0,0 +1,261 @@
+/*
+  ==============================================================================
+
+    CompositeWavetable.cpp
+    Created: 24 Oct 2026 11:06:02am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "CompositeWavetable.h"
+#include "PartialOscillator.h"
+
+namespace
+{
+    //Bits of each field of the key
+    constexpr int denominatorBits = 5;
+    constexpr int harmonicBits = 8;
+    constexpr int waveTypeBits = 2;
+
+    static_assert(CompositeWavetable::maxDenominator < (1 << denominatorBits), "The denominator must fit in its bits");
+    static_assert(CompositeWavetable::maxHarmonic < (1 << harmonicBits), "The harmonics must fit in their bits");
+    static_assert(denominatorBits + CompositeWavetable::numPartials * (harmonicBits + waveTypeBits) <= 64, "The settings must fit in the key");
+
+    constexpr int tableSize = Wavetable::frameSize;
+
+    //A sine partial of the mix
+    struct Component
+    {
+        int harmonic;
+        float amplitude;
+    };
+
+    //The oscillators are all -sum(a_k sin(2 pi k phase)) (sine: a_1 = 1, saw: 2 / (pi k), square: 4 / (pi k) for odd k),
+    //so the mix is a sum of sines of the base phase
+    std::vector<Component> getComponents(const CompositeWavetable::Settings& settings)
+    {
+        std::vector<Component> components;
+
+        for (int i = 0; i < CompositeWavetable::numPartials; ++i)
+        {
+            auto gain = CompositeWavetable::getPartialGain(i);
+            auto harmonic = settings.harmonics[(size_t)i];
+            auto waveType = settings.waveTypes[(size_t)i];
+
+            for (int k = 1; k * harmonic <= tableSize / 2; ++k)
+            {
+                float amplitude = 0.0f;
+
+                if (waveType == PartialOscillator::saw)
+                    amplitude = 2.0f / (juce::MathConstants<float>::pi * (float)k);
+                else if (waveType == PartialOscillator::square)
+                    amplitude = k % 2 == 1 ? 4.0f / (juce::MathConstants<float>::pi * (float)k) : 0.0f;
+                else if (k == 1)
+                    amplitude = 1.0f;
+                else
+                    break;
+
+                if (amplitude != 0.0f)
+                    components.push_back({ k * harmonic, -gain * amplitude });
+            }
+        }
+
+        std::sort(components.begin(), components.end(), [](const Component& a, const Component& b) { return a.harmonic < b.harmonic; });
+        return components;
+    }
+
+    //Same layout as a single frame Wavetable: numMipLevels cycles, level n keeps tableSize / 2 >> n harmonics
+    void renderMips(const CompositeWavetable::Settings& settings, float* mips)
+    {
+        std::vector<float> sine((size_t)tableSize);
+
+        for (size_t i = 0; i < sine.size(); ++i)
+            sine[i] = (float)std::sin(juce::MathConstants<double>::twoPi * (double)i / tableSize);
+
+        auto components = getComponents(settings);
+
+        //From the level with the fewest harmonics up: each level adds its components to the previous one
+        std::vector<float> cycle((size_t)tableSize, 0.0f);
+        size_t next = 0;
+
+        for (int level = Wavetable::numMipLevels - 1; level >= 0; --level)
+        {
+            auto maxHarmonic = (tableSize / 2) >> level;
+
+            for (; next < components.size() && components[next].harmonic <= maxHarmonic; ++next)
+            {
+                auto harmonic = components[next].harmonic;
+                auto amplitude = components[next].amplitude;
+
+                for (int t = 0; t < tableSize; ++t)
+                    cycle[(size_t)t] += amplitude * sine[(size_t)((harmonic * t) & (tableSize - 1))];
+            }
+
+            std::copy(cycle.begin(), cycle.end(), mips + (size_t)level * tableSize);
+        }
+    }
+}
+
+//==============================================================================
+juce::uint64 CompositeWavetable::Settings::getKey() const noexcept
+{
+    if (!isValid())
+        return 0;
+
+    auto key = (juce::uint64)denominator;
+    auto shift = denominatorBits;
+
+    for (size_t i = 0; i < numPartials; ++i)
+    {
+        key |= (juce::uint64)harmonics[i] << shift;
+        shift += harmonicBits;
+
+        key |= (juce::uint64)waveTypes[i] << shift;
+        shift += waveTypeBits;
+    }
+
+    return key;
+}
+
+CompositeWavetable::Settings CompositeWavetable::Settings::fromKey(juce::uint64 key) noexcept
+{
+    Settings settings;
+    settings.denominator = (int)(key & ((1 << denominatorBits) - 1));
+    auto shift = denominatorBits;
+
+    for (size_t i = 0; i < numPartials; ++i)
+    {
+        settings.harmonics[i] = (int)((key >> shift) & ((1 << harmonicBits) - 1));
+        shift += harmonicBits;
+
+        settings.waveTypes[i] = (int)((key >> shift) & ((1 << waveTypeBits) - 1));
+        shift += waveTypeBits;
+    }
+
+    return settings;
+}
+
+CompositeWavetable::Settings CompositeWavetable::findSettings(const std::vector<double>& detunes, const std::array<int, numPartials>& waveTypes) noexcept
+{
+    Settings settings;
+
+    if (detunes.size() < (size_t)numPartials)
+        return settings;
+
+    for (auto waveType : waveTypes)
+    {
+        if (waveType < PartialOscillator::sine || waveType > PartialOscillator::square)
+            return settings;
+    }
+
+    auto maxRatio = std::exp2(maxDetuneError / 1200.0);
+
+    for (int denominator = 1; denominator <= maxDenominator; ++denominator)
+    {
+        bool found = true;
+
+        for (size_t i = 0; i < numPartials && found; ++i)
+        {
+            auto position = detunes[i] * denominator;
+            auto harmonic = juce::roundToInt(position);
+
+            found = harmonic >= 1 && harmonic <= maxHarmonic
+                && position <= harmonic * maxRatio && position >= harmonic / maxRatio;
+
+            settings.harmonics[i] = harmonic;
+        }
+
+        if (found)
+        {
+            settings.denominator = denominator;
+            settings.waveTypes = waveTypes;
+            return settings;
+        }
+    }
+
+    return {};
+}
+
+const Wavetable* CompositeWavetable::getTable(const Settings& settings) noexcept
+{
+    if ((middle.load(std::memory_order_acquire) & freshFlag) != 0)
+        front = middle.exchange(front, std::memory_order_acq_rel) & ~freshFlag;
+
+    auto& entry = entries[(size_t)front];
+
+    return entry.table != nullptr && entry.key == settings.getKey() ? entry.table.get() : nullptr;
+}
+
+bool CompositeWavetable::renderRequest()
+{
+    auto key = requestedKey.load(std::memory_order_acquire);
+
+    if (key == 0 || key == renderedKey)
+        return false;
+
+    //Nobody else touches the back entry, the audio thread only sees it once it is published
+    auto& entry = entries[(size_t)back];
+
+    if (entry.mips.empty())
+    {
+        entry.mips.resize((size_t)Wavetable::numMipLevels * tableSize);
+        allocatedBytes += entry.mips.size() * sizeof(float) + sizeof(Wavetable);
+    }
+
+    renderMips(Settings::fromKey(key), entry.mips.data());
+
+    entry.table = std::make_unique<Wavetable>("Composite", nullptr, entry.mips.data(), 1);
+    entry.key = key;
+
+    back = middle.exchange(back | freshFlag, std::memory_order_acq_rel) & ~freshFlag;
+    renderedKey = key;
+
+    return true;
+}
+
+size_t CompositeWavetable::getSizeInBytes() const
+{
+    return sizeof(*this) + allocatedBytes.load(std::memory_order_relaxed);
+}
+
+//==============================================================================
+CompositeWavetableRenderer::CompositeWavetableRenderer() : juce::Thread("Composite wavetable renderer")
+{
+}
+
+CompositeWavetableRenderer::~CompositeWavetableRenderer()
+{
+    stop();
+}
+
+void CompositeWavetableRenderer::start()
+{
+    if (!isThreadRunning())
+        startThread(3); //below normal, a note only waits for its table by playing additively
+}
+
+void CompositeWavetableRenderer::stop()
+{
+    stopThread(2000);
+}
+
+void CompositeWavetableRenderer::run()
+{
+    while (!threadShouldExit())
+    {
+        bool rendered = false;
+
+        for (auto* table : tables)
+        {
+            if (threadShouldExit())
+                return;
+
+            rendered |= table->renderRequest();
+        }
+
+        //The requests are polled, the audio thread never signals anything
+        if (!rendered)
+            wait(20);
+    }
+}
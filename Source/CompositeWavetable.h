@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    CompositeWavetable.h
+    Created: 24 Oct 2026 11:05:41am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "WavetableLibrary.h"
+
+//Single cycle of the mix of the four partials of a voice, band-limited with the same mip levels as the wavetables.
+//It exists when the detunes are (close to) whole harmonics of a common base frequency, note / denominator:
+//a voice then plays the whole mix with one table read per sample instead of four oscillators, and the tremolo
+//is applied after.
+//Each part has one. The audio thread asks for the table of the current settings and a background thread renders
+//it: the tables go through a triple buffer, so the audio thread never waits and never frees anything.
+class CompositeWavetable
+{
+public:
+
+    static constexpr int numPartials = 4;
+
+    //The base frequency goes down to note / maxDenominator, the partials up to maxHarmonic times the base
+    static constexpr int maxDenominator = 16;
+    static constexpr int maxHarmonic = 255;
+
+    //Max distance of a detune from its harmonic, in cents
+    static constexpr double maxDetuneError = 2.0;
+
+    //Weight of each partial in the mix (the fixed gains of the voices)
+    static float getPartialGain(int partial) noexcept { return 0.5f / (float)(partial + 1); }
+
+    //Everything a table depends on, packed in 64 bits so that it can go through an atomic (key 0: no table)
+    struct Settings
+    {
+        int denominator = 0;
+        std::array<int, numPartials> harmonics{}; //of the base frequency, the first one is the denominator
+        std::array<int, numPartials> waveTypes{}; //PartialOscillator::WaveType, no wavetables
+
+        bool isValid() const noexcept { return denominator > 0; }
+
+        juce::uint64 getKey() const noexcept;
+        static Settings fromKey(juce::uint64 key) noexcept;
+    };
+
+    //Smallest denominator that turns all the detunes into whole harmonics (invalid settings if there isn't one,
+    //or if a partial plays a wavetable)
+    static Settings findSettings(const std::vector<double>& detunes, const std::array<int, numPartials>& waveTypes) noexcept;
+
+    CompositeWavetable() = default;
+
+    //Audio thread: asks for the table of these settings (only the last request is rendered)
+    void request(const Settings& settings) noexcept { requestedKey.store(settings.getKey(), std::memory_order_release); }
+
+    //Audio thread: the latest table, if it was rendered for these settings (nullptr otherwise)
+    const Wavetable* getTable(const Settings& settings) noexcept;
+
+    //Renderer thread: renders the table of the last request if it is new, returns true if it did
+    bool renderRequest();
+
+    size_t getSizeInBytes() const;
+
+private:
+
+    struct Entry
+    {
+        juce::uint64 key = 0;
+        std::vector<float> mips;
+        std::unique_ptr<Wavetable> table;
+    };
+
+    //Triple buffer: the audio thread reads entries[front], the renderer writes entries[back],
+    //middle holds the last published entry (with freshFlag until the audio thread takes it)
+    std::array<Entry, 3> entries;
+    std::atomic<int> middle{ 1 };
+    int front = 0;
+    int back = 2;
+
+    static constexpr int freshFlag = 4;
+
+    std::atomic<juce::uint64> requestedKey{ 0 };
+    juce::uint64 renderedKey = 0; //renderer thread
+
+    std::atomic<size_t> allocatedBytes{ 0 }; //for the memory report
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CompositeWavetable)
+};
+
+//Background thread that renders the composite tables requested by the parts of a plugin instance
+class CompositeWavetableRenderer : private juce::Thread
+{
+public:
+
+    CompositeWavetableRenderer();
+    ~CompositeWavetableRenderer() override;
+
+    //Before start
+    void addTable(CompositeWavetable* table) { tables.add(table); }
+
+    //Starts the thread if it is not running
+    void start();
+    void stop();
+
+private:
+
+    void run() override;
+
+    juce::Array<CompositeWavetable*> tables;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CompositeWavetableRenderer)
+};
@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    CpuGovernor.cpp
+    Created: 19 Oct 2026 3:40:31pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "CpuGovernor.h"
+#include "PartialOscillator.h"
+
+CpuGovernor::Quality CpuGovernor::getQuality(int level) noexcept
+{
+    //Ordered from the least to the most audible saving
+    Quality quality;
+
+    if (level >= 1)
+        quality.stealReleasedVoices = true;
+
+    if (level >= 2)
+        quality.lfoUpdateInterval = 400;
+
+    if (level >= 3)
+        quality.minSineTier = PartialOscillator::table; //interpolated table
+
+    if (level >= 4)
+        quality.maxPartials = 2; //the higher partials are the quietest ones
+
+    return quality;
+}
+
+void CpuGovernor::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    smoothedLoad = 0;
+    samplesSinceChange = 0;
+    samplesWithHeadroom = 0;
+    setLevel(0);
+}
+
+void CpuGovernor::beginBlock() noexcept
+{
+    blockStart = juce::Time::getHighResolutionTicks();
+
+    if (forcedLevel >= 0)
+        setLevel(forcedLevel);
+}
+
+void CpuGovernor::endBlock(int numSamples) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    if (forcedLevel >= 0)
+        return;
+
+    if (nonRealtime)
+    {
+        setLevel(0);
+        return;
+    }
+
+    auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - blockStart);
+    auto load = (float)(elapsed * sampleRate / numSamples);
+
+    //Smoothing over a few blocks, a single slow block is handled by the spike check
+    smoothedLoad += 0.1f * (load - smoothedLoad);
+    reportedLoad.store(smoothedLoad, std::memory_order_relaxed);
+
+    samplesSinceChange += numSamples;
+
+    auto currentLevel = getLevel();
+
+    if (currentLevel < maxLevel && (load > spikeLoad || (smoothedLoad > levelUpLoad && samplesSinceChange > settleSeconds * sampleRate)))
+    {
+        setLevel(currentLevel + 1);
+        return;
+    }
+
+    if (smoothedLoad < levelDownLoad)
+        samplesWithHeadroom += numSamples;
+    else
+        samplesWithHeadroom = 0;
+
+    if (currentLevel > 0 && samplesWithHeadroom > recoverSeconds * sampleRate)
+        setLevel(currentLevel - 1);
+}
+
+void CpuGovernor::setLevel(int newLevel) noexcept
+{
+    if (newLevel != getLevel())
+    {
+        samplesSinceChange = 0;
+        samplesWithHeadroom = 0;
+    }
+
+    level.store(newLevel, std::memory_order_relaxed);
+}
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    CpuGovernor.h
+    Created: 19 Oct 2026 3:40:12pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//Measures how much of the block duration the audio thread spends rendering and lowers the quality of the
+//synthesis step by step when it gets close to the deadline (a dropout on stage is worse than a thinner sound).
+//The quality comes back when there is headroom again.
+//All the methods except getLevel are meant to be called on the audio thread only.
+class CpuGovernor
+{
+public:
+
+    //What the voices are allowed to do at a given level
+    struct Quality
+    {
+        bool stealReleasedVoices = false; //voices in their release phase are faded out within one block
+        int lfoUpdateInterval = 100; //samples between two LFO updates
+        int minSineTier = 0; //cheapest sine allowed, as PartialOscillator::SineTier (the patch may already use a cheaper one)
+        int maxPartials = std::numeric_limits<int>::max();
+    };
+
+    //0: full quality, every level adds a saving to the ones below
+    static constexpr int maxLevel = 4;
+
+    static Quality getQuality(int level) noexcept;
+
+    void prepare(double sampleRate);
+
+    //Offline renders have no deadline: the level is kept at 0
+    void setNonRealtime(bool isNonRealtime) noexcept { nonRealtime = isNonRealtime; }
+
+    //Replays of a recorded session use the level of every recorded block (-1 goes back to measuring)
+    void setForcedLevel(int newLevel) noexcept { forcedLevel = juce::jmin(newLevel, maxLevel); }
+
+    void beginBlock() noexcept;
+    void endBlock(int numSamples) noexcept;
+
+    int getLevel() const noexcept { return level.load(std::memory_order_relaxed); }
+
+    //Smoothed fraction of the block duration spent rendering (can be read from any thread)
+    float getLoad() const noexcept { return reportedLoad.load(std::memory_order_relaxed); }
+
+private:
+
+    //Thresholds on the smoothed load: up means less quality
+    static constexpr float levelUpLoad = 0.5f;
+    static constexpr float levelDownLoad = 0.25f;
+    //A single block this close to the deadline raises the level immediately
+    static constexpr float spikeLoad = 0.9f;
+
+    //Time to wait after a change before judging its effect, and headroom time needed before going back up in quality
+    static constexpr double settleSeconds = 0.1;
+    static constexpr double recoverSeconds = 2.0;
+
+    void setLevel(int newLevel) noexcept;
+
+    double sampleRate = 44100;
+    bool nonRealtime = false;
+    int forcedLevel = -1;
+
+    juce::int64 blockStart = 0;
+    float smoothedLoad = 0;
+
+    int samplesSinceChange = 0;
+    int samplesWithHeadroom = 0;
+
+    std::atomic<int> level{ 0 };
+    std::atomic<float> reportedLoad{ 0 };
+};
@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    DoubleDouble.h
+    Created: 18 Oct 2026 5:02:11pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//Double-double number: the value is hi + lo, giving about 32 significant digits.
+//Used for the coordinates of the deep zoom (plain doubles break down at about 1e-13 of zoom)
+//and for the seed point of the fractal succession.
+//(Don't compile this with fast-math, it relies on exact IEEE rounding)
+struct DoubleDouble
+{
+    double hi = 0;
+    double lo = 0;
+
+    DoubleDouble() = default;
+    DoubleDouble(double value) : hi(value), lo(0) {}
+    DoubleDouble(double hi, double lo) : hi(hi), lo(lo) {}
+
+    explicit operator double() const noexcept { return hi + lo; }
+
+    //Exact round trip (both parts are written with 17 significant digits)
+    juce::String toString() const
+    {
+        char text[64];
+        std::snprintf(text, sizeof(text), "%.17g %.17g", hi, lo);
+        return text;
+    }
+
+    static DoubleDouble fromString(const juce::String& text)
+    {
+        auto parts = juce::StringArray::fromTokens(text, " ", "");
+
+        if (parts.size() == 0)
+            return {};
+
+        auto hi = std::strtod(parts[0].toRawUTF8(), nullptr);
+        auto lo = parts.size() > 1 ? std::strtod(parts[1].toRawUTF8(), nullptr) : 0.0;
+
+        return { hi, lo };
+    }
+
+    //Error free transformations
+    static DoubleDouble twoSum(double a, double b) noexcept
+    {
+        auto s = a + b;
+        auto bb = s - a;
+        return { s, (a - (s - bb)) + (b - bb) };
+    }
+
+    static DoubleDouble quickTwoSum(double a, double b) noexcept
+    {
+        auto s = a + b;
+        return { s, b - (s - a) };
+    }
+
+    static DoubleDouble twoProduct(double a, double b) noexcept
+    {
+        auto p = a * b;
+        return { p, std::fma(a, b, -p) };
+    }
+};
+
+inline DoubleDouble operator-(const DoubleDouble& a) noexcept
+{
+    return { -a.hi, -a.lo };
+}
+
+inline DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b) noexcept
+{
+    auto s = DoubleDouble::twoSum(a.hi, b.hi);
+    auto t = DoubleDouble::twoSum(a.lo, b.lo);
+
+    s.lo += t.hi;
+    s = DoubleDouble::quickTwoSum(s.hi, s.lo);
+    s.lo += t.lo;
+
+    return DoubleDouble::quickTwoSum(s.hi, s.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b) noexcept
+{
+    return a + (-b);
+}
+
+inline DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b) noexcept
+{
+    auto p = DoubleDouble::twoProduct(a.hi, b.hi);
+    p.lo += a.hi * b.lo + a.lo * b.hi;
+
+    return DoubleDouble::quickTwoSum(p.hi, p.lo);
+}
+
+inline bool operator==(const DoubleDouble& a, const DoubleDouble& b) noexcept
+{
+    return a.hi == b.hi && a.lo == b.lo;
+}
+
+inline bool operator!=(const DoubleDouble& a, const DoubleDouble& b) noexcept
+{
+    return !(a == b);
+}
@@ -0,0 +1,183 @@
+/*
+  ==============================================================================
+
+    DspKernelLoops.h
+    Created: 26 Oct 2026 10:04:31am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include "DspKernels.h"
+#include "PartialOscillator.h"
+
+//Loops of the DSP kernels, included by DspKernels.cpp and by the files compiled with the AVX flags.
+//They have internal linkage, so that every file keeps the copy compiled with its own instruction set
+namespace
+{
+    void sineBankLoop(float* out, int numSamples, double* phases, const double* increments, const float* gains, int count) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            out[i] = 0.0f;
+
+        for (int k = 0; k < count; ++k)
+        {
+            //The phase of each sample is computed from the start, like the partial oscillators (no carried dependency)
+            const auto start = phases[k];
+            const auto step = increments[k];
+            const auto gain = gains[k];
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto phase = start + step * (double)i;
+                phase -= std::floor(phase);
+
+                out[i] += gain * PartialOscillator::sinePolynomial((float)(juce::MathConstants<double>::twoPi * phase - juce::MathConstants<double>::pi));
+            }
+
+            auto end = start + step * (double)numSamples;
+            phases[k] = end - std::floor(end);
+        }
+    }
+
+    void applyEnvelopeLoop(float* const* channels, int numChannels, const float* envelope, float gain, int numSamples) noexcept
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* samples = channels[channel];
+
+            for (int i = 0; i < numSamples; ++i)
+                samples[i] *= envelope[i] * gain;
+        }
+    }
+
+    void addChannelsLoop(float* const* destination, const float* const* source, int numChannels, int numSamples) noexcept
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* out = destination[channel];
+            const auto* in = source[channel];
+
+            for (int i = 0; i < numSamples; ++i)
+                out[i] += in[i];
+        }
+    }
+
+    //|c + d| - |c| without cancellation (needed by the burning ship perturbation), as selects so that it vectorises
+    forcedinline double diffAbs(double c, double d) noexcept
+    {
+        auto ifPositive = c + d >= 0 ? d : -d - 2 * c;
+        auto ifNegative = c + d > 0 ? d + 2 * c : -d;
+
+        return c >= 0 ? ifPositive : ifNegative;
+    }
+
+    //The pixels share the reference point of each iteration, so the batch is one vector loop per iteration.
+    //The finished pixels keep being computed (and ignored) until the whole batch is done
+    template <int fractal>
+    forcedinline void perturbationLoop(const double* referenceX, const double* referenceY, int referenceLength,
+        const double* dcx, const double* dcy, int* iterations, int count, int maxIterations) noexcept
+    {
+        constexpr int running = std::numeric_limits<int>::min();
+
+        double a[DspKernels::maxBatchSize], b[DspKernels::maxBatchSize];
+
+        for (int i = 0; i < count; ++i)
+        {
+            a[i] = 0;
+            b[i] = 0;
+            iterations[i] = running;
+        }
+
+        for (int n = 0; n < maxIterations; ++n)
+        {
+            //The reference escaped before these pixels: their orbits can't be followed anymore
+            if (n + 1 >= referenceLength)
+            {
+                for (int i = 0; i < count; ++i)
+                    iterations[i] = iterations[i] == running ? DspKernels::glitched : iterations[i];
+
+                return;
+            }
+
+            const auto X = referenceX[n];
+            const auto Y = referenceY[n];
+            const auto nextX = referenceX[n + 1];
+            const auto nextY = referenceY[n + 1];
+
+            //|z| much smaller than |Z| means that d lost all its precision
+            const auto glitchLimit = 1e-6 * (nextX * nextX + nextY * nextY);
+
+            int numRunning = 0;
+
+            for (int i = 0; i < count; ++i)
+            {
+                double na, nb;
+
+                if (fractal == 1) //Burning ship
+                {
+                    na = 2 * X * a[i] + a[i] * a[i] - 2 * Y * b[i] - b[i] * b[i];
+                    nb = 2 * (diffAbs(X, a[i]) * std::abs(Y + b[i]) + std::abs(X) * diffAbs(Y, b[i]));
+                }
+                else if (fractal == 2) //Tricorn (conjugate of the Mandelbrot perturbation)
+                {
+                    na = 2 * (X * a[i] - Y * b[i]) + a[i] * a[i] - b[i] * b[i];
+                    nb = -(2 * (X * b[i] + Y * a[i]) + 2 * a[i] * b[i]);
+                }
+                else //Mandelbrot
+                {
+                    na = 2 * (X * a[i] - Y * b[i]) + a[i] * a[i] - b[i] * b[i];
+                    nb = 2 * (X * b[i] + Y * a[i]) + 2 * a[i] * b[i];
+                }
+
+                auto newA = na + dcx[i];
+                auto newB = nb + dcy[i];
+
+                auto zx = nextX + newA;
+                auto zy = nextY + newB;
+                auto magnitude = zx * zx + zy * zy;
+
+                auto result = magnitude > 4.0 ? n + 1 : (magnitude < glitchLimit ? DspKernels::glitched : running);
+                auto isRunning = iterations[i] == running;
+
+                a[i] = isRunning ? newA : a[i];
+                b[i] = isRunning ? newB : b[i];
+                iterations[i] = isRunning ? result : iterations[i];
+
+                numRunning += iterations[i] == running ? 1 : 0;
+            }
+
+            if (numRunning == 0)
+                return;
+        }
+
+        for (int i = 0; i < count; ++i)
+            iterations[i] = iterations[i] == running ? maxIterations : iterations[i];
+    }
+
+    void iteratePerturbationLoop(int fractal, const double* referenceX, const double* referenceY, int referenceLength,
+        const double* dcx, const double* dcy, int* iterations, int count, int maxIterations) noexcept
+    {
+        count = juce::jmin(count, DspKernels::maxBatchSize);
+
+        switch (fractal)
+        {
+        case 1:
+            perturbationLoop<1>(referenceX, referenceY, referenceLength, dcx, dcy, iterations, count, maxIterations);
+            break;
+        case 2:
+            perturbationLoop<2>(referenceX, referenceY, referenceLength, dcx, dcy, iterations, count, maxIterations);
+            break;
+        default:
+            perturbationLoop<0>(referenceX, referenceY, referenceLength, dcx, dcy, iterations, count, maxIterations);
+            break;
+        }
+    }
+
+    const DspKernels::Table kernelTable{ sineBankLoop, applyEnvelopeLoop, addChannelsLoop, iteratePerturbationLoop };
+}
+
+//Defined in DspKernelsAvx2.cpp and DspKernelsAvx512.cpp, nullptr if they were not compiled with that instruction set
+const DspKernels::Table* getAvx2KernelTable() noexcept;
+const DspKernels::Table* getAvx512KernelTable() noexcept;
@@ -0,0 +1,182 @@
+/*
+  ==============================================================================
+
+    DspKernels.cpp
+    Created: 25 Oct 2026 3:19:14pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "DspKernelLoops.h"
+
+namespace
+{
+    //The CPU check of each set (the kernels of a set may also be missing from the build)
+    bool isSupportedByCpu(DspKernels::InstructionSet set) noexcept
+    {
+        switch (set)
+        {
+        case DspKernels::generic:
+            return true;
+
+        case DspKernels::avx2:
+            return juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3();
+
+        //What /arch:AVX512 can use
+        case DspKernels::avx512:
+            return juce::SystemStats::hasAVX512F() && juce::SystemStats::hasAVX512CD() && juce::SystemStats::hasAVX512BW()
+                && juce::SystemStats::hasAVX512DQ() && juce::SystemStats::hasAVX512VL() && juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3();
+
+        default:
+            return false;
+        }
+    }
+
+    DspKernels::InstructionSet findBestInstructionSet() noexcept
+    {
+        for (int set = DspKernels::numInstructionSets - 1; set > DspKernels::generic; --set)
+        {
+            if (DspKernels::getTable((DspKernels::InstructionSet)set) != nullptr)
+                return (DspKernels::InstructionSet)set;
+        }
+
+        return DspKernels::generic;
+    }
+}
+
+const DspKernels::Table* DspKernels::getTable(InstructionSet set) noexcept
+{
+    if (!isSupportedByCpu(set))
+        return nullptr;
+
+    switch (set)
+    {
+    case avx2:
+        return getAvx2KernelTable();
+
+    case avx512:
+        return getAvx512KernelTable();
+
+    case generic:
+        return &kernelTable;
+
+    default:
+        return nullptr;
+    }
+}
+
+DspKernels::InstructionSet DspKernels::getActiveInstructionSet() noexcept
+{
+    //CPUID is only read once
+    static const auto activeSet = findBestInstructionSet();
+    return activeSet;
+}
+
+const DspKernels::Table& DspKernels::get() noexcept
+{
+    static const auto* activeTable = getTable(getActiveInstructionSet());
+    return *activeTable;
+}
+
+juce::String DspKernels::getName(InstructionSet set)
+{
+    switch (set)
+    {
+    case avx2:
+        return "AVX2";
+
+    case avx512:
+        return "AVX-512";
+
+    case generic:
+    default:
+       #if JUCE_INTEL
+        return "SSE2";
+       #elif JUCE_ARM
+        return "NEON";
+       #else
+        return "Generic";
+       #endif
+    }
+}
+
+juce::String DspKernels::runBenchmark()
+{
+    //A block of the orbit bank, the partials of a voice and a row of the fractal renderer
+    constexpr int numSamples = 512;
+    constexpr int numPartials = 32;
+    constexpr int numChannels = 2;
+    constexpr int numRuns = 200;
+    constexpr int referenceLength = 1024;
+
+    juce::Random random(1234);
+
+    std::vector<float> out((size_t)numSamples), envelope((size_t)numSamples);
+    std::vector<double> phases((size_t)numPartials), increments((size_t)numPartials);
+    std::vector<float> gains((size_t)numPartials);
+
+    for (int k = 0; k < numPartials; ++k)
+    {
+        increments[(size_t)k] = random.nextDouble() * 0.1;
+        gains[(size_t)k] = random.nextFloat() / numPartials;
+    }
+
+    for (auto& value : envelope)
+        value = random.nextFloat();
+
+    juce::AudioBuffer<float> destination(numChannels, numSamples), source(numChannels, numSamples);
+    destination.clear();
+    source.clear();
+
+    //A reference orbit that stays bounded (the centre of the main cardioid), pixels around it
+    std::vector<double> referenceX((size_t)referenceLength, 0.0), referenceY((size_t)referenceLength, 0.0);
+    std::array<double, maxBatchSize> dcx, dcy;
+    std::array<int, maxBatchSize> iterations;
+
+    for (int i = 0; i < maxBatchSize; ++i)
+    {
+        dcx[(size_t)i] = (random.nextDouble() - 0.5) * 0.5;
+        dcy[(size_t)i] = (random.nextDouble() - 0.5) * 0.5;
+    }
+
+    auto time = [](std::function<void()> kernel)
+    {
+        kernel(); //warm up
+
+        auto start = juce::Time::getHighResolutionTicks();
+
+        for (int run = 0; run < numRuns; ++run)
+            kernel();
+
+        auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        return juce::String(seconds * 1e6 / numRuns, 2) + " us";
+    };
+
+    juce::String report;
+    report << "DSP kernels (active: " << getName(getActiveInstructionSet()) << ")\n";
+
+    for (int set = 0; set < numInstructionSets; ++set)
+    {
+        auto* table = getTable((InstructionSet)set);
+
+        if (table == nullptr)
+        {
+            report << getName((InstructionSet)set) << ": not available\n";
+            continue;
+        }
+
+        report << getName((InstructionSet)set) << ":\n"
+               << "  sine bank (" << numPartials << " partials x " << numSamples << " samples): "
+               << time([&] { table->sineBank(out.data(), numSamples, phases.data(), increments.data(), gains.data(), numPartials); }) << "\n"
+               << "  envelope and tremolo (" << numChannels << " x " << numSamples << "): "
+               << time([&] { table->applyEnvelope(destination.getArrayOfWritePointers(), numChannels, envelope.data(), 0.5f, numSamples); }) << "\n"
+               << "  summation (" << numChannels << " x " << numSamples << "): "
+               << time([&] { table->addChannels(destination.getArrayOfWritePointers(), source.getArrayOfReadPointers(), numChannels, numSamples); }) << "\n"
+               << "  perturbation (" << maxBatchSize << " pixels, up to " << referenceLength - 1 << " iterations): "
+               << time([&] { table->iteratePerturbation(0, referenceX.data(), referenceY.data(), referenceLength, dcx.data(), dcy.data(),
+                                                         iterations.data(), maxBatchSize, referenceLength - 1); }) << "\n";
+    }
+
+    return report;
+}
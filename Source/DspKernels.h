@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    DspKernels.h
+    Created: 25 Oct 2026 3:18:52pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//Hot loops of the synth compiled for several instruction sets (DspKernelLoops.h), the best one for the CPU is picked once
+class DspKernels
+{
+public:
+
+    enum InstructionSet
+    {
+        generic,
+        avx2, //with FMA
+        avx512, //F, CD, BW, DQ and VL
+        numInstructionSets
+    };
+
+    //Iterations of a pixel whose perturbation lost its precision
+    static constexpr int glitched = -1;
+
+    //Pixels iterated together by iteratePerturbation
+    static constexpr int maxBatchSize = 16;
+
+    struct Table
+    {
+        //out = sum of gains[k] * sin(2 pi phases[k] - pi) over the partials (polynomial sine), then advances the phases
+        void (*sineBank)(float* out, int numSamples, double* phases, const double* increments, const float* gains, int count);
+
+        //channels *= envelope * gain (the envelope and the tremolo of a partial in one pass)
+        void (*applyEnvelope)(float* const* channels, int numChannels, const float* envelope, float gain, int numSamples);
+
+        //destination += source, channel by channel
+        void (*addChannels)(float* const* destination, const float* const* source, int numChannels, int numSamples);
+
+        //Escape iteration of up to maxBatchSize pixels, iterated in lockstep as double precision perturbations of a
+        //reference orbit (maxIterations if they don't escape, glitched if the perturbation lost its precision)
+        void (*iteratePerturbation)(int fractal, const double* referenceX, const double* referenceY, int referenceLength,
+            const double* dcx, const double* dcy, int* iterations, int count, int maxIterations);
+    };
+
+    //Kernels of the best instruction set of the CPU (chosen at the first call, any thread)
+    static const Table& get() noexcept;
+    static InstructionSet getActiveInstructionSet() noexcept;
+
+    //nullptr if the set is not compiled in or not supported by the CPU
+    static const Table* getTable(InstructionSet set) noexcept;
+
+    static juce::String getName(InstructionSet set);
+
+    //Times every kernel with every instruction set available on this CPU (not realtime safe, takes about a second)
+    static juce::String runBenchmark();
+};
@@ -0,0 +1,21 @@
+/*
+  ==============================================================================
+
+    DspKernelsAvx2.cpp
+    Created: 26 Oct 2026 10:05:12am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "DspKernelLoops.h"
+
+//Compiled with the flags of its set in the .jucer (/arch:AVX2 with MSVC, -mavx2 -mfma with Clang)
+const DspKernels::Table* getAvx2KernelTable() noexcept
+{
+   #if JUCE_INTEL && defined(__AVX2__)
+    return &kernelTable;
+   #else
+    return nullptr;
+   #endif
+}
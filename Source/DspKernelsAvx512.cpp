@@ -0,0 +1,21 @@
+/*
+  ==============================================================================
+
+    DspKernelsAvx512.cpp
+    Created: 26 Oct 2026 10:05:40am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "DspKernelLoops.h"
+
+//Compiled with the flags of its set in the .jucer (/arch:AVX512 with MSVC, -mavx512f with Clang)
+const DspKernels::Table* getAvx512KernelTable() noexcept
+{
+   #if JUCE_INTEL && defined(__AVX512F__)
+    return &kernelTable;
+   #else
+    return nullptr;
+   #endif
+}
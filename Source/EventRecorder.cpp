@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+    EventRecorder.cpp
+    Created: 22 Oct 2026 3:27:10pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "EventRecorder.h"
+
+EventRecorder::EventRecorder()
+    : juce::Thread("Event recorder"), records((size_t)capacity)
+{
+}
+
+EventRecorder::~EventRecorder()
+{
+    stop();
+}
+
+void EventRecorder::setNumParameters(int numParameters)
+{
+    jassert(!isRecording());
+    lastParameterValues.assign((size_t)numParameters, 0.0f);
+}
+
+bool EventRecorder::start(const juce::File& newFile, const EventRecordingHeader& header, const juce::MemoryBlock& state)
+{
+    stop();
+
+    auto newStream = std::make_unique<juce::FileOutputStream>(newFile);
+
+    if (!newStream->openedOk() || !newStream->setPosition(0) || !newStream->truncate().wasOk())
+        return false;
+
+    newStream->write(&header, sizeof(EventRecordingHeader));
+    newStream->write(state.getData(), state.getSize());
+
+    file = newFile;
+    stream = std::move(newStream);
+
+    //Records left by the audio thread after the last stop are dropped (only the consumer side is touched)
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+    fifo.finishedRead(size1 + size2);
+
+    //The first block writes all the parameter values
+    snapshotPending = true;
+    droppedRecords = 0;
+
+    startThread(3);
+    recording.store(true, std::memory_order_release);
+
+    return true;
+}
+
+void EventRecorder::stop()
+{
+    if (!recording.exchange(false, std::memory_order_acq_rel) && stream == nullptr)
+        return;
+
+    stopThread(2000);
+
+    //What the audio thread wrote before seeing the flag
+    flush();
+
+    stream.reset();
+}
+
+void EventRecorder::run()
+{
+    while (!threadShouldExit())
+    {
+        flush();
+        wait(50);
+    }
+}
+
+void EventRecorder::flush()
+{
+    if (stream == nullptr)
+        return;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+    stream->write(records.data() + start1, (size_t)size1 * sizeof(EventRecord));
+    stream->write(records.data() + start2, (size_t)size2 * sizeof(EventRecord));
+
+    fifo.finishedRead(size1 + size2);
+    stream->flush();
+}
+
+void EventRecorder::push(const EventRecord& record) noexcept
+{
+    //Tell the replay how much is missing before writing again
+    if (droppedRecords > 0)
+    {
+        if (fifo.getFreeSpace() < 2)
+        {
+            ++droppedRecords;
+            return;
+        }
+
+        EventRecord lost;
+        lost.type = EventRecord::dropped;
+        lost.position = droppedRecords;
+        droppedRecords = 0;
+
+        push(lost);
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+    {
+        ++droppedRecords;
+        return;
+    }
+
+    records[(size_t)(size1 > 0 ? start1 : start2)] = record;
+    fifo.finishedWrite(1);
+}
+
+void EventRecorder::recordBlockStart(int numSamples, int cpuLevel, double bpm) noexcept
+{
+    blockStartTicks = juce::Time::getHighResolutionTicks();
+
+    EventRecord record;
+    record.type = EventRecord::blockStart;
+    record.position = numSamples;
+    record.bytes[0] = (juce::uint8)cpuLevel;
+    record.values[0] = bpm;
+
+    push(record);
+}
+
+void EventRecorder::recordMidi(const juce::MidiBuffer& midiMessages) noexcept
+{
+    for (const auto metadata : midiMessages)
+    {
+        if (metadata.numBytes > 3)
+            continue;
+
+        EventRecord record;
+        record.type = EventRecord::midi;
+        record.position = metadata.samplePosition;
+        std::copy_n(metadata.data, metadata.numBytes, record.bytes);
+
+        push(record);
+    }
+}
+
+void EventRecorder::recordParameters(const juce::Array<juce::AudioProcessorParameter*>& parameters) noexcept
+{
+    auto numParameters = juce::jmin(parameters.size(), (int)lastParameterValues.size());
+
+    for (int i = 0; i < numParameters; ++i)
+    {
+        auto value = parameters.getUnchecked(i)->getValue();
+
+        if (!snapshotPending && value == lastParameterValues[(size_t)i])
+            continue;
+
+        lastParameterValues[(size_t)i] = value;
+
+        EventRecord record;
+        record.type = EventRecord::parameter;
+        record.position = i;
+        record.values[0] = value;
+
+        push(record);
+    }
+
+    snapshotPending = false;
+}
+
+void EventRecorder::recordSeedPoint(int part, DoubleDouble x, DoubleDouble y) noexcept
+{
+    EventRecord record;
+    record.type = EventRecord::seedX;
+    record.position = part;
+    record.values[0] = x.hi;
+    record.values[1] = x.lo;
+
+    push(record);
+
+    record.type = EventRecord::seedY;
+    record.values[0] = y.hi;
+    record.values[1] = y.lo;
+
+    push(record);
+}
+
+void EventRecorder::recordBlockEnd() noexcept
+{
+    EventRecord record;
+    record.type = EventRecord::blockEnd;
+    record.values[0] = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - blockStartTicks);
+
+    push(record);
+}
@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    EventRecorder.h
+    Created: 22 Oct 2026 3:26:54pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "DoubleDouble.h"
+
+//One event seen by processBlock (24 bytes on disk)
+struct EventRecord
+{
+    enum Type : juce::uint8
+    {
+        blockStart, //position: number of samples, bytes[0]: CPU governor level, values[0]: bpm of the host
+        midi, //position: sample in the block, bytes: the message (longer messages are not recorded)
+        parameter, //position: index of the parameter, values[0]: normalised value
+        seedX, //position: part, values: high and low parts of the precise seed (the parameters only have its rounding)
+        seedY,
+        blockEnd, //values[0]: seconds spent in processBlock
+        dropped //position: records lost because the ring was full
+    };
+
+    Type type = blockStart;
+    juce::uint8 bytes[3] = {};
+    juce::int32 position = 0;
+    double values[2] = {};
+};
+
+static_assert(sizeof(EventRecord) == 24, "The records are written as they are");
+
+//Header of a recording, followed by the plugin state at the start and then by the records
+struct EventRecordingHeader
+{
+    char magic[4];
+    juce::int32 version;
+    double sampleRate;
+    juce::int32 blockSize;
+    juce::int32 numChannels;
+    juce::int32 numParameters;
+    juce::int32 reserved;
+    juce::int64 stateSize;
+    char padding[24];
+
+    static constexpr juce::int32 currentVersion = 1;
+};
+
+static_assert(sizeof(EventRecordingHeader) == 64, "The header is written as it is");
+
+//Optional recorder of what processBlock receives, to replay a glitch reported by a user exactly.
+//The audio thread appends records to a preallocated single producer, single consumer ring (no locks,
+//no allocation) and a background thread flushes the ring to the file.
+//If the ring is full the records are dropped and the number of lost records is written as soon as there is room.
+class EventRecorder : private juce::Thread
+{
+public:
+
+    EventRecorder();
+    ~EventRecorder() override;
+
+    //Sizes the copy of the parameter values compared in every block (before the first recording)
+    void setNumParameters(int numParameters);
+
+    //Message thread. Writes the header and the state, then the audio thread starts recording from its next block
+    bool start(const juce::File& file, const EventRecordingHeader& header, const juce::MemoryBlock& state);
+    void stop();
+
+    bool isRecording() const noexcept { return recording.load(std::memory_order_acquire); }
+
+    //Audio thread only (and only while recording)
+    void recordBlockStart(int numSamples, int cpuLevel, double bpm) noexcept;
+    void recordMidi(const juce::MidiBuffer& midiMessages) noexcept;
+    void recordParameters(const juce::Array<juce::AudioProcessorParameter*>& parameters) noexcept;
+    void recordSeedPoint(int part, DoubleDouble x, DoubleDouble y) noexcept;
+    void recordBlockEnd() noexcept;
+
+    juce::File getFile() const { return file; }
+
+private:
+
+    void run() override;
+
+    //Consumer side: writes what is in the ring to the stream
+    void flush();
+
+    void push(const EventRecord& record) noexcept;
+
+    static constexpr int capacity = 1 << 16; //about 1.5 MB, several seconds of dense automation
+
+    juce::AbstractFifo fifo{ capacity };
+    std::vector<EventRecord> records;
+
+    std::atomic<bool> recording{ false };
+
+    //Audio thread state
+    std::vector<float> lastParameterValues;
+    bool snapshotPending = false;
+    juce::int32 droppedRecords = 0;
+    juce::int64 blockStartTicks = 0;
+
+    juce::File file;
+    std::unique_ptr<juce::FileOutputStream> stream;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EventRecorder)
+};
@@ -0,0 +1,230 @@
+/*
+  ==============================================================================
+
+    EventReplayer.cpp
+    Created: 22 Oct 2026 5:02:54pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "EventReplayer.h"
+#include "PluginProcessor.h"
+
+namespace
+{
+    //Gives the recorded tempo to the synced delay
+    class ReplayPlayHead : public juce::AudioPlayHead
+    {
+    public:
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            if (bpm <= 0)
+                return {};
+
+            PositionInfo position;
+            position.setBpm(bpm);
+            return position;
+        }
+
+        double bpm = 0;
+    };
+}
+
+juce::Result EventReplayer::open(const juce::File& recording)
+{
+    events.clear();
+    blocks.clear();
+    droppedRecords = 0;
+
+    juce::FileInputStream input(recording);
+
+    if (!input.openedOk())
+        return juce::Result::fail("Can't open " + recording.getFullPathName());
+
+    if (input.read(&header, sizeof(header)) != (int)sizeof(header)
+        || std::memcmp(header.magic, "FER1", 4) != 0 || header.version != EventRecordingHeader::currentVersion)
+        return juce::Result::fail(recording.getFileName() + " is not an event recording");
+
+    if (header.sampleRate <= 0 || header.blockSize <= 0 || header.numChannels <= 0
+        || header.stateSize < 0 || header.stateSize > input.getNumBytesRemaining())
+        return juce::Result::fail(recording.getFileName() + " is damaged");
+
+    state.setSize((size_t)header.stateSize);
+    input.read(state.getData(), (int)header.stateSize);
+
+    auto numRecords = (size_t)(input.getNumBytesRemaining() / (juce::int64)sizeof(EventRecord));
+    std::vector<EventRecord> records(numRecords);
+    input.read(records.data(), (int)(numRecords * sizeof(EventRecord)));
+
+    //The events written before the first block start belong to no block (the recording started mid-block)
+    Block* current = nullptr;
+
+    for (const auto& record : records)
+    {
+        switch (record.type)
+        {
+        case EventRecord::blockStart:
+            blocks.emplace_back();
+            current = &blocks.back();
+            current->numSamples = juce::jlimit(0, header.blockSize, (int)record.position);
+            current->cpuLevel = record.bytes[0];
+            current->bpm = record.values[0];
+            current->firstEvent = (int)events.size();
+            break;
+        case EventRecord::blockEnd:
+            if (current != nullptr)
+                current->recordedSeconds = record.values[0];
+            current = nullptr;
+            break;
+        case EventRecord::dropped:
+            droppedRecords += record.position;
+            break;
+        case EventRecord::midi:
+        case EventRecord::parameter:
+        case EventRecord::seedX:
+        case EventRecord::seedY:
+            if (current != nullptr)
+            {
+                events.push_back(record);
+                ++current->numEvents;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (blocks.empty())
+        return juce::Result::fail(recording.getFileName() + " has no blocks");
+
+    return juce::Result::ok();
+}
+
+juce::Result EventReplayer::render(const juce::File& audioFile, const juce::File& timingFile, std::function<bool(double)> progress)
+{
+    report.clear();
+
+    FractalSynthesisAudioProcessor processor;
+
+    auto sampleRate = header.sampleRate;
+    auto numChannels = juce::jlimit(1, 2, (int)header.numChannels);
+
+    //The parts and voices are created on this thread, between the blocks (the message thread would race with processBlock)
+    processor.setSynchronousStructuralChanges(true);
+
+    processor.setPlayConfigDetails(0, numChannels, sampleRate, header.blockSize);
+    processor.setStateInformation(state.getData(), (int)state.getSize());
+    processor.prepareToPlay(sampleRate, header.blockSize);
+
+    ReplayPlayHead playHead;
+    processor.setPlayHead(&playHead);
+
+    auto& parameters = processor.getParameters();
+
+    juce::WavAudioFormat wavFormat;
+    audioFile.deleteFile();
+    auto audioStream = std::make_unique<juce::FileOutputStream>(audioFile);
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+
+    if (audioStream->openedOk())
+        writer.reset(wavFormat.createWriterFor(audioStream.get(), sampleRate, (unsigned int)numChannels, 24, {}, 0));
+
+    if (writer == nullptr)
+        return juce::Result::fail("Can't write " + audioFile.getFullPathName());
+
+    audioStream.release(); //owned by the writer
+
+    timingFile.deleteFile();
+    juce::FileOutputStream timing(timingFile);
+
+    if (!timing.openedOk())
+        return juce::Result::fail("Can't write " + timingFile.getFullPathName());
+
+    timing << "block,samples,cpu level,budget ms,recorded ms,replay ms\n";
+
+    juce::AudioBuffer<float> buffer(numChannels, header.blockSize);
+    juce::MidiBuffer midi;
+
+    std::array<DoubleDouble, processor_consts::NUM_PARTS> seedX{};
+
+    int recordedOverruns = 0;
+    double maxRecorded = 0;
+    double maxReplayed = 0;
+
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        const auto& block = blocks[i];
+
+        midi.clear();
+
+        for (int j = block.firstEvent; j < block.firstEvent + block.numEvents; ++j)
+        {
+            const auto& event = events[(size_t)j];
+            auto part = juce::jlimit(0, processor_consts::NUM_PARTS - 1, (int)event.position);
+
+            switch (event.type)
+            {
+            case EventRecord::midi:
+                midi.addEvent(juce::MidiMessage(event.bytes[0], event.bytes[1], event.bytes[2]), event.position);
+                break;
+            case EventRecord::parameter:
+                if (juce::isPositiveAndBelow((int)event.position, parameters.size()))
+                    parameters.getUnchecked(event.position)->setValueNotifyingHost((float)event.values[0]);
+                break;
+            case EventRecord::seedX:
+                seedX[(size_t)part] = { event.values[0], event.values[1] };
+                break;
+            case EventRecord::seedY:
+                processor.setSeedPoint(part, seedX[(size_t)part], { event.values[0], event.values[1] });
+                break;
+            default:
+                break;
+            }
+        }
+
+        playHead.bpm = block.bpm;
+        processor.setForcedCpuLevel(block.cpuLevel);
+
+        buffer.setSize(numChannels, block.numSamples, false, false, true);
+        buffer.clear();
+
+        auto start = juce::Time::getHighResolutionTicks();
+        processor.processBlock(buffer, midi);
+        auto replayed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        writer->writeFromAudioSampleBuffer(buffer, 0, block.numSamples);
+
+        auto budget = block.numSamples / sampleRate;
+
+        if (block.recordedSeconds > budget)
+            ++recordedOverruns;
+
+        maxRecorded = juce::jmax(maxRecorded, block.recordedSeconds);
+        maxReplayed = juce::jmax(maxReplayed, replayed);
+
+        timing << (int)i << "," << block.numSamples << "," << block.cpuLevel << "," << budget * 1000.0 << ","
+               << (block.recordedSeconds >= 0 ? juce::String(block.recordedSeconds * 1000.0) : juce::String()) << ","
+               << replayed * 1000.0 << "\n";
+
+        if (progress != nullptr && (i % 64) == 0 && !progress((double)i / (double)blocks.size()))
+            return juce::Result::fail("Cancelled");
+    }
+
+    processor.setPlayHead(nullptr);
+    processor.releaseResources();
+
+    report << (int)blocks.size() << " blocks (" << juce::String((double)header.blockSize / sampleRate * 1000.0, 1) << " ms max), "
+           << juce::String(sampleRate) << " Hz\n"
+           << "Blocks over their budget in the session: " << recordedOverruns << "\n"
+           << "Slowest block: " << juce::String(maxRecorded * 1000.0, 2) << " ms in the session, "
+           << juce::String(maxReplayed * 1000.0, 2) << " ms in the replay\n";
+
+    if (droppedRecords > 0)
+        report << droppedRecords << " records were lost while recording, the replay may differ\n";
+
+    report << "Audio: " << audioFile.getFullPathName() << "\n"
+           << "Timings: " << timingFile.getFullPathName();
+
+    return juce::Result::ok();
+}
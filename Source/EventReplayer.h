@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    EventReplayer.h
+    Created: 22 Oct 2026 5:02:38pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "EventRecorder.h"
+
+//Plays a recording made by the EventRecorder through a new processor, offline and as fast as possible:
+//the state at the start is restored, then every block is rendered with the recorded size, MIDI, parameter changes,
+//tempo and CPU governor level. The output is written to a WAV file and the time of every block to a CSV file
+//next to the time it took in the session, so a glitch can be reproduced and profiled away from the host.
+//Not for the audio thread (it allocates and writes files).
+class EventReplayer
+{
+public:
+
+    //Reads the header, the state and the records
+    juce::Result open(const juce::File& recording);
+
+    //progress gets 0..1 and returns false to cancel
+    juce::Result render(const juce::File& audioFile, const juce::File& timingFile, std::function<bool(double)> progress);
+
+    //Summary of the last render
+    juce::String getReport() const { return report; }
+
+private:
+
+    struct Block
+    {
+        int numSamples = 0;
+        int cpuLevel = 0;
+        double bpm = 0;
+        double recordedSeconds = -1; //-1 if the end of the block was lost
+        int firstEvent = 0; //range of the parameter, seed and MIDI records of the block
+        int numEvents = 0;
+    };
+
+    EventRecordingHeader header{};
+    juce::MemoryBlock state;
+    std::vector<EventRecord> events;
+    std::vector<Block> blocks;
+    juce::int64 droppedRecords = 0;
+
+    juce::String report;
+};
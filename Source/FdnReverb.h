@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    FdnReverb.h
+    Created: 21 Oct 2026 4:12:09pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//Feedback delay network reverb, the delay lines are the lanes of SIMD registers
+template <int numLines>
+class FdnReverb
+{
+public:
+
+    using Register = juce::dsp::SIMDRegister<float>;
+
+    static constexpr int numRegisters = numLines / (int)Register::SIMDNumElements;
+
+    static_assert(numLines % (int)Register::SIMDNumElements == 0, "The lines must fill whole registers");
+
+    //Not realtime safe (allocates the delay lines)
+    void prepare(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+
+        //Mutually prime lengths between 30 and 100 ms, so that the echoes of the lines don't line up
+        static constexpr double lineMilliseconds[] = { 29.7, 37.1, 41.1, 43.7, 47.9, 53.3, 59.9, 61.7,
+                                                       67.1, 71.3, 73.9, 79.3, 83.9, 89.1, 97.3, 101.9 };
+
+        static_assert(numLines <= (int)(sizeof(lineMilliseconds) / sizeof(lineMilliseconds[0])), "Not enough line lengths");
+
+        int longest = 0;
+
+        for (int i = 0; i < numLines; ++i)
+        {
+            //Spread the lines over the whole range when only some of them are used
+            auto lengthIndex = i * 16 / numLines;
+            delays[(size_t)i] = juce::roundToInt(lineMilliseconds[lengthIndex] * 0.001 * sampleRate);
+            longest = juce::jmax(longest, delays[(size_t)i]);
+        }
+
+        lineLength = juce::nextPowerOfTwo(longest + 1);
+
+        //One frame of numLines samples per position, plus the per-line settings. Every block starts on a register boundary.
+        memory.assign((size_t)(numLines * (numSettings + lineLength) + (int)Register::SIMDNumElements), 0.0f);
+        settings = Register::getNextSIMDAlignedPtr(memory.data());
+        frames = settings + numSettings * numLines;
+
+        auto scale = 1.0f / std::sqrt((float)numLines);
+
+        //Orthogonal sign patterns: the two outputs and the input are decorrelated
+        for (int i = 0; i < numLines; ++i)
+        {
+            settings[tapsLeft * numLines + i] = (i & 1 ? -scale : scale);
+            settings[tapsRight * numLines + i] = (i & 2 ? -scale : scale);
+            settings[inputSigns * numLines + i] = (i & 4 ? -scale : scale);
+        }
+
+        decaySeconds = -1;
+        setParameters(2.0f, 0.4f);
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        std::fill(frames, frames + numLines * lineLength, 0.0f);
+        std::fill(settings + lowpass * numLines, settings + (lowpass + 1) * numLines, 0.0f);
+        writePosition = 0;
+    }
+
+    //Time for a 60 dB decay, and damping of the highs (0..1)
+    void setParameters(float newDecaySeconds, float newDamping) noexcept
+    {
+        damping = 0.9f * juce::jlimit(0.0f, 1.0f, newDamping);
+
+        if (newDecaySeconds == decaySeconds)
+            return;
+
+        decaySeconds = newDecaySeconds;
+
+        for (int i = 0; i < numLines; ++i)
+            settings[gains * numLines + i] = std::pow(10.0f, -3.0f * (float)delays[(size_t)i] / (decaySeconds * (float)sampleRate));
+    }
+
+    //Adds level * the reverb of the mono sum to every channel
+    void process(juce::AudioBuffer<float>& buffer, int numSamples, float level) noexcept
+    {
+        Register lineGains[numRegisters], left[numRegisters], right[numRegisters], input[numRegisters], state[numRegisters];
+
+        for (int r = 0; r < numRegisters; ++r)
+        {
+            lineGains[r] = Register::fromRawArray(getSettings(gains, r));
+            left[r] = Register::fromRawArray(getSettings(tapsLeft, r));
+            right[r] = Register::fromRawArray(getSettings(tapsRight, r));
+            input[r] = Register::fromRawArray(getSettings(inputSigns, r));
+            state[r] = Register::fromRawArray(getSettings(lowpass, r));
+        }
+
+        const auto dampingRegister = Register::expand(damping);
+        const auto feedbackScale = 2.0f / numLines;
+        const auto mask = lineLength - 1;
+
+        auto numChannels = buffer.getNumChannels();
+        auto* channelLeft = buffer.getWritePointer(0);
+        auto* channelRight = buffer.getWritePointer(numChannels > 1 ? 1 : 0);
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            //The lines have different lengths, so their outputs are gathered one by one
+            alignas(Register::SIMDRegisterSize) float outputs[numLines];
+            for (int i = 0; i < numLines; ++i)
+                outputs[i] = frames[((writePosition - delays[(size_t)i]) & mask) * numLines + i];
+
+            Register lines[numRegisters];
+            float lineSum = 0, sumLeft = 0, sumRight = 0;
+
+            for (int r = 0; r < numRegisters; ++r)
+            {
+                lines[r] = Register::fromRawArray(outputs + r * (int)Register::SIMDNumElements);
+
+                sumLeft += (lines[r] * left[r]).sum();
+                sumRight += (lines[r] * right[r]).sum();
+
+                //One pole low pass (unity gain at DC) then the decay of the line
+                state[r] = lines[r] + dampingRegister * (state[r] - lines[r]);
+                lines[r] = state[r] * lineGains[r];
+                lineSum += lines[r].sum();
+            }
+
+            auto dry = numChannels > 1 ? 0.5f * (channelLeft[n] + channelRight[n]) : channelLeft[n];
+
+            //Householder matrix (lossless, every line feeds all the others) plus the input
+            auto feedback = Register::expand(feedbackScale * lineSum);
+            auto in = Register::expand(dry);
+            auto* frame = frames + writePosition * numLines;
+
+            for (int r = 0; r < numRegisters; ++r)
+                (lines[r] - feedback + in * input[r]).copyToRawArray(frame + r * (int)Register::SIMDNumElements);
+
+            writePosition = (writePosition + 1) & mask;
+
+            channelLeft[n] += level * sumLeft;
+
+            if (numChannels > 1)
+                channelRight[n] += level * sumRight;
+        }
+
+        for (int r = 0; r < numRegisters; ++r)
+            state[r].copyToRawArray(getSettings(lowpass, r));
+    }
+
+    size_t getSizeInBytes() const { return sizeof(*this) + memory.size() * sizeof(float); }
+
+private:
+
+    //Blocks of numLines values in front of the frames
+    enum Settings
+    {
+        gains,
+        tapsLeft,
+        tapsRight,
+        inputSigns,
+        lowpass,
+        numSettings
+    };
+
+    float* getSettings(int setting, int registerIndex) noexcept
+    {
+        return settings + setting * numLines + registerIndex * (int)Register::SIMDNumElements;
+    }
+
+    double sampleRate = 44100;
+    float decaySeconds = -1;
+    float damping = 0;
+
+    std::array<int, (size_t)numLines> delays{};
+    int lineLength = 1;
+    int writePosition = 0;
+
+    std::vector<float> memory;
+    float* settings = nullptr;
+    float* frames = nullptr;
+};
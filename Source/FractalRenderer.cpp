@@ -0,0 +1,256 @@
+/*
+  ==============================================================================
+
+    FractalRenderer.cpp
+    Created: 18 Oct 2026 5:11:03pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "FractalRenderer.h"
+
+namespace
+{
+    inline DoubleDouble absolute(const DoubleDouble& x) noexcept
+    {
+        return x.hi < 0 ? -x : x;
+    }
+
+    //One step of the selected fractal (same formulas used for the synthesis: 0 Mandelbrot, 1 Burning Ship, 2 Tricorn)
+    inline void iterateDoubleDouble(int fractal, DoubleDouble& x, DoubleDouble& y, const DoubleDouble& cx, const DoubleDouble& cy) noexcept
+    {
+        auto nx = x * x - y * y + cx;
+        DoubleDouble ny;
+
+        switch (fractal)
+        {
+        case 1:
+            ny = absolute(x) * absolute(y) * DoubleDouble(2.0) + cy;
+            break;
+        case 2:
+            ny = -(x * y * DoubleDouble(2.0)) + cy;
+            break;
+        default:
+            ny = x * y * DoubleDouble(2.0) + cy;
+            break;
+        }
+
+        x = nx;
+        y = ny;
+    }
+}
+
+FractalRenderer::FractalRenderer() : juce::Thread("Fractal renderer")
+{
+    startThread(3); //below normal, the GUI must stay responsive
+}
+
+FractalRenderer::~FractalRenderer()
+{
+    stopThread(2000);
+}
+
+void FractalRenderer::requestRender(const View& view)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        pendingView = view;
+        hasPendingView = true;
+    }
+
+    notify();
+}
+
+juce::Image FractalRenderer::getImage() const
+{
+    const juce::ScopedLock sl(lock);
+    return image;
+}
+
+void FractalRenderer::run()
+{
+    while (!threadShouldExit())
+    {
+        View view;
+        bool hasView;
+        {
+            const juce::ScopedLock sl(lock);
+            view = pendingView;
+            hasView = hasPendingView;
+            hasPendingView = false;
+        }
+
+        if (hasView && view.width > 0 && view.height > 0)
+        {
+            juce::Image result(juce::Image::RGB, view.width, view.height, false, juce::SoftwareImageType());
+
+            if (render(view, result))
+            {
+                {
+                    const juce::ScopedLock sl(lock);
+                    image = result;
+                }
+
+                sendChangeMessage();
+            }
+
+            continue;
+        }
+
+        wait(-1);
+    }
+}
+
+bool FractalRenderer::render(const View& view, juce::Image& result)
+{
+    //Deeper zooms need more iterations to show the details
+    auto maxIterations = juce::jlimit(256, 4096, 256 + (int)(96.0 * std::log10(2.0 / view.span)));
+
+    auto width = view.width;
+    auto height = view.height;
+
+    auto pixelOffsetX = [&](int px) { return ((px + 0.5) / width - 0.5) * view.span; };
+    auto pixelOffsetY = [&](int py) { return (0.5 - (py + 0.5) / height) * view.span; };
+
+    std::vector<int> iterations((size_t)(width * height), 0);
+
+    std::vector<int> pending((size_t)(width * height));
+    std::iota(pending.begin(), pending.end(), 0);
+
+    std::vector<int> stillGlitched;
+    stillGlitched.reserve(pending.size());
+
+    //The first reference is the centre of the view, the following ones are taken inside the glitched areas
+    double referenceOffsetX = 0;
+    double referenceOffsetY = 0;
+
+    for (int reference = 0; reference < maxReferences && !pending.empty(); ++reference)
+    {
+        computeReferenceOrbit(view.fractal, view.centreX + referenceOffsetX, view.centreY + referenceOffsetY, maxIterations);
+
+        stillGlitched.clear();
+
+        //The pixels are iterated in batches by the DSP kernels
+        const auto& kernels = DspKernels::get();
+        auto referenceLength = (int)referenceX.size();
+
+        double dcx[DspKernels::maxBatchSize], dcy[DspKernels::maxBatchSize];
+        int batchIterations[DspKernels::maxBatchSize];
+
+        for (size_t start = 0; start < pending.size(); start += DspKernels::maxBatchSize)
+        {
+            {
+                const juce::ScopedLock sl(lock);
+
+                if (hasPendingView || threadShouldExit())
+                    return false;
+            }
+
+            auto count = (int)juce::jmin((size_t)DspKernels::maxBatchSize, pending.size() - start);
+
+            for (int i = 0; i < count; ++i)
+            {
+                auto index = pending[start + (size_t)i];
+                dcx[i] = pixelOffsetX(index % width) - referenceOffsetX;
+                dcy[i] = pixelOffsetY(index / width) - referenceOffsetY;
+            }
+
+            kernels.iteratePerturbation(view.fractal, referenceX.data(), referenceY.data(), referenceLength,
+                dcx, dcy, batchIterations, count, maxIterations);
+
+            for (int i = 0; i < count; ++i)
+            {
+                auto index = pending[start + (size_t)i];
+
+                if (batchIterations[i] == glitched)
+                    stillGlitched.push_back(index);
+                else
+                    iterations[(size_t)index] = batchIterations[i];
+            }
+        }
+
+        pending.swap(stillGlitched);
+
+        if (!pending.empty())
+        {
+            auto newReference = pending[pending.size() / 2];
+            referenceOffsetX = pixelOffsetX(newReference % width);
+            referenceOffsetY = pixelOffsetY(newReference / width);
+        }
+    }
+
+    for (auto index : pending)
+    {
+        if (threadShouldExit())
+            return false;
+
+        iterations[(size_t)index] = iterateDirect(view.fractal, view.centreX + pixelOffsetX(index % width),
+            view.centreY + pixelOffsetY(index / width), maxIterations);
+    }
+
+    juce::Image::BitmapData pixels(result, juce::Image::BitmapData::writeOnly);
+
+    for (int py = 0; py < height; ++py)
+        for (int px = 0; px < width; ++px)
+            pixels.setPixelColour(px, py, getColour(iterations[(size_t)(py * width + px)], maxIterations));
+
+    return true;
+}
+
+int FractalRenderer::computeReferenceOrbit(int fractal, DoubleDouble cx, DoubleDouble cy, int maxIterations)
+{
+    referenceX.clear();
+    referenceY.clear();
+
+    DoubleDouble x, y;
+
+    referenceX.push_back(0.0);
+    referenceY.push_back(0.0);
+
+    for (int n = 0; n < maxIterations; ++n)
+    {
+        iterateDoubleDouble(fractal, x, y, cx, cy);
+
+        auto rx = (double)x;
+        auto ry = (double)y;
+
+        referenceX.push_back(rx);
+        referenceY.push_back(ry);
+
+        if (rx * rx + ry * ry > 4.0)
+            break;
+    }
+
+    return (int)referenceX.size();
+}
+
+int FractalRenderer::iterateDirect(int fractal, DoubleDouble cx, DoubleDouble cy, int maxIterations) noexcept
+{
+    DoubleDouble x, y;
+
+    for (int n = 0; n < maxIterations; ++n)
+    {
+        iterateDoubleDouble(fractal, x, y, cx, cy);
+
+        auto rx = (double)x;
+        auto ry = (double)y;
+
+        if (rx * rx + ry * ry > 4.0)
+            return n + 1;
+    }
+
+    return maxIterations;
+}
+
+juce::Colour FractalRenderer::getColour(int iterations, int maxIterations) noexcept
+{
+    if (iterations >= maxIterations)
+        return juce::Colours::black;
+
+    //Dark enough to keep the seed marker visible
+    auto hue = std::fmod(0.6f + (float)iterations * 0.015f, 1.0f);
+    auto brightness = juce::jmin(0.75f, 0.15f + (float)iterations * 0.02f);
+
+    return juce::Colour::fromHSV(hue, 0.7f, brightness, 1.0f);
+}
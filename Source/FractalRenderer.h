@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    FractalRenderer.h
+    Created: 18 Oct 2026 5:10:42pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "DspKernels.h"
+#include "DoubleDouble.h"
+
+//Renders the fractal shown behind the input plane on a background thread.
+//To allow deep zooms, only one reference orbit is iterated in double-double precision (at the centre of the view)
+//and every pixel is computed as a double precision perturbation of it.
+//Pixels where the perturbation loses precision (glitches) are detected and rendered again with a new reference.
+class FractalRenderer : public juce::ChangeBroadcaster, private juce::Thread
+{
+public:
+
+    struct View
+    {
+        int fractal = 0; //as the FRACTAL_FUNCTION parameter
+        DoubleDouble centreX;
+        DoubleDouble centreY;
+        double span = 2.0; //width (and height) of the view in the complex plane
+        int width = 0;
+        int height = 0;
+
+        bool operator==(const View& other) const
+        {
+            return fractal == other.fractal && centreX == other.centreX && centreY == other.centreY
+                && span == other.span && width == other.width && height == other.height;
+        }
+    };
+
+    //Smallest span that can be rendered (limited by the double-double precision of the centre)
+    static constexpr double minSpan = 1e-28;
+
+    FractalRenderer();
+    ~FractalRenderer() override;
+
+    //Renders the view asynchronously, a change message is sent when the image is ready
+    void requestRender(const View& view);
+
+    juce::Image getImage() const;
+
+private:
+
+    void run() override;
+
+    //Returns false if the render was interrupted by a new request
+    bool render(const View& view, juce::Image& result);
+
+    //Iterates the reference orbit from the given point, returns the number of points stored
+    int computeReferenceOrbit(int fractal, DoubleDouble cx, DoubleDouble cy, int maxIterations);
+
+    //Slow fallback for the pixels that are still glitched after all the references
+    static int iterateDirect(int fractal, DoubleDouble cx, DoubleDouble cy, int maxIterations) noexcept;
+
+    static juce::Colour getColour(int iterations, int maxIterations) noexcept;
+
+    static constexpr int glitched = DspKernels::glitched;
+
+    static constexpr int maxReferences = 5;
+
+    std::vector<double> referenceX;
+    std::vector<double> referenceY;
+
+    mutable juce::CriticalSection lock;
+    View pendingView;
+    bool hasPendingView = false;
+    juce::Image image;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FractalRenderer)
+};
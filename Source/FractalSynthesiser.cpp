@@ -0,0 +1,269 @@
+/*
+  ==============================================================================
+
+    FractalSynthesiser.cpp
+    Created: 23 Oct 2026 10:14:22am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "FractalSynthesiser.h"
+
+FractalSynthesiser::FractalSynthesiser()
+{
+    //Never re-allocated, so the audio thread can walk the links while voices are added
+    links.reserve(maxVoices);
+    noteVoices.fill(-1);
+}
+
+void FractalSynthesiser::updateVoiceLists()
+{
+    const juce::ScopedLock sl(lock);
+
+    jassert(voices.size() <= maxVoices);
+
+    for (auto index = (int)links.size(); index < juce::jmin(voices.size(), maxVoices); ++index)
+    {
+        links.emplace_back();
+        append(index, freeList);
+        updateVoiceState(index);
+    }
+}
+
+void FractalSynthesiser::noteOn(int midiChannel, int midiNoteNumber, float velocity)
+{
+    const juce::ScopedLock sl(lock);
+
+    for (auto* sound : sounds)
+    {
+        if (!sound->appliesToNote(midiNoteNumber) || !sound->appliesToChannel(midiChannel))
+            continue;
+
+        auto key = getKey(midiChannel, midiNoteNumber);
+
+        //A note still ringing on the same key (held by the pedal or in its release) is stopped first
+        if (noteVoices[(size_t)key] >= 0)
+        {
+            auto ringing = noteVoices[(size_t)key];
+            auto* ringingVoice = voices.getUnchecked(ringing);
+
+            if (ringingVoice->getCurrentlyPlayingNote() == midiNoteNumber && ringingVoice->isPlayingChannel(midiChannel))
+                stopVoice(ringingVoice, 1.0f, true);
+
+            updateVoiceState(ringing);
+        }
+
+        auto index = allocateVoice();
+
+        if (index < 0)
+            return;
+
+        auto& voiceLinks = links[(size_t)index];
+
+        //A stolen voice forgets its old note
+        if (voiceLinks.key >= 0 && noteVoices[(size_t)voiceLinks.key] == index)
+            noteVoices[(size_t)voiceLinks.key] = -1;
+
+        auto* voice = voices.getUnchecked(index);
+
+        if (onVoiceStarting != nullptr)
+            onVoiceStarting(*voice);
+
+        startVoice(voice, sound, midiChannel, midiNoteNumber, velocity);
+
+        auto channelIndex = (size_t)(juce::jlimit(1, 16, midiChannel) - 1);
+        voice->controllerMoved(1, modWheelValues[channelIndex]);
+        voice->channelPressureChanged(channelPressureValues[channelIndex]);
+
+        noteVoices[(size_t)key] = index;
+        voiceLinks.key = key;
+
+        unlink(index);
+        append(index, heldList);
+    }
+}
+
+void FractalSynthesiser::noteOff(int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff)
+{
+    const juce::ScopedLock sl(lock);
+
+    auto index = noteVoices[(size_t)getKey(midiChannel, midiNoteNumber)];
+
+    if (index < 0)
+        return;
+
+    auto* voice = voices.getUnchecked(index);
+
+    if (voice->getCurrentlyPlayingNote() != midiNoteNumber || !voice->isPlayingChannel(midiChannel))
+        return;
+
+    if (auto sound = voice->getCurrentlyPlayingSound())
+    {
+        if (sound->appliesToNote(midiNoteNumber) && sound->appliesToChannel(midiChannel))
+        {
+            voice->setKeyDown(false);
+
+            //Same as juce::Synthesiser: the pedals keep the note going
+            if (!(voice->isSustainPedalDown() || voice->isSostenutoPedalDown()))
+                stopVoice(voice, velocity, allowTailOff);
+        }
+    }
+
+    updateVoiceState(index);
+}
+
+void FractalSynthesiser::allNotesOff(int midiChannel, bool allowTailOff)
+{
+    const juce::ScopedLock sl(lock);
+
+    juce::Synthesiser::allNotesOff(midiChannel, allowTailOff);
+
+    //Rare, every voice is checked
+    for (int index = 0; index < (int)links.size(); ++index)
+        updateVoiceState(index);
+}
+
+void FractalSynthesiser::handleController(int midiChannel, int controllerNumber, int controllerValue)
+{
+    if (controllerNumber == 1 && midiChannel >= 1 && midiChannel <= 16)
+        modWheelValues[(size_t)midiChannel - 1] = controllerValue;
+
+    juce::Synthesiser::handleController(midiChannel, controllerNumber, controllerValue);
+}
+
+void FractalSynthesiser::handleChannelPressure(int midiChannel, int channelPressureValue)
+{
+    if (midiChannel >= 1 && midiChannel <= 16)
+        channelPressureValues[(size_t)midiChannel - 1] = channelPressureValue;
+
+    juce::Synthesiser::handleChannelPressure(midiChannel, channelPressureValue);
+}
+
+void FractalSynthesiser::renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+{
+    //The segments between two MIDI events are split further, the voices keep their state between the microblocks
+    auto step = microblockSize > 0 ? microblockSize : numSamples;
+
+    for (int position = 0; position < numSamples; position += step)
+    {
+        auto length = juce::jmin(step, numSamples - position);
+
+        //Only the playing voices are visited. A voice that ends in a microblock returns immediately in the next ones
+        for (auto list : { heldList, releasedList })
+        {
+            for (auto index = lists[list].head; index >= 0; index = links[(size_t)index].next)
+                voices.getUnchecked(index)->renderNextBlock(outputAudio, startSample + position, length);
+        }
+    }
+
+    //Voices released by the sustain pedal or finished in this segment change list
+    for (auto list : { heldList, releasedList })
+    {
+        for (auto index = lists[list].head; index >= 0;)
+        {
+            auto next = links[(size_t)index].next;
+            updateVoiceState(index);
+            index = next;
+        }
+    }
+}
+
+void FractalSynthesiser::unlink(int index) noexcept
+{
+    auto& voiceLinks = links[(size_t)index];
+    auto& list = lists[(size_t)voiceLinks.list];
+
+    if (voiceLinks.previous >= 0)
+        links[(size_t)voiceLinks.previous].next = voiceLinks.next;
+    else
+        list.head = voiceLinks.next;
+
+    if (voiceLinks.next >= 0)
+        links[(size_t)voiceLinks.next].previous = voiceLinks.previous;
+    else
+        list.tail = voiceLinks.previous;
+
+    voiceLinks.previous = voiceLinks.next = -1;
+    --list.size;
+}
+
+void FractalSynthesiser::append(int index, int listId) noexcept
+{
+    auto& voiceLinks = links[(size_t)index];
+    auto& list = lists[(size_t)listId];
+
+    voiceLinks.list = listId;
+    voiceLinks.previous = list.tail;
+    voiceLinks.next = -1;
+
+    if (list.tail >= 0)
+        links[(size_t)list.tail].next = index;
+    else
+        list.head = index;
+
+    list.tail = index;
+    ++list.size;
+}
+
+void FractalSynthesiser::updateVoiceState(int index) noexcept
+{
+    auto* voice = voices.getUnchecked(index);
+    auto& voiceLinks = links[(size_t)index];
+
+    auto list = !voice->isVoiceActive() ? freeList : (voice->isPlayingButReleased() ? releasedList : heldList);
+
+    if (list == voiceLinks.list)
+        return;
+
+    if (list == freeList && voiceLinks.key >= 0)
+    {
+        if (noteVoices[(size_t)voiceLinks.key] == index)
+            noteVoices[(size_t)voiceLinks.key] = -1;
+
+        voiceLinks.key = -1;
+    }
+
+    unlink(index);
+    append(index, list);
+}
+
+int FractalSynthesiser::allocateVoice() const noexcept
+{
+    if (getNumActiveVoices() < polyphony && lists[freeList].head >= 0)
+        return lists[freeList].head;
+
+    if (!isNoteStealingEnabled())
+        return -1;
+
+    //Released voices are the least audible ones, then the held notes
+    if (lists[releasedList].head >= 0)
+        return findVoiceToSteal(releasedList);
+
+    return findVoiceToSteal(heldList);
+}
+
+int FractalSynthesiser::findVoiceToSteal(int list) const noexcept
+{
+    auto quietest = lists[(size_t)list].head;
+
+    if (quietest < 0 || getVoiceLevel == nullptr)
+        return quietest;
+
+    auto quietestLevel = getVoiceLevel(*voices.getUnchecked(quietest));
+    auto index = links[(size_t)quietest].next;
+
+    //On equal levels the oldest voice goes
+    for (int candidate = 1; candidate < maxStealCandidates && index >= 0; ++candidate, index = links[(size_t)index].next)
+    {
+        auto level = getVoiceLevel(*voices.getUnchecked(index));
+
+        if (level < quietestLevel)
+        {
+            quietest = index;
+            quietestLevel = level;
+        }
+    }
+
+    return quietest;
+}
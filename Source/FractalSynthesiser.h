@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    FractalSynthesiser.h
+    Created: 23 Oct 2026 10:14:05am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//Synthesiser that renders all its voices together one microblock at a time (so the buffers stay in the caches),
+//with voice lists and a note map for constant time allocation
+class FractalSynthesiser : public juce::Synthesiser
+{
+public:
+
+    static constexpr int maxVoices = 256;
+
+    FractalSynthesiser();
+
+    //Samples rendered by every voice before moving to the next one (0: the whole segment, like juce::Synthesiser)
+    void setMicroblockSize(int newSize) noexcept { microblockSize = juce::jmax(0, newSize); }
+    int getMicroblockSize() const noexcept { return microblockSize; }
+
+    //Links the voices added with addVoice since the last call to the free list (not realtime safe)
+    void updateVoiceLists();
+
+    //Notes that can sound at the same time (the voices above the limit stay free), audio thread
+    void setPolyphony(int newPolyphony) noexcept { polyphony = juce::jlimit(1, maxVoices, newPolyphony); }
+
+    int getNumActiveVoices() const noexcept { return lists[heldList].size + lists[releasedList].size; }
+
+    //Called just before a voice starts a note (audio thread), so that its settings can be brought up to date
+    //without updating all the free voices in every block
+    std::function<void(juce::SynthesiserVoice&)> onVoiceStarting;
+
+    //Current level of a playing voice, used to steal the quietest one (audio thread, optional)
+    std::function<float(juce::SynthesiserVoice&)> getVoiceLevel;
+
+    //Calls function(voice) for the voices that are playing, oldest first
+    template <typename Function>
+    void forEachActiveVoice(Function&& function)
+    {
+        const juce::ScopedLock sl(lock);
+
+        for (auto list : { heldList, releasedList })
+        {
+            for (auto index = lists[list].head; index >= 0; index = links[(size_t)index].next)
+                function(*voices.getUnchecked(index));
+        }
+    }
+
+    void noteOn(int midiChannel, int midiNoteNumber, float velocity) override;
+    void noteOff(int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff) override;
+    void allNotesOff(int midiChannel, bool allowTailOff) override;
+
+    //The last mod wheel and pressure of each channel are also given to the voices that start later
+    void handleController(int midiChannel, int controllerNumber, int controllerValue) override;
+    void handleChannelPressure(int midiChannel, int channelPressureValue) override;
+
+protected:
+
+    using juce::Synthesiser::renderVoices;
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override;
+
+private:
+
+    enum ListId
+    {
+        freeList,
+        heldList,
+        releasedList,
+        numLists
+    };
+
+    struct VoiceList
+    {
+        int head = -1;
+        int tail = -1;
+        int size = 0;
+    };
+
+    struct VoiceLinks
+    {
+        int previous = -1;
+        int next = -1;
+        int list = freeList;
+        int key = -1; //entry of noteVoices that points to the voice
+    };
+
+    static int getKey(int midiChannel, int midiNoteNumber) noexcept
+    {
+        return (juce::jlimit(1, 16, midiChannel) - 1) * 128 + juce::jlimit(0, 127, midiNoteNumber);
+    }
+
+    void unlink(int index) noexcept;
+    void append(int index, int list) noexcept;
+
+    //Moves a voice to the list that matches its state (e.g. after its note off or the end of its tail)
+    void updateVoiceState(int index) noexcept;
+
+    //Free voice, or the voice to steal (-1 if stealing is disabled)
+    int allocateVoice() const noexcept;
+
+    //Oldest voices of a list compared by level when one must be stolen
+    static constexpr int maxStealCandidates = 8;
+
+    //Quietest of the oldest voices of a list (-1 if it is empty)
+    int findVoiceToSteal(int list) const noexcept;
+
+    int microblockSize = 0;
+    int polyphony = maxVoices;
+
+    std::vector<VoiceLinks> links; //one per voice, same index as in voices
+    std::array<VoiceList, numLists> lists;
+    std::array<int, 16 * 128> noteVoices; //-1: no voice
+
+    std::array<int, 16> modWheelValues{};
+    std::array<int, 16> channelPressureValues{};
+};
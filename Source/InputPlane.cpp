@@ -11,12 +11,31 @@
 #include "InputPlane.h"
 #include <JuceHeader.h>
 
-InputPlane::InputPlane(juce::Slider& sliderX, juce::Slider& sliderY) : sliderX(sliderX), sliderY(sliderY)
+InputPlane::InputPlane(FractalSynthesisAudioProcessor& processor, juce::Slider& sliderX, juce::Slider& sliderY)
+    : processor(processor), sliderX(sliderX), sliderY(sliderY), timbreMap(processor.getSharedResources().getTimbreMap())
 {
 
     sliderX.addListener(this);
     sliderY.addListener(this);
 
+    renderer.addChangeListener(this);
+
+    timbreMap.addChangeListener(this);
+    timbreMap.load();
+
+    updateTimer();
+
+}
+
+InputPlane::~InputPlane()
+{
+    endSeedGesture();
+
+    timbreMap.removeChangeListener(this);
+    renderer.removeChangeListener(this);
+
+    sliderX.removeListener(this);
+    sliderY.removeListener(this);
 }
 
 void InputPlane::paint(juce::Graphics& g)
@@ -29,43 +48,159 @@ void InputPlane::paint(juce::Graphics& g)
 
     g.fillAll(juce::Colour::fromRGB(0, 0, 0));
 
+    g.drawImageWithin(renderer.getImage(), 0, 0, width, height, juce::RectanglePlacement::stretchToFit);
+
+    //The heatmap covers the range of the INITIAL_POINT params, one cell per grid point
+    if (heatmap.isValid())
+    {
+        auto topLeft = getPositionInView(inputMin, inputMax);
+        auto bottomRight = getPositionInView(inputMax, inputMin);
+
+        g.setImageResamplingQuality(juce::Graphics::lowResamplingQuality);
+        g.drawImage(heatmap, juce::Rectangle<float>(topLeft, bottomRight));
+    }
+
+    g.setColour(juce::Colours::orange);
+
+    for (auto& match : similarPoints)
+    {
+        auto position = getPositionInView(match.x, match.y);
+        g.drawRect(juce::Rectangle<float>(7, 7).withCentre(position), 1.5f);
+    }
+
     g.setColour(juce::Colours::aliceblue);
 
-    //Inverse mapping
-    float x = (sliderX.getValue() - inputMin) * width / r;
-    float y = height - (sliderY.getValue() - inputMin) * height / r;
+    //Inverse mapping (relative to the centre of the view, in double-double precision)
+    DoubleDouble seedX, seedY;
+    processor.getSeedPoint(part, seedX, seedY);
+
+    float x = (float)(((double)(seedX - centreX) / span + 0.5) * width);
+    float y = (float)((0.5 - (double)(seedY - centreY) / span) * height);
 
     g.drawEllipse(x, y, 5, 5, 1);
 
+    //Show the zoom level once zoomed in
+    if (span < r)
+    {
+        //Scientific notation past x1000, deep zooms go down to FractalRenderer::minSpan
+        auto zoom = r / span;
+        auto zoomText = "x" + (zoom < 1000.0 ? juce::String(zoom, 1) : juce::String(zoom, 2, true));
+
+        g.setFont(11.0f);
+        g.drawText(zoomText, area.reduced(3), juce::Justification::bottomRight);
+    }
+
+    if (timbreMap.isBuilding())
+    {
+        g.setFont(11.0f);
+        g.drawText("Building timbre map " + juce::String(juce::roundToInt(timbreMap.getBuildProgress() * 100)) + "%",
+            area.reduced(3), juce::Justification::bottomLeft);
+    }
+
 }
 
 void InputPlane::resized()
 {
+    requestRender();
 }
 
 void InputPlane::mouseDown(const juce::MouseEvent& event)
 {
+    if (event.mods.isPopupMenu())
+    {
+        showTimbreMapMenu();
+        return;
+    }
 
-    auto area = getLocalBounds();
+    if (event.mods.isAltDown() || event.mods.isMiddleButtonDown())
+    {
+        isPanning = true;
+        panStartCentreX = centreX;
+        panStartCentreY = centreY;
+        return;
+    }
 
-    int width = area.getWidth();
-    int height = area.getHeight();
+    isPanning = false;
 
-    float x = (float)event.getMouseDownX() * r / width + inputMin;
+    beginSeedGesture();
+    mouseDrag(event);
+}
 
-    //First flip the y (since the coordinate system used by the graphics component has the y reversed
-    //compared to the usual cartesian coordinate system)
-    float y = height - event.getMouseDownY();
+void InputPlane::mouseDrag(const juce::MouseEvent& event)
+{
+    if (isPanning)
+    {
+        auto offset = event.position - event.mouseDownPosition;
 
-    //Then map range
-    y = y * r / height + inputMin;
+        centreX = panStartCentreX - DoubleDouble(offset.x * span / getWidth());
+        centreY = panStartCentreY + DoubleDouble(offset.y * span / getHeight());
 
+        requestRender();
+        repaint();
+        return;
+    }
 
-    sliderX.setValue(x);
-    sliderY.setValue(y);
+    if (!isMovingSeed)
+        return;
 
-    repaint();
+    //Map the mouse to the plane (the y of the graphics component is flipped
+    //compared to the usual cartesian coordinate system, getOffsetY takes care of it)
+    moveSeed(centreX + getOffsetX(event.position.x), centreY + getOffsetY(event.position.y));
+}
 
+void InputPlane::mouseUp(const juce::MouseEvent& event)
+{
+    isPanning = false;
+    endSeedGesture();
+}
+
+void InputPlane::mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel)
+{
+    if (event.mods.isCommandDown() || event.mods.isCtrlDown())
+    {
+        zoom(event.position, std::pow(0.5, wheel.deltaY * 4.0));
+        return;
+    }
+
+    //A notch of the wheel (a delta of about 0.25) moves the seed by an eighth of the view
+    auto direction = wheel.isReversed ? -1.0 : 1.0;
+    auto deltaX = -direction * wheel.deltaX * span * 0.5;
+    auto deltaY = direction * wheel.deltaY * span * 0.5;
+
+    if (deltaX == 0 && deltaY == 0)
+        return;
+
+    //The gesture ends when the wheel stops (the timer checks it)
+    if (!isMovingSeed)
+        beginSeedGesture();
+
+    lastWheelTime = juce::Time::getMillisecondCounter();
+
+    DoubleDouble seedX, seedY;
+    processor.getSeedPoint(part, seedX, seedY);
+
+    if (isSeedPending)
+    {
+        seedX = pendingSeedX;
+        seedY = pendingSeedY;
+    }
+
+    moveSeed(seedX + DoubleDouble(deltaX), seedY + DoubleDouble(deltaY));
+}
+
+void InputPlane::mouseMagnify(const juce::MouseEvent& event, float scaleFactor)
+{
+    zoom(event.position, 1.0 / scaleFactor);
+}
+
+void InputPlane::mouseDoubleClick(const juce::MouseEvent& event)
+{
+    centreX = 0.0;
+    centreY = 0.0;
+    span = r;
+
+    requestRender();
+    repaint();
 }
 
 void InputPlane::sliderValueChanged(juce::Slider* slider)
@@ -79,3 +214,229 @@ void InputPlane::sliderValueChanged(juce::Slider* slider)
     repaint();
 }
 
+void InputPlane::setFractal(int fractalIndex)
+{
+    fractal = fractalIndex;
+    similarPoints.clear();
+    updateHeatmap();
+    requestRender();
+}
+
+void InputPlane::setPart(int partIndex)
+{
+    endSeedGesture();
+
+    part = partIndex;
+    repaint();
+}
+
+void InputPlane::changeListenerCallback(juce::ChangeBroadcaster* source)
+{
+    if (source == &timbreMap)
+    {
+        //A new index was mapped (or the old one was dropped)
+        similarPoints.clear();
+        updateHeatmap();
+    }
+
+    repaint();
+}
+
+void InputPlane::timerCallback()
+{
+    if (isMovingSeed)
+    {
+        sendSeedToParameters();
+
+        if (!isMouseButtonDown() && juce::Time::getMillisecondCounter() - lastWheelTime > wheelGestureTimeout)
+            endSeedGesture();
+    }
+
+    if (timbreMap.isBuilding())
+        repaint();
+
+    updateTimer();
+}
+
+void InputPlane::updateTimer()
+{
+    if (isMovingSeed)
+        startTimerHz(parameterUpdateRate);
+    else if (timbreMap.isBuilding())
+        startTimerHz(4);
+    else
+        stopTimer();
+}
+
+void InputPlane::beginSeedGesture()
+{
+    endSeedGesture();
+
+    auto prefix = SynthPart::getParameterPrefix(part);
+    parameterX = processor.apvts.getParameter(prefix + "INITIAL_POINT_X");
+    parameterY = processor.apvts.getParameter(prefix + "INITIAL_POINT_Y");
+
+    if (parameterX == nullptr || parameterY == nullptr)
+        return;
+
+    parameterX->beginChangeGesture();
+    parameterY->beginChangeGesture();
+
+    isMovingSeed = true;
+    lastWheelTime = juce::Time::getMillisecondCounter();
+    updateTimer();
+}
+
+void InputPlane::moveSeed(DoubleDouble x, DoubleDouble y)
+{
+    //Seeds outside the range of the parameters are clamped
+    if ((double)x < inputMin || (double)x > inputMax)
+        x = juce::jlimit((double)inputMin, (double)inputMax, (double)x);
+
+    if ((double)y < inputMin || (double)y > inputMax)
+        y = juce::jlimit((double)inputMin, (double)inputMax, (double)y);
+
+    //Keep the full precision in the processor, the parameters only get the rounded values
+    processor.setSeedPoint(part, x, y);
+
+    pendingSeedX = x;
+    pendingSeedY = y;
+    isSeedPending = true;
+
+    repaint();
+}
+
+void InputPlane::endSeedGesture()
+{
+    if (!isMovingSeed)
+        return;
+
+    sendSeedToParameters();
+
+    parameterX->endChangeGesture();
+    parameterY->endChangeGesture();
+
+    isMovingSeed = false;
+    updateTimer();
+}
+
+void InputPlane::sendSeedToParameters()
+{
+    if (!isSeedPending)
+        return;
+
+    //The attachments move the sliders
+    parameterX->setValueNotifyingHost(parameterX->convertTo0to1((float)(double)pendingSeedX));
+    parameterY->setValueNotifyingHost(parameterY->convertTo0to1((float)(double)pendingSeedY));
+
+    isSeedPending = false;
+}
+
+void InputPlane::showTimbreMapMenu()
+{
+    auto loaded = timbreMap.isLoaded();
+
+    //Ids of the heatmap items: 1 + descriptor (1 is none)
+    juce::PopupMenu heatmapMenu;
+    heatmapMenu.addItem(1, "None", true, heatmapDescriptor < 0);
+    heatmapMenu.addItem(2 + TimbreMap::brightness, "Brightness", loaded, heatmapDescriptor == TimbreMap::brightness);
+    heatmapMenu.addItem(2 + TimbreMap::inharmonicity, "Inharmonicity", loaded, heatmapDescriptor == TimbreMap::inharmonicity);
+    heatmapMenu.addItem(2 + TimbreMap::tremoloRate, "Tremolo rate", loaded, heatmapDescriptor == TimbreMap::tremoloRate);
+
+    juce::PopupMenu menu;
+    menu.addSubMenu("Timbre heatmap", heatmapMenu);
+    menu.addItem(findSimilarItem, "Find points that sound like this one", loaded);
+    menu.addItem(clearSimilarItem, "Clear similar points", !similarPoints.isEmpty());
+    menu.addSeparator();
+    menu.addItem(buildItem, loaded ? "Rebuild timbre map" : "Build timbre map", !timbreMap.isBuilding());
+
+    //The callback is dropped if the plane is deleted while the menu is open
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this),
+        juce::ModalCallbackFunction::forComponent(timbreMapMenuCallback, this));
+}
+
+void InputPlane::timbreMapMenuCallback(int result, InputPlane* plane)
+{
+    if (plane == nullptr || result == 0)
+        return;
+
+    switch (result)
+    {
+    case findSimilarItem:
+        plane->findSimilarPoints();
+        break;
+    case clearSimilarItem:
+        plane->similarPoints.clear();
+        plane->repaint();
+        break;
+    case buildItem:
+        plane->timbreMap.build();
+        plane->updateTimer();
+        break;
+    default:
+        plane->heatmapDescriptor = result - 2;
+        plane->updateHeatmap();
+        break;
+    }
+}
+
+void InputPlane::updateHeatmap()
+{
+    heatmap = heatmapDescriptor >= 0 ? timbreMap.createHeatmap(fractal, heatmapDescriptor) : juce::Image();
+    repaint();
+}
+
+void InputPlane::findSimilarPoints()
+{
+    DoubleDouble seedX, seedY;
+    processor.getSeedPoint(part, seedX, seedY);
+
+    similarPoints = timbreMap.findSimilar(fractal, (double)seedX, (double)seedY, 8);
+    repaint();
+}
+
+juce::Point<float> InputPlane::getPositionInView(double x, double y) const
+{
+    return { (float)(((x - (double)centreX) / span + 0.5) * getWidth()),
+             (float)((0.5 - (y - (double)centreY) / span) * getHeight()) };
+}
+
+void InputPlane::requestRender()
+{
+    FractalRenderer::View view;
+    view.fractal = fractal;
+    view.centreX = centreX;
+    view.centreY = centreY;
+    view.span = span;
+    view.width = getWidth();
+    view.height = getHeight();
+
+    renderer.requestRender(view);
+}
+
+void InputPlane::zoom(juce::Point<float> position, double factor)
+{
+    auto newSpan = juce::jlimit(FractalRenderer::minSpan, (double)r, span * factor);
+
+    //Move the centre so that the point under the mouse stays where it is
+    auto offsetX = getOffsetX(position.x);
+    auto offsetY = getOffsetY(position.y);
+
+    centreX = centreX + DoubleDouble(offsetX * (1.0 - newSpan / span));
+    centreY = centreY + DoubleDouble(offsetY * (1.0 - newSpan / span));
+
+    span = newSpan;
+
+    requestRender();
+    repaint();
+}
+
+double InputPlane::getOffsetX(float x) const
+{
+    return ((double)x / getWidth() - 0.5) * span;
+}
+
+double InputPlane::getOffsetY(float y) const
+{
+    return (0.5 - (double)y / getHeight()) * span;
+}
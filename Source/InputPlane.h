@@ -12,21 +12,93 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "FractalRenderer.h"
 
-class InputPlane : public juce::Component, juce::Slider::Listener
+class InputPlane : public juce::Component, juce::Slider::Listener, juce::ChangeListener, private juce::Timer
 {
 public:
-    InputPlane(juce::Slider& sliderX, juce::Slider& sliderY);
+    InputPlane(FractalSynthesisAudioProcessor& processor, juce::Slider& sliderX, juce::Slider& sliderY);
+    ~InputPlane() override;
 
     void paint(juce::Graphics& g) override;
     void resized() override;
 
+    //Click or drag: move the seed point, alt (or middle button) drag: pan, right click: timbre map menu
     void mouseDown(const juce::MouseEvent& event) override;
+    void mouseDrag(const juce::MouseEvent& event) override;
+    void mouseUp(const juce::MouseEvent& event) override;
+
+    //Wheel: move the seed point, cmd/ctrl + wheel or pinch: zoom, double click: reset the view
+    void mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel) override;
+    void mouseMagnify(const juce::MouseEvent& event, float scaleFactor) override;
+    void mouseDoubleClick(const juce::MouseEvent& event) override;
 
     void sliderValueChanged(juce::Slider* slider);
 
+    //Index as the FRACTAL_FUNCTION parameter
+    void setFractal(int fractalIndex);
+
+    //Part whose seed point is shown and edited
+    void setPart(int partIndex);
+
 private:
 
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
+
+    //Sends the seed of a gesture to the parameters, ends the wheel gestures and repaints the progress
+    //while the timbre map is being built
+    void timerCallback() override;
+    void updateTimer();
+
+    //A seed gesture (drag or wheel) sends every position to the processor as one x, y update, so the audio thread
+    //recomputes the orbit at most once per block with both coordinates. The parameters (and the host automation)
+    //only get the latest position at parameterUpdateRate, between a begin and an end of gesture
+    void beginSeedGesture();
+    void moveSeed(DoubleDouble x, DoubleDouble y);
+    void endSeedGesture();
+    void sendSeedToParameters();
+
+    static constexpr int parameterUpdateRate = 30; //Hz
+    static constexpr juce::uint32 wheelGestureTimeout = 300; //ms without wheel moves that end its gesture
+
+    bool isMovingSeed = false;
+    bool isSeedPending = false;
+    juce::uint32 lastWheelTime = 0;
+
+    DoubleDouble pendingSeedX;
+    DoubleDouble pendingSeedY;
+
+    //Parameters of the part being edited during a gesture
+    juce::RangedAudioParameter* parameterX = nullptr;
+    juce::RangedAudioParameter* parameterY = nullptr;
+
+    void showTimbreMapMenu();
+    static void timbreMapMenuCallback(int result, InputPlane* plane);
+
+    //Ids of the menu items after the heatmap ones
+    enum TimbreMapMenuItems
+    {
+        findSimilarItem = 100,
+        clearSimilarItem,
+        buildItem
+    };
+
+    void updateHeatmap();
+
+    //Marks the grid points of the timbre map that sound like the current seed point
+    void findSimilarPoints();
+
+    //Position of a point of the plane in the component
+    juce::Point<float> getPositionInView(double x, double y) const;
+
+    void requestRender();
+
+    //Zooms keeping the given point of the component still
+    void zoom(juce::Point<float> position, double factor);
+
+    //Offset of a point of the component from the centre of the view (in plane units)
+    double getOffsetX(float x) const;
+    double getOffsetY(float y) const;
 
     //Bounds for the input plane (actual "transformed" coordinates)
     //(Assuming a square so the bounds are the same for x and y)
@@ -34,7 +106,31 @@ private:
     const float inputMin = -1;
     const float r = inputMax - inputMin;
 
+    FractalSynthesisAudioProcessor& processor;
+
     juce::Slider& sliderX;
     juce::Slider& sliderY;
 
+    FractalRenderer renderer;
+
+    int fractal = 0;
+    int part = 0;
+
+    //Current view (the centre is kept in double-double precision to allow deep zooms)
+    DoubleDouble centreX;
+    DoubleDouble centreY;
+    double span = r;
+
+    TimbreMap& timbreMap;
+
+    //-1: no heatmap, otherwise a TimbreMap::Descriptor
+    int heatmapDescriptor = -1;
+    juce::Image heatmap;
+
+    juce::Array<TimbreMap::Match> similarPoints;
+
+    bool isPanning = false;
+    DoubleDouble panStartCentreX;
+    DoubleDouble panStartCentreY;
+
 };
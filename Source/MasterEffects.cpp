@@ -0,0 +1,222 @@
+/*
+  ==============================================================================
+
+    MasterEffects.cpp
+    Created: 21 Oct 2026 4:11:52pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "MasterEffects.h"
+
+MasterEffects::MasterEffects(juce::AudioProcessorValueTreeState& apvts)
+{
+    delayLevel = apvts.getRawParameterValue("DELAY_LEVEL");
+    delayDivision = apvts.getRawParameterValue("DELAY_DIVISION");
+    delayFeedback = apvts.getRawParameterValue("DELAY_FEEDBACK");
+    reverbLevel = apvts.getRawParameterValue("REVERB_LEVEL");
+    reverbDecay = apvts.getRawParameterValue("REVERB_DECAY");
+    reverbDamping = apvts.getRawParameterValue("REVERB_DAMPING");
+    reverbLines = apvts.getRawParameterValue("REVERB_LINES");
+    limiterOn = apvts.getRawParameterValue("LIMITER");
+    limiterCeiling = apvts.getRawParameterValue("LIMITER_CEILING");
+    limiterRelease = apvts.getRawParameterValue("LIMITER_RELEASE");
+}
+
+void MasterEffects::addParameters(std::vector<std::unique_ptr<juce::RangedAudioParameter>>& params)
+{
+    //Both effects are off by default, so the old patches sound the same
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("DELAY_LEVEL", "Delay level", 0.0f, 1.0f, 0.0f));
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("DELAY_DIVISION", "Delay time",
+        juce::StringArray("1/16", "1/8 triplet", "1/8", "1/8 dotted", "1/4", "1/4 dotted", "1/2"), 4));
+
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("DELAY_FEEDBACK", "Delay feedback", 0.0f, 0.95f, 0.4f));
+
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("REVERB_LEVEL", "Reverb level", 0.0f, 1.0f, 0.0f));
+
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("REVERB_DECAY", "Reverb decay",
+        juce::NormalisableRange<float> {0.2f, 10.0f, 0.01f, 0.5f}, 2.0f));
+
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("REVERB_DAMPING", "Reverb damping", 0.0f, 1.0f, 0.4f));
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("REVERB_LINES", "Reverb density",
+        juce::StringArray("8 lines", "16 lines"), 0));
+
+    //Off by default too: it adds latency
+    params.push_back(std::make_unique<juce::AudioParameterBool>("LIMITER", "Limiter", false));
+
+    //dBTP
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("LIMITER_CEILING", "Limiter ceiling", -12.0f, 0.0f, -1.0f));
+
+    //Seconds
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("LIMITER_RELEASE", "Limiter release",
+        juce::NormalisableRange<float> {0.01f, 1.0f, 0.001f, 0.5f}, 0.1f));
+}
+
+void MasterEffects::prepare(double newSampleRate, int samplesPerBlock, int numChannels)
+{
+    sampleRate = newSampleRate;
+    preparedChannels = numChannels;
+
+    juce::dsp::ProcessSpec spec;
+    spec.sampleRate = sampleRate;
+    spec.maximumBlockSize = (juce::uint32)samplesPerBlock;
+    spec.numChannels = (juce::uint32)numChannels;
+
+    //The interpolation reads a few samples past the delay
+    delayLine.setMaximumDelayInSamples((int)std::ceil(maxDelaySeconds * sampleRate) + 4);
+    delayLine.prepare(spec);
+
+    delaySamples.reset(sampleRate, 0.05);
+
+    reverb8.prepare(sampleRate);
+    reverb16.prepare(sampleRate);
+
+    limiter.prepare(sampleRate, samplesPerBlock, numChannels);
+
+    reset();
+}
+
+void MasterEffects::reset()
+{
+    delayLine.reset();
+    delayWasOn = false;
+
+    reverb8.reset();
+    reverb16.reset();
+
+    limiter.reset();
+    limiterWasOn = false;
+}
+
+double MasterEffects::getDivisionBeats(int division)
+{
+    static constexpr double beats[] = { 0.25, 1.0 / 3.0, 0.5, 0.75, 1.0, 1.5, 2.0 };
+
+    return beats[juce::jlimit(0, (int)(sizeof(beats) / sizeof(beats[0])) - 1, division)];
+}
+
+void MasterEffects::process(juce::AudioBuffer<float>& buffer, int numSamples, double bpm) noexcept
+{
+    if (preparedChannels == 0 || buffer.getNumChannels() == 0 || numSamples <= 0)
+        return;
+
+    auto level = delayLevel->load();
+
+    if (level > 0)
+        processDelay(buffer, numSamples, bpm, level);
+    else if (delayWasOn)
+    {
+        //Switched off: the echoes left in the line must not come back when it is switched on again
+        delayLine.reset();
+        delayWasOn = false;
+    }
+
+    auto lines = (int)reverbLines->load();
+
+    if (lines != activeLines)
+    {
+        if (activeLines == 0)
+            reverb8.reset();
+        else
+            reverb16.reset();
+
+        activeLines = lines;
+    }
+
+    level = reverbLevel->load();
+
+    if (level > 0)
+    {
+        if (activeLines == 0)
+        {
+            reverb8.setParameters(reverbDecay->load(), reverbDamping->load());
+            reverb8.process(buffer, numSamples, level);
+        }
+        else
+        {
+            reverb16.setParameters(reverbDecay->load(), reverbDamping->load());
+            reverb16.process(buffer, numSamples, level);
+        }
+    }
+
+    auto limiterShouldBeOn = limiterOn->load() >= 0.5f;
+
+    if (limiterShouldBeOn && !limiterWasOn)
+        limiter.reset();
+
+    limiterWasOn = limiterShouldBeOn;
+
+    if (limiterShouldBeOn)
+    {
+        limiter.setParameters(juce::Decibels::decibelsToGain(limiterCeiling->load()), limiterRelease->load());
+        limiter.process(buffer, numSamples);
+    }
+}
+
+void MasterEffects::processDelay(juce::AudioBuffer<float>& buffer, int numSamples, double bpm, float level) noexcept
+{
+    if (bpm <= 0)
+        bpm = 120;
+
+    auto seconds = getDivisionBeats((int)delayDivision->load()) * 60.0 / juce::jmax(minBpm, bpm);
+    auto target = (float)(juce::jmin(seconds, maxDelaySeconds) * sampleRate);
+
+    if (!delayWasOn)
+    {
+        delaySamples.setCurrentAndTargetValue(target);
+        delayWasOn = true;
+    }
+    else
+    {
+        delaySamples.setTargetValue(target);
+    }
+
+    auto feedback = delayFeedback->load();
+    auto numChannels = juce::jmin(buffer.getNumChannels(), preparedChannels);
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        auto delay = delaySamples.getNextValue();
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* samples = buffer.getWritePointer(channel);
+
+            auto echo = delayLine.popSample(channel, delay);
+            delayLine.pushSample(channel, samples[n] + feedback * echo);
+
+            samples[n] += level * echo;
+        }
+    }
+}
+
+double MasterEffects::getTailLengthSeconds() const
+{
+    double tail = 0;
+
+    if (delayLevel->load() > 0)
+    {
+        //Time for the echoes to fall by 60 dB
+        auto feedback = juce::jmax(0.01f, delayFeedback->load());
+        tail = maxDelaySeconds * -3.0 / std::log10(feedback);
+    }
+
+    if (reverbLevel->load() > 0)
+        tail = juce::jmax(tail, (double)reverbDecay->load());
+
+    return tail;
+}
+
+int MasterEffects::getLatencySamples() const
+{
+    return limiterOn->load() >= 0.5f ? limiter.getLatencySamples() : 0;
+}
+
+size_t MasterEffects::getSizeInBytes() const
+{
+    return sizeof(*this) + reverb8.getSizeInBytes() + reverb16.getSizeInBytes() + limiter.getSizeInBytes()
+        + (size_t)(maxDelaySeconds * sampleRate) * (size_t)preparedChannels * sizeof(float);
+}
@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    MasterEffects.h
+    Created: 21 Oct 2026 4:11:37pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "FdnReverb.h"
+#include "TruePeakLimiter.h"
+
+//Effects of the summed output of all the parts: a tempo synced delay, the reverb and the optional limiter
+class MasterEffects
+{
+public:
+
+    explicit MasterEffects(juce::AudioProcessorValueTreeState& apvts);
+
+    static void addParameters(std::vector<std::unique_ptr<juce::RangedAudioParameter>>& params);
+
+    //Not realtime safe
+    void prepare(double sampleRate, int samplesPerBlock, int numChannels);
+    void reset();
+
+    //bpm: tempo of the host, 0 if it doesn't send one
+    void process(juce::AudioBuffer<float>& buffer, int numSamples, double bpm) noexcept;
+
+    //Longest tail with the current settings
+    double getTailLengthSeconds() const;
+
+    //Latency of the limiter while it is on (any thread)
+    int getLatencySamples() const;
+
+    //Latency of the last processed block (audio thread) and the largest one (after prepare)
+    int getProcessedLatencySamples() const noexcept { return limiterWasOn ? limiter.getLatencySamples() : 0; }
+    int getMaxLatencySamples() const noexcept { return limiter.getLatencySamples(); }
+
+    size_t getSizeInBytes() const;
+
+private:
+
+    //Longest delay: a half note at the slowest tempo
+    static constexpr double minBpm = 40;
+    static constexpr double maxDelaySeconds = 2 * 60 / minBpm;
+
+    //Beats of the DELAY_DIVISION choices
+    static double getDivisionBeats(int division);
+
+    void processDelay(juce::AudioBuffer<float>& buffer, int numSamples, double bpm, float level) noexcept;
+
+    double sampleRate = 44100;
+    int preparedChannels = 0;
+
+    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Lagrange3rd> delayLine;
+    juce::SmoothedValue<float> delaySamples; //glides when the tempo or the division change
+    bool delayWasOn = false;
+
+    //Both networks are prepared, the REVERB_LINES param picks one (the other one is reset)
+    FdnReverb<8> reverb8;
+    FdnReverb<16> reverb16;
+    int activeLines = 0;
+
+    //Reset when it is switched on, so that it doesn't play what was left in its delay line
+    TruePeakLimiter limiter;
+    bool limiterWasOn = false;
+
+    std::atomic<float>* delayLevel;
+    std::atomic<float>* delayDivision;
+    std::atomic<float>* delayFeedback;
+    std::atomic<float>* reverbLevel;
+    std::atomic<float>* reverbDecay;
+    std::atomic<float>* reverbDamping;
+    std::atomic<float>* reverbLines;
+    std::atomic<float>* limiterOn;
+    std::atomic<float>* limiterCeiling;
+    std::atomic<float>* limiterRelease;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MasterEffects)
+};
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    ModulationMatrix.cpp
+    Created: 23 Oct 2026 3:52:36pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "ModulationMatrix.h"
+
+namespace
+{
+    //The destination choice is "Off", then every type for all the partials and for each partial
+    constexpr int numDestinationTargets = ModulationMatrix::numPartials + 1;
+
+    juce::StringArray getSourceNames()
+    {
+        juce::StringArray names{ "Off" };
+
+        for (int i = 0; i < ModulationMatrix::numPartials; ++i)
+        {
+            auto point = "Point " + juce::String(i + 1);
+            names.addArray({ point + " real", point + " imag", point + " magnitude", point + " angle" });
+        }
+
+        names.addArray({ "Envelope", "Velocity", "Mod wheel", "Channel pressure" });
+        return names;
+    }
+
+    juce::StringArray getDestinationNames()
+    {
+        juce::StringArray names{ "Off" };
+
+        for (auto type : { "Pitch", "Gain", "Pan", "Tremolo depth", "Tremolo rate" })
+        {
+            names.add(juce::String(type) + " (all)");
+
+            for (int i = 0; i < ModulationMatrix::numPartials; ++i)
+                names.add(juce::String(type) + " " + juce::String(i + 1));
+        }
+
+        return names;
+    }
+}
+
+void ModulationMatrix::addParameters(const juce::String& idPrefix, const juce::String& namePrefix, std::vector<std::unique_ptr<juce::RangedAudioParameter>>& params)
+{
+    auto sourceNames = getSourceNames();
+    auto destinationNames = getDestinationNames();
+
+    for (int i = 0; i < numRoutes; ++i)
+    {
+        auto indexString = juce::String(i);
+        auto routeName = namePrefix + "Mod " + juce::String(i + 1) + " ";
+
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(idPrefix + "MOD_SOURCE" + indexString, routeName + "source", sourceNames, 0));
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(idPrefix + "MOD_DESTINATION" + indexString, routeName + "destination", destinationNames, 0));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(idPrefix + "MOD_AMOUNT" + indexString, routeName + "amount", -1.0f, 1.0f, 0.0f));
+    }
+}
+
+ModulationMatrix::ModulationMatrix(juce::AudioProcessorValueTreeState& apvts, const juce::String& idPrefix)
+{
+    for (size_t i = 0; i < numRoutes; ++i)
+    {
+        auto indexString = juce::String(i);
+
+        sourceParams[i] = apvts.getRawParameterValue(idPrefix + "MOD_SOURCE" + indexString);
+        destinationParams[i] = apvts.getRawParameterValue(idPrefix + "MOD_DESTINATION" + indexString);
+        amountParams[i] = apvts.getRawParameterValue(idPrefix + "MOD_AMOUNT" + indexString);
+    }
+}
+
+void ModulationMatrix::update() noexcept
+{
+    bool changed = false;
+
+    for (size_t i = 0; i < numRoutes; ++i)
+    {
+        auto source = (int)sourceParams[i]->load();
+        auto destination = (int)destinationParams[i]->load();
+        auto amount = amountParams[i]->load();
+
+        changed |= source != lastSources[i] || destination != lastDestinations[i] || amount != lastAmounts[i];
+
+        lastSources[i] = source;
+        lastDestinations[i] = destination;
+        lastAmounts[i] = amount;
+    }
+
+    if (!changed)
+        return;
+
+    routes.size = 0;
+    routes.usedTypes = 0;
+
+    for (size_t i = 0; i < numRoutes; ++i)
+    {
+        //Choice 0 is "Off" for both
+        auto source = lastSources[i] - 1;
+        auto destination = lastDestinations[i] - 1;
+
+        if (source < 0 || source >= numSources || destination < 0 || lastAmounts[i] == 0.0f)
+            continue;
+
+        auto type = destination / numDestinationTargets;
+        auto target = destination % numDestinationTargets - 1; //-1: all the partials
+
+        if (type >= numDestinationTypes)
+            continue;
+
+        for (int partial = 0; partial < numPartials; ++partial)
+        {
+            if (target >= 0 && partial != target)
+                continue;
+
+            auto entry = (size_t)routes.size++;
+            routes.sources[entry] = (juce::uint8)source;
+            routes.destinations[entry] = (juce::uint8)getDestinationIndex(type, partial);
+            routes.amounts[entry] = lastAmounts[i];
+        }
+
+        routes.usedTypes |= 1 << type;
+    }
+}
+
+void ModulationMatrix::computeOrbitSources(const std::vector<std::complex<double>>& fractalPoints, float* orbitSources) noexcept
+{
+    for (size_t i = 0; i < numPartials; ++i)
+    {
+        auto point = i < fractalPoints.size() ? fractalPoints[i] : std::complex<double>();
+        auto* values = orbitSources + firstOrbitSource + 4 * i;
+
+        //The bounded orbits stay within a radius of 2, the others are clipped
+        values[0] = (float)juce::jlimit(-1.0, 1.0, point.real() / 2.0);
+        values[1] = (float)juce::jlimit(-1.0, 1.0, point.imag() / 2.0);
+        values[2] = (float)juce::jlimit(-1.0, 1.0, std::abs(point) - 1.0);
+        values[3] = (float)(std::arg(point) / juce::MathConstants<double>::pi);
+    }
+}
+
+void ModulationMatrix::evaluate(const CompiledRoutes& routes, const float* sourceValues, float* destinationValues) noexcept
+{
+    std::fill_n(destinationValues, numDestinations, 0.0f);
+
+    for (int i = 0; i < routes.size; ++i)
+        destinationValues[routes.destinations[(size_t)i]] += routes.amounts[(size_t)i] * sourceValues[routes.sources[(size_t)i]];
+}
@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    ModulationMatrix.h
+    Created: 23 Oct 2026 3:52:18pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//Routes from modulation sources (the points of the fractal orbit, the envelope and the MIDI controllers of a voice)
+//to the settings of the partials. The routes of a part are compiled into flat arrays (one entry per source,
+//destination and amount) and every voice evaluates all of them in one loop at control rate, with no virtual calls:
+//adding a route only adds an iteration.
+class ModulationMatrix
+{
+public:
+
+    static constexpr int numPartials = 4;
+
+    //Route slots of a part (the MOD_SOURCE<n>, MOD_DESTINATION<n> and MOD_AMOUNT<n> params)
+    static constexpr int numRoutes = 4;
+
+    static constexpr int numOrbitSources = 4 * numPartials;
+
+    enum Source
+    {
+        //4 values for each point of the orbit: real, imag, magnitude, angle (all in -1..1, they follow the seed)
+        firstOrbitSource = 0,
+        envelope = firstOrbitSource + numOrbitSources, //follows the settings of the first partial, 0..1
+        velocity,
+        modWheel,
+        channelPressure,
+        numSources
+    };
+
+    enum DestinationType
+    {
+        pitch, //+-1 is +-1 octave
+        gain, //+-1 doubles the gain or mutes the partial
+        pan, //added to the centre
+        tremoloDepth, //added to the depth of the tremolo LFO (0..1)
+        tremoloRate, //+-1 is +-2 octaves
+        numDestinationTypes
+    };
+
+    //Destination values of a voice: numDestinationTypes blocks of numPartials values
+    static constexpr int numDestinations = numDestinationTypes * numPartials;
+
+    static int getDestinationIndex(int type, int partial) noexcept { return type * numPartials + partial; }
+
+    //A route to "all the partials" becomes one entry per partial
+    struct CompiledRoutes
+    {
+        static constexpr int capacity = numRoutes * numPartials;
+
+        int size = 0;
+        std::array<juce::uint8, capacity> sources{};
+        std::array<juce::uint8, capacity> destinations{};
+        std::array<float, capacity> amounts{};
+
+        //Bits of the destination types that some route changes (the voice skips the others)
+        int usedTypes = 0;
+    };
+
+    static void addParameters(const juce::String& idPrefix, const juce::String& namePrefix, std::vector<std::unique_ptr<juce::RangedAudioParameter>>& params);
+
+    ModulationMatrix(juce::AudioProcessorValueTreeState& apvts, const juce::String& idPrefix);
+
+    //Reads the route params again (audio thread, cheap when nothing changed)
+    void update() noexcept;
+
+    const CompiledRoutes& getRoutes() const noexcept { return routes; }
+
+    //numOrbitSources values for the seed, in the order of the Source enum
+    static void computeOrbitSources(const std::vector<std::complex<double>>& fractalPoints, float* orbitSources) noexcept;
+
+    //destinationValues gets numDestinations values (0 where nothing is routed)
+    static void evaluate(const CompiledRoutes& routes, const float* sourceValues, float* destinationValues) noexcept;
+
+private:
+
+    std::array<std::atomic<float>*, numRoutes> sourceParams, destinationParams, amountParams;
+
+    //Values of the last compilation
+    std::array<int, numRoutes> lastSources{}, lastDestinations{};
+    std::array<float, numRoutes> lastAmounts{};
+
+    CompiledRoutes routes;
+};
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    MpscQueue.h
+    Created: 20 Oct 2026 10:14:05am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//Bounded multiple producer, single consumer queue (D. Vyukov's array queue).
+//Every cell has a sequence number telling whether it is free for the producer of a given position
+//or ready for the consumer, so no locks are needed and nothing is allocated after construction.
+//Producers only retry when another producer took the same position; pop never waits.
+template <typename Type, size_t capacity>
+class MpscQueue
+{
+public:
+
+    static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "The capacity must be a power of two");
+
+    MpscQueue()
+    {
+        for (size_t i = 0; i < capacity; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    //Any thread. Returns false if the queue is full (the item is not added)
+    bool push(const Type& item) noexcept
+    {
+        auto position = enqueuePosition.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            auto& cell = cells[position & mask];
+            auto sequence = cell.sequence.load(std::memory_order_acquire);
+            auto difference = (std::intptr_t)sequence - (std::intptr_t)position;
+
+            if (difference == 0)
+            {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.item = item;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //Consumer thread only
+    bool pop(Type& item) noexcept
+    {
+        auto& cell = cells[dequeuePosition & mask];
+        auto sequence = cell.sequence.load(std::memory_order_acquire);
+
+        //The producer of this position hasn't finished writing (or the queue is empty)
+        if (sequence != dequeuePosition + 1)
+            return false;
+
+        item = cell.item;
+        cell.sequence.store(dequeuePosition + capacity, std::memory_order_release);
+        ++dequeuePosition;
+
+        return true;
+    }
+
+private:
+
+    static constexpr size_t mask = capacity - 1;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        Type item;
+    };
+
+    std::array<Cell, capacity> cells;
+
+    //Padded to separate cache lines: the producers and the consumer don't slow each other down
+    //(alignas isn't honoured for heap objects before C++17)
+    char padding1[64];
+    std::atomic<size_t> enqueuePosition{ 0 };
+    char padding2[64];
+    size_t dequeuePosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(MpscQueue)
+};
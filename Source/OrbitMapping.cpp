@@ -0,0 +1,607 @@
+/*
+  ==============================================================================
+
+    OrbitMapping.cpp
+    Created: 25 Oct 2026 6:03:11pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "OrbitMapping.h"
+
+namespace
+{
+    //Recursive descent over the tokens, the code is generated while parsing. The registers are used as a stack:
+    //the value of an expression is in the lowest register it used, everything above it is free again.
+    //The first error stops the compilation (every parse function returns -1 from then on)
+    class Compiler
+    {
+    public:
+
+        explicit Compiler(const juce::String& text) : source(text.toStdString()) {}
+
+        juce::Result compile(OrbitMapping::Program& result)
+        {
+            tokenise();
+
+            while (!failed())
+            {
+                skipSeparators();
+
+                if (peek().type == Token::end)
+                    break;
+
+                parseStatement();
+            }
+
+            if (failed())
+                return juce::Result::fail(error);
+
+            result = program;
+            return juce::Result::ok();
+        }
+
+    private:
+
+        struct Token
+        {
+            enum Type
+            {
+                end,
+                separator, //new line or ;
+                number,
+                name,
+                symbol
+            };
+
+            Type type = end;
+            std::string text;
+            double value = 0;
+            int line = 1;
+        };
+
+        std::string source;
+        std::vector<Token> tokens;
+        size_t position = 0;
+
+        using OpCode = OrbitMapping::OpCode;
+
+        OrbitMapping::Program program;
+        int numConstants = 0;
+        int nextRegister = 0;
+
+        juce::String error;
+
+        bool failed() const noexcept { return error.isNotEmpty(); }
+
+        int fail(const juce::String& message, int line)
+        {
+            if (!failed())
+                error = "Line " + juce::String(line) + ": " + message;
+
+            return -1;
+        }
+
+        int fail(const juce::String& message) { return fail(message, peek().line); }
+
+        void tokenise()
+        {
+            int line = 1;
+            size_t i = 0;
+
+            auto isNameCharacter = [](char c) { return std::isalnum((unsigned char)c) || c == '_'; };
+
+            while (i < source.size())
+            {
+                auto c = source[i];
+
+                if (c == '#' || (c == '/' && i + 1 < source.size() && source[i + 1] == '/'))
+                {
+                    while (i < source.size() && source[i] != '\n')
+                        ++i;
+                }
+                else if (c == '\n' || c == ';')
+                {
+                    tokens.push_back({ Token::separator, std::string(1, c), 0, line });
+
+                    if (c == '\n')
+                        ++line;
+
+                    ++i;
+                }
+                else if (std::isspace((unsigned char)c))
+                {
+                    ++i;
+                }
+                else if (std::isdigit((unsigned char)c) || (c == '.' && i + 1 < source.size() && std::isdigit((unsigned char)source[i + 1])))
+                {
+                    auto* start = source.c_str() + i;
+                    char* numberEnd = nullptr;
+                    auto value = std::strtod(start, &numberEnd);
+                    auto length = (size_t)(numberEnd - start);
+
+                    tokens.push_back({ Token::number, source.substr(i, length), value, line });
+                    i += length;
+                }
+                else if (std::isalpha((unsigned char)c) || c == '_')
+                {
+                    auto start = i;
+
+                    while (i < source.size() && isNameCharacter(source[i]))
+                        ++i;
+
+                    tokens.push_back({ Token::name, source.substr(start, i - start), 0, line });
+                }
+                else
+                {
+                    tokens.push_back({ Token::symbol, std::string(1, c), 0, line });
+                    ++i;
+                }
+            }
+
+            tokens.push_back({ Token::end, "", 0, line });
+        }
+
+        const Token& peek(size_t offset = 0) const noexcept
+        {
+            return tokens[juce::jmin(position + offset, tokens.size() - 1)];
+        }
+
+        const Token& next() noexcept
+        {
+            auto& token = peek();
+            position = juce::jmin(position + 1, tokens.size() - 1);
+            return token;
+        }
+
+        bool isSymbol(const char* symbol, size_t offset = 0) const noexcept
+        {
+            return peek(offset).type == Token::symbol && peek(offset).text == symbol;
+        }
+
+        bool isName(const char* name, size_t offset = 0) const noexcept
+        {
+            return peek(offset).type == Token::name && peek(offset).text == name;
+        }
+
+        bool expect(const char* symbol)
+        {
+            if (isSymbol(symbol))
+            {
+                next();
+                return true;
+            }
+
+            fail("expected " + juce::String(symbol));
+            return false;
+        }
+
+        void skipSeparators() noexcept
+        {
+            while (peek().type == Token::separator)
+                next();
+        }
+
+        int emit(OpCode op, int dst, int a = 0, int b = 0)
+        {
+            if (program.numInstructions == OrbitMapping::maxInstructions)
+                return fail("the mapping is too long (" + juce::String(OrbitMapping::maxInstructions) + " instructions at most)");
+
+            program.instructions[(size_t)program.numInstructions++] = { op, (juce::uint8)dst, (juce::uint8)a, (juce::uint8)b };
+            return dst;
+        }
+
+        //New register on top of the stack
+        int allocate()
+        {
+            if (nextRegister == OrbitMapping::maxRegisters)
+                return fail("the expression is too deeply nested");
+
+            return nextRegister++;
+        }
+
+        //Each number is stored once
+        int loadConstant(double value)
+        {
+            int index = 0;
+
+            while (index < numConstants && program.constants[(size_t)index] != value)
+                ++index;
+
+            if (index == numConstants)
+            {
+                if (numConstants == OrbitMapping::maxConstants)
+                    return fail("too many numbers (" + juce::String(OrbitMapping::maxConstants) + " at most)");
+
+                program.constants[(size_t)numConstants++] = value;
+            }
+
+            auto dst = allocate();
+            return dst < 0 ? -1 : emit(OrbitMapping::loadConstant, dst, index);
+        }
+
+        void parseStatement()
+        {
+            auto& target = next();
+            int targetIndex = -1;
+
+            if (target.type == Token::name && target.text == "detune")
+                targetIndex = OrbitMapping::detune;
+            else if (target.type == Token::name && target.text == "rate")
+                targetIndex = OrbitMapping::rate;
+            else
+            {
+                fail("expected detune[i] or rate[i]", target.line);
+                return;
+            }
+
+            if (!expect("["))
+                return;
+
+            if (!isName("i"))
+            {
+                fail("the target is set for every partial, write " + juce::String(target.text) + "[i]");
+                return;
+            }
+
+            next();
+
+            if (!expect("]") || !expect("="))
+                return;
+
+            if ((program.assignedTargets & (1 << targetIndex)) != 0)
+            {
+                fail(juce::String(target.text) + " is assigned twice", target.line);
+                return;
+            }
+
+            nextRegister = 0;
+            auto value = parseExpression();
+
+            if (value < 0)
+                return;
+
+            if (peek().type != Token::separator && peek().type != Token::end)
+            {
+                fail("unexpected " + juce::String(peek().text));
+                return;
+            }
+
+            emit(OrbitMapping::store, value, targetIndex);
+            program.assignedTargets |= 1 << targetIndex;
+        }
+
+        int parseExpression()
+        {
+            auto left = parseTerm();
+
+            while (left >= 0 && (isSymbol("+") || isSymbol("-")))
+            {
+                auto op = next().text == "+" ? OrbitMapping::add : OrbitMapping::subtract;
+                left = emitBinary(op, left, parseTerm());
+            }
+
+            return left;
+        }
+
+        int parseTerm()
+        {
+            auto left = parseUnary();
+
+            while (left >= 0 && (isSymbol("*") || isSymbol("/")))
+            {
+                auto op = next().text == "*" ? OrbitMapping::multiply : OrbitMapping::divide;
+                left = emitBinary(op, left, parseUnary());
+            }
+
+            return left;
+        }
+
+        int parseUnary()
+        {
+            if (isSymbol("-"))
+            {
+                next();
+                auto value = parseUnary();
+                return value < 0 ? -1 : emit(OrbitMapping::negate, value, value);
+            }
+
+            if (isSymbol("+"))
+                next();
+
+            return parsePower();
+        }
+
+        int parsePower()
+        {
+            auto base = parsePrimary();
+
+            //Right associative, and above the unary minus on its left: -2^2 is -4
+            if (base >= 0 && isSymbol("^"))
+            {
+                next();
+                return emitBinary(OrbitMapping::power, base, parseUnary());
+            }
+
+            return base;
+        }
+
+        //The right operand is above the left one, the result takes the place of the left one
+        int emitBinary(OpCode op, int left, int right)
+        {
+            if (left < 0 || right < 0)
+                return -1;
+
+            nextRegister = left + 1;
+            return emit(op, left, left, right);
+        }
+
+        enum ComplexValue
+        {
+            orbitPoint, //z[i]
+            seedPoint //c
+        };
+
+        bool isComplexValue() const noexcept
+        {
+            return (isName("z") && isSymbol("[", 1)) || (isName("c") && isSymbol(")", 1));
+        }
+
+        //z[i] or c, only as the argument of re, im, abs and arg
+        int parseComplexValue()
+        {
+            if (isName("c"))
+            {
+                next();
+                return seedPoint;
+            }
+
+            next();
+
+            if (!expect("["))
+                return -1;
+
+            if (!isName("i"))
+                return fail("only the point of the partial can be read, write z[i]");
+
+            next();
+            return expect("]") ? orbitPoint : -1;
+        }
+
+        int parsePrimary()
+        {
+            auto& token = peek();
+
+            if (token.type == Token::number)
+            {
+                next();
+                return loadConstant(token.value);
+            }
+
+            if (isSymbol("("))
+            {
+                next();
+                auto value = parseExpression();
+                return value >= 0 && expect(")") ? value : -1;
+            }
+
+            if (token.type != Token::name)
+                return fail(token.type == Token::end || token.type == Token::separator ? juce::String("unexpected end of the expression")
+                                                                                        : "unexpected " + juce::String(token.text));
+
+            auto name = next().text;
+
+            if (name == "i")
+            {
+                auto dst = allocate();
+                return dst < 0 ? -1 : emit(OrbitMapping::loadIndex, dst);
+            }
+
+            if (name == "pi")
+                return loadConstant(juce::MathConstants<double>::pi);
+
+            if (name == "z" || name == "c")
+                return fail(juce::String(name) + " is complex, use re(), im(), abs() or arg()", token.line);
+
+            if (!isSymbol("("))
+                return fail("unknown name " + juce::String(name), token.line);
+
+            next();
+            auto value = parseFunction(name, token.line);
+
+            return value >= 0 && expect(")") ? value : -1;
+        }
+
+        //After the opening bracket
+        int parseFunction(const std::string& name, int line)
+        {
+            if (name == "re" || name == "im" || name == "arg" || (name == "abs" && isComplexValue()))
+            {
+                if (!isComplexValue())
+                    return fail(juce::String(name) + "() takes z[i] or c");
+
+                auto value = parseComplexValue();
+                auto dst = value < 0 ? -1 : allocate();
+
+                if (dst < 0)
+                    return -1;
+
+                auto op = name == "re" ? OrbitMapping::loadOrbitReal
+                        : name == "im" ? OrbitMapping::loadOrbitImag
+                        : name == "abs" ? OrbitMapping::loadOrbitMagnitude
+                                        : OrbitMapping::loadOrbitAngle;
+
+                //The seed loads follow the orbit ones in the same order
+                if (value == seedPoint)
+                    op = (OpCode)(op + OrbitMapping::loadSeedReal - OrbitMapping::loadOrbitReal);
+
+                return emit(op, dst);
+            }
+
+            struct Function
+            {
+                const char* name;
+                OpCode op;
+                int numArguments;
+            };
+
+            static const Function functions[] = {
+                { "abs", OrbitMapping::absolute, 1 },
+                { "sqrt", OrbitMapping::squareRoot, 1 },
+                { "sin", OrbitMapping::sine, 1 },
+                { "cos", OrbitMapping::cosine, 1 },
+                { "exp", OrbitMapping::exponential, 1 },
+                { "log", OrbitMapping::logarithm, 1 },
+                { "floor", OrbitMapping::floor, 1 },
+                { "sum", OrbitMapping::sum, 1 },
+                { "min", OrbitMapping::minimum, 2 },
+                { "max", OrbitMapping::maximum, 2 },
+                { "pow", OrbitMapping::power, 2 }
+            };
+
+            for (auto& function : functions)
+            {
+                if (name != function.name)
+                    continue;
+
+                auto value = parseExpression();
+
+                if (function.numArguments == 1)
+                    return value < 0 ? -1 : emit(function.op, value, value);
+
+                if (value < 0 || !expect(","))
+                    return -1;
+
+                return emitBinary(function.op, value, parseExpression());
+            }
+
+            return fail("unknown function " + juce::String(name) + "()", line);
+        }
+    };
+}
+
+juce::Result OrbitMapping::compile(const juce::String& text, Program& program)
+{
+    return Compiler(text).compile(program);
+}
+
+void OrbitMapping::run(const Program& program, const std::complex<double>* orbit, std::complex<double> seed,
+    double* detunes, double* rates) noexcept
+{
+    double registers[maxRegisters][numPartials] = {};
+
+    for (int n = 0; n < program.numInstructions; ++n)
+    {
+        auto& instruction = program.instructions[(size_t)n];
+
+        auto* d = registers[instruction.dst];
+        const auto* x = registers[instruction.a];
+        const auto* y = registers[instruction.b];
+
+        switch (instruction.op)
+        {
+        case loadConstant:
+            for (int k = 0; k < numPartials; ++k) d[k] = program.constants[instruction.a];
+            break;
+        case loadIndex:
+            for (int k = 0; k < numPartials; ++k) d[k] = k;
+            break;
+        case loadOrbitReal:
+            for (int k = 0; k < numPartials; ++k) d[k] = orbit[k].real();
+            break;
+        case loadOrbitImag:
+            for (int k = 0; k < numPartials; ++k) d[k] = orbit[k].imag();
+            break;
+        case loadOrbitMagnitude:
+            for (int k = 0; k < numPartials; ++k) d[k] = std::abs(orbit[k]);
+            break;
+        case loadOrbitAngle:
+            for (int k = 0; k < numPartials; ++k) d[k] = std::arg(orbit[k]);
+            break;
+        case loadSeedReal:
+            for (int k = 0; k < numPartials; ++k) d[k] = seed.real();
+            break;
+        case loadSeedImag:
+            for (int k = 0; k < numPartials; ++k) d[k] = seed.imag();
+            break;
+        case loadSeedMagnitude:
+            for (int k = 0; k < numPartials; ++k) d[k] = std::abs(seed);
+            break;
+        case loadSeedAngle:
+            for (int k = 0; k < numPartials; ++k) d[k] = std::arg(seed);
+            break;
+
+        case negate:
+            for (int k = 0; k < numPartials; ++k) d[k] = -x[k];
+            break;
+        case absolute:
+            for (int k = 0; k < numPartials; ++k) d[k] = std::abs(x[k]);
+            break;
+        case squareRoot:
+            for (int k = 0; k < numPartials; ++k) d[k] = std::sqrt(x[k]);
+            break;
+        case sine:
+            for (int k = 0; k < numPartials; ++k) d[k] = std::sin(x[k]);
+            break;
+        case cosine:
+            for (int k = 0; k < numPartials; ++k) d[k] = std::cos(x[k]);
+            break;
+        case exponential:
+            for (int k = 0; k < numPartials; ++k) d[k] = std::exp(x[k]);
+            break;
+        case logarithm:
+            for (int k = 0; k < numPartials; ++k) d[k] = std::log(x[k]);
+            break;
+        case floor:
+            for (int k = 0; k < numPartials; ++k) d[k] = std::floor(x[k]);
+            break;
+        case sum:
+        {
+            double total = 0;
+            for (int k = 0; k < numPartials; ++k) total += x[k];
+            for (int k = 0; k < numPartials; ++k) d[k] = total;
+            break;
+        }
+
+        case add:
+            for (int k = 0; k < numPartials; ++k) d[k] = x[k] + y[k];
+            break;
+        case subtract:
+            for (int k = 0; k < numPartials; ++k) d[k] = x[k] - y[k];
+            break;
+        case multiply:
+            for (int k = 0; k < numPartials; ++k) d[k] = x[k] * y[k];
+            break;
+        case divide:
+            for (int k = 0; k < numPartials; ++k) d[k] = x[k] / y[k];
+            break;
+        case minimum:
+            for (int k = 0; k < numPartials; ++k) d[k] = juce::jmin(x[k], y[k]);
+            break;
+        case maximum:
+            for (int k = 0; k < numPartials; ++k) d[k] = juce::jmax(x[k], y[k]);
+            break;
+        case power:
+            for (int k = 0; k < numPartials; ++k) d[k] = std::pow(x[k], y[k]);
+            break;
+
+        case store:
+        {
+            //The first partial always stays on the note, like with the built-in mapping
+            auto* values = instruction.a == detune ? detunes : rates;
+            auto first = instruction.a == detune ? 1 : 0;
+
+            for (int k = first; k < numPartials; ++k)
+            {
+                if (std::isfinite(d[k]))
+                    values[k] = juce::jmax(0.0, d[k]);
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    OrbitMapping.h
+    Created: 25 Oct 2026 6:02:47pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//User-defined mapping from the orbit of the seed to the settings of the partials, e.g.
+//
+//    detune[i] = 1 + abs(re(z[i])) * 0.5
+//    rate[i] = abs(im(z[i])) * 10 / sum(abs(im(z[i])))
+//
+//The text is compiled off the audio thread into a small register bytecode. Every register holds one value per partial,
+//so each instruction runs over all the partials in one loop. A program has a fixed size: it can be copied into the
+//audio thread and evaluated there without allocation, and its cost is bounded by maxInstructions.
+//The settings that the program doesn't assign keep the built-in mapping.
+class OrbitMapping
+{
+public:
+
+    static constexpr int numPartials = 4;
+
+    static constexpr int maxInstructions = 128;
+    static constexpr int maxConstants = 32;
+    static constexpr int maxRegisters = 16;
+
+    enum Target
+    {
+        detune, //frequency of the partial / note (the first partial always stays on the note)
+        rate, //tremolo LFO rate in Hz
+        numTargets
+    };
+
+    enum OpCode : juce::uint8
+    {
+        //dst = value
+        loadConstant, //a: index of the constant
+        loadIndex, //index of the partial
+        loadOrbitReal,
+        loadOrbitImag,
+        loadOrbitMagnitude,
+        loadOrbitAngle,
+        loadSeedReal, //same order as the orbit loads
+        loadSeedImag,
+        loadSeedMagnitude,
+        loadSeedAngle,
+
+        //dst = f(a)
+        negate,
+        absolute,
+        squareRoot,
+        sine,
+        cosine,
+        exponential,
+        logarithm,
+        floor,
+        sum, //of a over the partials, in every partial
+
+        //dst = f(a, b)
+        add,
+        subtract,
+        multiply,
+        divide,
+        minimum,
+        maximum,
+        power,
+
+        //target a = register dst
+        store
+    };
+
+    struct Instruction
+    {
+        OpCode op = loadConstant;
+        juce::uint8 dst = 0;
+        juce::uint8 a = 0;
+        juce::uint8 b = 0;
+    };
+
+    struct Program
+    {
+        int numInstructions = 0;
+        std::array<Instruction, maxInstructions> instructions{};
+        std::array<double, maxConstants> constants{};
+
+        //Bits of the targets stored by the program
+        int assignedTargets = 0;
+
+        bool isEmpty() const noexcept { return assignedTargets == 0; }
+    };
+
+    //Compiles the text (not realtime safe), the error message gives the line. An empty text (or only comments)
+    //gives an empty program. The program is only changed if the text compiles.
+    static juce::Result compile(const juce::String& text, Program& program);
+
+    //Realtime safe: writes the assigned targets over the values of the built-in mapping (numPartials values each,
+    //negative results become 0, non finite ones keep the built-in value). orbit: numPartials points, seed: c
+    static void run(const Program& program, const std::complex<double>* orbit, std::complex<double> seed,
+        double* detunes, double* rates) noexcept;
+};
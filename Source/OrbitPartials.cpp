@@ -0,0 +1,261 @@
+/*
+  ==============================================================================
+
+    OrbitPartials.cpp
+    Created: 21 Oct 2026 10:05:40am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "OrbitPartials.h"
+#include "PartialOscillator.h"
+#include "DspKernels.h"
+
+namespace
+{
+    //4-term Blackman-Harris window: main lobe of +-4 bins, side lobes at -92 dB,
+    //so a partial only touches 9 bins of the spectrum
+    constexpr double a0 = 0.35875, a1 = 0.48829, a2 = 0.14128, a3 = 0.01168;
+    constexpr int kernelHalfWidth = 4;
+    constexpr int kernelResolution = 64; //points per bin
+
+    //Zero-phase window, n in -size/2..size/2
+    double analysisWindow(int n)
+    {
+        auto x = juce::MathConstants<double>::twoPi * n / OrbitPartials::fftSize;
+        return a0 + a1 * std::cos(x) + a2 * std::cos(2 * x) + a3 * std::cos(3 * x);
+    }
+
+    //Transform of the window at a distance of d bins from the partial (real and even, so only d >= 0 is stored).
+    //Built once per process, the first prepare makes sure it is not built on the audio thread.
+    const float* getWindowKernel()
+    {
+        static const std::vector<float> kernel = []
+        {
+            std::vector<float> values((size_t)(kernelHalfWidth * kernelResolution + 2));
+
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                auto d = (double)i / kernelResolution;
+                double sum = 0;
+
+                for (int n = -OrbitPartials::fftSize / 2; n < OrbitPartials::fftSize / 2; ++n)
+                    sum += analysisWindow(n) * std::cos(juce::MathConstants<double>::twoPi * d * n / OrbitPartials::fftSize);
+
+                values[i] = (float)sum;
+            }
+
+            return values;
+        }();
+
+        return kernel.data();
+    }
+
+    //Replaces the analysis window with a triangle over the 2 hops around the centre of the frame
+    //(the triangles of consecutive frames add up to 1, and the window is far from 0 there)
+    const float* getSynthesisWindow()
+    {
+        static const std::vector<float> window = []
+        {
+            std::vector<float> values((size_t)(2 * OrbitPartials::hopSize));
+
+            for (int i = 0; i < (int)values.size(); ++i)
+            {
+                auto n = i - OrbitPartials::hopSize;
+                auto triangle = 1.0 - std::abs(n) / (double)OrbitPartials::hopSize;
+                values[(size_t)i] = (float)(triangle / analysisWindow(n));
+            }
+
+            return values;
+        }();
+
+        return window.data();
+    }
+
+    inline float lookUpKernel(const float* kernel, double distance) noexcept
+    {
+        auto position = (float)(std::abs(distance) * kernelResolution);
+        auto index = (int)position;
+        auto fraction = position - (float)index;
+
+        return kernel[index] + fraction * (kernel[index + 1] - kernel[index]);
+    }
+}
+
+void OrbitPartials::prepare(double newSampleRate)
+{
+    getWindowKernel();
+    getSynthesisWindow();
+
+    sampleRate = newSampleRate;
+
+    if (fft == nullptr)
+        fft = std::make_unique<juce::dsp::FFT>(fftOrder);
+
+    bankPhases.assign((size_t)maxPartials, 0.0);
+    audibleIndexes.assign((size_t)maxPartials, 0);
+    audiblePhases.assign((size_t)maxPartials, 0.0);
+    audibleIncrements.assign((size_t)maxPartials, 0.0);
+    audibleGains.assign((size_t)maxPartials, 0.0f);
+    framePhases.assign((size_t)maxPartials, 0.0);
+
+    fftData.assign((size_t)(2 * fftSize), 0.0f);
+    overlap.assign((size_t)(2 * hopSize), 0.0f);
+    hopOutput.assign((size_t)hopSize, 0.0f);
+    outputPosition = hopSize;
+}
+
+void OrbitPartials::startNote(double newNoteFrequency, int crossover) noexcept
+{
+    noteFrequency = newNoteFrequency;
+
+    int numAudible = 0;
+    for (int k = 0; k < numPartials; ++k)
+    {
+        if (isAudible(noteFrequency * detunes[k]))
+            ++numAudible;
+    }
+
+    useInverseFFT = numAudible > crossover;
+
+    std::fill(bankPhases.begin(), bankPhases.end(), 0.0);
+    std::fill(framePhases.begin(), framePhases.end(), 0.0);
+
+    //The first frame fades in over a hop
+    std::fill(overlap.begin(), overlap.end(), 0.0f);
+    outputPosition = hopSize;
+}
+
+void OrbitPartials::setPartials(const double* newDetunes, const float* newGains, int count) noexcept
+{
+    detunes = newDetunes;
+    gains = newGains;
+    numPartials = juce::jlimit(0, maxPartials, count);
+}
+
+void OrbitPartials::render(float* out, int numSamples) noexcept
+{
+    if (useInverseFFT)
+        renderInverseFFT(out, numSamples);
+    else
+        renderBank(out, numSamples);
+}
+
+void OrbitPartials::renderBank(float* out, int numSamples) noexcept
+{
+    int count = 0;
+
+    for (int k = 0; k < numPartials; ++k)
+    {
+        auto frequency = noteFrequency * frequencyScale * detunes[k];
+
+        if (!isAudible(frequency))
+            continue;
+
+        audibleIndexes[(size_t)count] = k;
+        audiblePhases[(size_t)count] = bankPhases[(size_t)k];
+        audibleIncrements[(size_t)count] = frequency / sampleRate;
+        audibleGains[(size_t)count] = gains[k];
+        ++count;
+    }
+
+    DspKernels::get().sineBank(out, numSamples, audiblePhases.data(), audibleIncrements.data(), audibleGains.data(), count);
+
+    for (int i = 0; i < count; ++i)
+        bankPhases[(size_t)audibleIndexes[(size_t)i]] = audiblePhases[(size_t)i];
+}
+
+void OrbitPartials::renderInverseFFT(float* out, int numSamples) noexcept
+{
+    while (numSamples > 0)
+    {
+        if (outputPosition == hopSize)
+        {
+            synthesiseFrame();
+            outputPosition = 0;
+        }
+
+        auto numToCopy = juce::jmin(numSamples, hopSize - outputPosition);
+        juce::FloatVectorOperations::copy(out, hopOutput.data() + outputPosition, numToCopy);
+
+        out += numToCopy;
+        numSamples -= numToCopy;
+        outputPosition += numToCopy;
+    }
+}
+
+void OrbitPartials::synthesiseFrame() noexcept
+{
+    const auto* kernel = getWindowKernel();
+    const auto* synthesisWindow = getSynthesisWindow();
+
+    std::fill(fftData.begin(), fftData.end(), 0.0f);
+    auto* bins = reinterpret_cast<std::complex<float>*>(fftData.data());
+
+    const auto twoPi = juce::MathConstants<double>::twoPi;
+    const auto binsPerHz = fftSize / sampleRate;
+
+    for (int k = 0; k < numPartials; ++k)
+    {
+        auto frequency = noteFrequency * frequencyScale * detunes[k];
+
+        if (!isAudible(frequency))
+            continue;
+
+        //A windowed sinusoid is the window kernel centred on its (fractional) bin, rotated by its phase
+        auto bin = frequency * binsPerHz;
+        auto& phase = framePhases[(size_t)k];
+        auto amplitude = 0.5f * gains[k];
+        auto re = amplitude * (float)std::cos(phase);
+        auto im = amplitude * (float)std::sin(phase);
+
+        auto first = (int)std::ceil(bin - kernelHalfWidth);
+        auto last = (int)std::floor(bin + kernelHalfWidth);
+
+        for (int j = first; j <= last; ++j)
+        {
+            auto value = lookUpKernel(kernel, bin - j);
+
+            if (j > 0)
+            {
+                bins[j] += std::complex<float>(re * value, im * value);
+            }
+            else
+            {
+                //Low partials spill below DC: that part is the mirror image of the negative frequencies
+                bins[-j] += std::complex<float>(re * value, -im * value);
+
+                if (j == 0)
+                    bins[0] += std::complex<float>(re * value, im * value);
+            }
+        }
+
+        phase += twoPi * frequency * hopSize / sampleRate;
+        phase -= twoPi * std::floor(phase / twoPi);
+    }
+
+    //Only the bins up to fftSize / 2 are read, the inverse is scaled by 1 / fftSize
+    fft->performRealOnlyInverseTransform(fftData.data());
+
+    //The frame is centred on sample 0 (circularly): overlap-add the 2 hops around it
+    for (int i = 0; i < 2 * hopSize; ++i)
+    {
+        auto n = i - hopSize;
+        auto sample = fftData[(size_t)(n < 0 ? n + fftSize : n)];
+        overlap[(size_t)i] += sample * synthesisWindow[i];
+    }
+
+    //The first hop has received both of its frames
+    std::copy_n(overlap.begin(), hopSize, hopOutput.begin());
+    std::copy_n(overlap.begin() + hopSize, hopSize, overlap.begin());
+    std::fill(overlap.begin() + hopSize, overlap.end(), 0.0f);
+}
+
+size_t OrbitPartials::getSizeInBytes() const
+{
+    return sizeof(*this)
+        + (bankPhases.size() + framePhases.size() + audiblePhases.size() + audibleIncrements.size()) * sizeof(double)
+        + (fftData.size() + overlap.size() + hopOutput.size() + audibleGains.size()) * sizeof(float)
+        + audibleIndexes.size() * sizeof(int);
+}
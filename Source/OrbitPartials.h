@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    OrbitPartials.h
+    Created: 21 Oct 2026 10:05:22am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//Extra sine partials of a voice, taken further along the fractal orbit than the main partials.
+//A few of them are rendered by a bank of oscillators. With many of them, the spectrum of all the partials is
+//built once per hop and synthesised by a single inverse FFT with overlap-add, so the cost grows with the
+//number of frames and not with the number of partials.
+class OrbitPartials
+{
+public:
+
+    static constexpr int maxPartials = 256;
+
+    static constexpr int fftOrder = 10;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = fftSize / 4;
+
+    //Not realtime safe (allocates the FFT and the buffers)
+    void prepare(double sampleRate);
+
+    //Chooses the engine for the whole note: the inverse FFT is used when more than crossover partials are audible
+    void startNote(double noteFrequency, int crossover) noexcept;
+
+    //Detune factors on the note frequency and linear gains. The arrays are read in every block, not copied.
+    void setPartials(const double* detunes, const float* gains, int count) noexcept;
+
+    int getNumPartials() const noexcept { return numPartials; }
+
+    //Pitch bend and glide of the voice, applied at every render call
+    void setFrequencyScale(double newScale) noexcept { frequencyScale = newScale; }
+
+    bool isUsingInverseFFT() const noexcept { return useInverseFFT; }
+
+    //Overwrites numSamples samples
+    void render(float* out, int numSamples) noexcept;
+
+    size_t getSizeInBytes() const;
+
+private:
+
+    //Partials outside this range are skipped (inaudible, or too close to Nyquist for the spectral kernel)
+    bool isAudible(double partialFrequency) const noexcept { return partialFrequency >= 20.0 && partialFrequency < 0.45 * sampleRate; }
+
+    void renderBank(float* out, int numSamples) noexcept;
+    void renderInverseFFT(float* out, int numSamples) noexcept;
+
+    //Builds the spectrum of the frame centred one hop ahead and overlap-adds its inverse
+    void synthesiseFrame() noexcept;
+
+    double sampleRate = 44100;
+    double noteFrequency = 440;
+    double frequencyScale = 1;
+
+    const double* detunes = nullptr;
+    const float* gains = nullptr;
+    int numPartials = 0;
+
+    bool useInverseFFT = false;
+
+    //Oscillator bank: phase in cycles at the next sample
+    std::vector<double> bankPhases;
+
+    //The audible partials of the block, packed for the sine bank kernel
+    std::vector<int> audibleIndexes;
+    std::vector<double> audiblePhases, audibleIncrements;
+    std::vector<float> audibleGains;
+
+    //Inverse FFT: phase in radians at the centre of the next frame
+    std::vector<double> framePhases;
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> fftData; //2 * fftSize, the spectrum in and the frame out
+    std::vector<float> overlap; //2 * hopSize samples around the centre of the last frame
+    std::vector<float> hopOutput; //finished samples
+    int outputPosition = hopSize;
+};
@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+
+    PartRenderPool.cpp
+    Created: 19 Oct 2026 11:02:31am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "PartRenderPool.h"
+
+namespace
+{
+    inline juce::uint32 getGeneration(juce::uint64 batch) noexcept { return (juce::uint32)(batch >> 32); }
+    inline int getNumJobs(juce::uint64 batch) noexcept { return (int)((batch >> 16) & 0xffff); }
+    inline int getNextJob(juce::uint64 batch) noexcept { return (int)(batch & 0xffff); }
+
+    inline juce::uint64 makeBatch(juce::uint32 generation, int numJobs, int nextJob) noexcept
+    {
+        return ((juce::uint64)generation << 32) | ((juce::uint64)numJobs << 16) | (juce::uint64)nextJob;
+    }
+}
+
+PartRenderPool::PartRenderPool(int numWorkers)
+{
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        workers.add(new Worker(*this, i));
+
+        //Just below the realtime priority: the workers are part of the audio callback
+        workers.getLast()->startThread(9);
+    }
+}
+
+PartRenderPool::~PartRenderPool()
+{
+    for (auto* worker : workers)
+        worker->signalThreadShouldExit();
+
+    for (auto* worker : workers)
+    {
+        worker->notify();
+        worker->stopThread(1000);
+    }
+}
+
+void PartRenderPool::run(Job job, void* context, int numJobs)
+{
+    jassert(numJobs < 0x10000);
+
+    currentJob.store(job, std::memory_order_relaxed);
+    currentContext.store(context, std::memory_order_relaxed);
+    finishedJobs.store(0, std::memory_order_relaxed);
+
+    //Sequentially consistent with the sleeping flags of the workers: either the worker sees the new batch before
+    //sleeping, or this thread sees it sleeping and wakes it
+    auto generation = getGeneration(batch.load(std::memory_order_relaxed)) + 1;
+    batch.store(makeBatch(generation, numJobs, 0), std::memory_order_seq_cst);
+
+    //The audio thread renders one of the parts, so one worker less is needed (the spinning ones find the batch alone)
+    for (int i = 0; i < juce::jmin(numJobs - 1, workers.size()); ++i)
+    {
+        auto* worker = workers.getUnchecked(i);
+
+        if (worker->sleeping.load(std::memory_order_seq_cst))
+            worker->notify();
+    }
+
+    //The jobs are rendered here too when the workers are late (the caller may not have disabled the denormals)
+    juce::ScopedNoDenormals noDenormals;
+    runPendingJobs();
+
+    //Wait for the jobs claimed by the workers (they are already running, so this is short)
+    while (finishedJobs.load(std::memory_order_acquire) < numJobs)
+        std::this_thread::yield();
+}
+
+void PartRenderPool::runPendingJobs()
+{
+    auto current = batch.load(std::memory_order_acquire);
+
+    while (getNextJob(current) < getNumJobs(current))
+    {
+        //Read the job before claiming it: if the claim succeeds the batch (and so the job) didn't change meanwhile
+        auto job = currentJob.load(std::memory_order_relaxed);
+        auto context = currentContext.load(std::memory_order_relaxed);
+
+        auto claimed = makeBatch(getGeneration(current), getNumJobs(current), getNextJob(current) + 1);
+
+        if (batch.compare_exchange_weak(current, claimed, std::memory_order_acquire, std::memory_order_acquire))
+        {
+            job(context, getNextJob(current));
+
+            finishedJobs.fetch_add(1, std::memory_order_release);
+
+            current = claimed;
+        }
+    }
+}
+
+PartRenderPool::Worker::Worker(PartRenderPool& pool, int index)
+    : juce::Thread("Part renderer " + juce::String(index + 1)), pool(pool)
+{
+}
+
+void PartRenderPool::Worker::run()
+{
+    //Same floating point mode as the audio thread, the parts rendered here are mixed with the others
+    juce::ScopedNoDenormals noDenormals;
+
+    auto lastGeneration = getGeneration(pool.batch.load(std::memory_order_acquire));
+
+    while (!threadShouldExit())
+    {
+        //Poll for the next batch for a while, then sleep until run() notifies
+        auto idleStart = juce::Time::getMillisecondCounterHiRes();
+
+        while (getGeneration(pool.batch.load(std::memory_order_acquire)) == lastGeneration && !threadShouldExit())
+        {
+            if (juce::Time::getMillisecondCounterHiRes() - idleStart < maxSpinMilliseconds)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            sleeping.store(true, std::memory_order_seq_cst);
+
+            if (getGeneration(pool.batch.load(std::memory_order_seq_cst)) == lastGeneration)
+                wait(-1);
+
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+
+        if (threadShouldExit())
+            break;
+
+        lastGeneration = getGeneration(pool.batch.load(std::memory_order_acquire));
+
+        pool.runPendingJobs();
+    }
+}
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    PartRenderPool.h
+    Created: 19 Oct 2026 11:02:15am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//Renders the parts of the synth in parallel.
+//The audio thread publishes a batch of jobs, wakes the workers and claims jobs itself too,
+//so a batch is finished even if the workers are late (or if there are none).
+//After a batch the workers spin (yielding) for a few milliseconds waiting for the next one, so while the host keeps
+//calling back faster than that, run() only touches atomics. A worker idle for longer sleeps on its event, and the
+//next run() wakes it through the event (a short, uncontended lock). Nothing in run() allocates.
+class PartRenderPool
+{
+public:
+
+    using Job = void(*)(void* context, int jobIndex);
+
+    explicit PartRenderPool(int numWorkers);
+    ~PartRenderPool();
+
+    //Runs job(context, 0..numJobs-1) and returns when all of them are finished (audio thread only)
+    void run(Job job, void* context, int numJobs);
+
+    int getNumWorkers() const noexcept { return workers.size(); }
+
+private:
+
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker(PartRenderPool& pool, int index);
+        void run() override;
+
+        //Set before sleeping on the event: only the sleeping workers need to be notified
+        std::atomic<bool> sleeping{ false };
+
+    private:
+        PartRenderPool& pool;
+    };
+
+    //How long an idle worker polls for the next batch before sleeping
+    static constexpr double maxSpinMilliseconds = 5.0;
+
+    //Claims and runs jobs of the current batch until there are none left
+    void runPendingJobs();
+
+    //Batch state packed in one word so that a job is claimed with a single compare and swap:
+    //generation (32 bits) | number of jobs (16 bits) | next job (16 bits).
+    //A worker woken late can't claim a job of the next batch with the function of the previous one.
+    std::atomic<juce::uint64> batch{ 0 };
+    std::atomic<Job> currentJob{ nullptr };
+    std::atomic<void*> currentContext{ nullptr };
+    std::atomic<int> finishedJobs{ 0 };
+
+    juce::OwnedArray<Worker> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PartRenderPool)
+};
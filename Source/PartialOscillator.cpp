@@ -0,0 +1,389 @@
+/*
+  ==============================================================================
+
+    PartialOscillator.cpp
+    Created: 20 Oct 2026 2:38:10pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "PartialOscillator.h"
+
+namespace
+{
+    constexpr int sineTableSize = 4096;
+
+    //sin(2 pi i / size - pi), one guard point for the interpolation.
+    //Built once per process (the first prepare makes sure it is not built on the audio thread)
+    const float* getSineTable()
+    {
+        static const std::vector<float> sineTable = []
+        {
+            std::vector<float> values((size_t)sineTableSize + 1);
+
+            for (size_t i = 0; i < values.size(); ++i)
+                values[i] = (float)std::sin(juce::MathConstants<double>::twoPi * (double)i / sineTableSize - juce::MathConstants<double>::pi);
+
+            return values;
+        }();
+
+        return sineTable.data();
+    }
+
+    //Kernels of the render loop: phase 0..1 to sample. The output is taken at 2 pi phase - pi like
+    //juce::dsp::Oscillator, so that all the wave types line up
+
+    struct ExactSineKernel
+    {
+        float operator()(double phase) const noexcept
+        {
+            return (float)std::sin(juce::MathConstants<double>::twoPi * phase - juce::MathConstants<double>::pi);
+        }
+    };
+
+    struct PolynomialSineKernel
+    {
+        float operator()(double phase) const noexcept
+        {
+            return PartialOscillator::sinePolynomial((float)(juce::MathConstants<double>::twoPi * phase - juce::MathConstants<double>::pi));
+        }
+    };
+
+    struct TableSineKernel
+    {
+        const float* sineTable;
+
+        float operator()(double phase) const noexcept
+        {
+            auto position = phase * sineTableSize;
+            auto index = (int)position;
+            auto frac = (float)(position - index);
+
+            return sineTable[index] + frac * (sineTable[index + 1] - sineTable[index]);
+        }
+    };
+
+    struct SawKernel
+    {
+        float operator()(double phase) const noexcept { return (float)(2.0 * phase - 1.0); }
+    };
+
+    struct SquareKernel
+    {
+        float operator()(double phase) const noexcept { return phase < 0.5 ? -1.0f : 1.0f; }
+    };
+
+    //Two frames of a wavetable, morphed by frameMix
+    struct WavetableKernel
+    {
+        const float* frameA;
+        const float* frameB;
+        float frameMix;
+
+        float operator()(double phase) const noexcept
+        {
+            auto tablePosition = phase * Wavetable::frameSize;
+            auto index0 = (int)tablePosition;
+            auto index1 = (index0 + 1) & (Wavetable::frameSize - 1);
+            auto frac = (float)(tablePosition - index0);
+
+            auto a = frameA[index0] + frac * (frameA[index1] - frameA[index0]);
+            auto b = frameB[index0] + frac * (frameB[index1] - frameB[index0]);
+
+            return a + frameMix * (b - a);
+        }
+    };
+}
+
+void PartialOscillator::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    getSineTable();
+
+    sampleRate = spec.sampleRate;
+    setFrequency(frequency);
+    reset();
+}
+
+void PartialOscillator::reset() noexcept
+{
+    phase = 0;
+}
+
+void PartialOscillator::setFrequency(double newFrequency) noexcept
+{
+    frequency = newFrequency;
+
+    //Only the fractional part matters (detuned partials can go above the sample rate)
+    auto cycles = frequency / sampleRate;
+    increment = cycles - std::floor(cycles);
+
+    rotationCos = std::cos(juce::MathConstants<double>::twoPi * increment);
+    rotationSin = std::sin(juce::MathConstants<double>::twoPi * increment);
+}
+
+void PartialOscillator::setWavetable(const Wavetable* newTable, float newFramePosition) noexcept
+{
+    currentTable = newTable;
+    framePosition = newFramePosition;
+}
+
+void PartialOscillator::advancePhase(int numSamples) noexcept
+{
+    phase += increment * numSamples;
+    phase -= std::floor(phase);
+}
+
+template <typename Kernel>
+void PartialOscillator::renderKernel(float* out, int numSamples, const Kernel& kernel) noexcept
+{
+    //Local copies, so the compiler knows the output doesn't alias them
+    const auto startPhase = phase;
+    const auto step = increment;
+
+    if (phaseWarp != nullptr)
+    {
+        const auto* warp = phaseWarp;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto samplePhase = startPhase + step * warp[i];
+            samplePhase -= std::floor(samplePhase);
+
+            out[i] = kernel(samplePhase);
+        }
+
+        phase = startPhase + step * warp[numSamples];
+        phase -= std::floor(phase);
+        return;
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto samplePhase = startPhase + step * (double)i;
+        samplePhase -= std::floor(samplePhase);
+
+        out[i] = kernel(samplePhase);
+    }
+
+    advancePhase(numSamples);
+}
+
+void PartialOscillator::render(float* out, int numSamples) noexcept
+{
+    if (waveType == saw)
+    {
+        renderKernel(out, numSamples, SawKernel{});
+        return;
+    }
+
+    if (waveType == square)
+    {
+        renderKernel(out, numSamples, SquareKernel{});
+        return;
+    }
+
+    switch (sineTier)
+    {
+    case exact:
+        renderKernel(out, numSamples, ExactSineKernel{});
+        break;
+
+    case polynomial:
+        renderKernel(out, numSamples, PolynomialSineKernel{});
+        break;
+
+    case table:
+        renderKernel(out, numSamples, TableSineKernel{ getSineTable() });
+        break;
+
+    case recursive:
+    default:
+        //The rotation is for a constant frequency, a bent note uses the next cheapest tier
+        if (phaseWarp != nullptr)
+            renderKernel(out, numSamples, PolynomialSineKernel{});
+        else
+            renderRecursiveSine(out, numSamples);
+        break;
+    }
+}
+
+void PartialOscillator::renderRecursiveSine(float* out, int numSamples) noexcept
+{
+    //Start from the exact phase, so the rounding errors of the rotation never build up over more than a block.
+    //A recurrence, so it keeps its own loop
+    auto angle = juce::MathConstants<double>::twoPi * phase - juce::MathConstants<double>::pi;
+    auto s = std::sin(angle);
+    auto c = std::cos(angle);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        out[i] = (float)s;
+
+        auto nextS = s * rotationCos + c * rotationSin;
+        c = c * rotationCos - s * rotationSin;
+        s = nextS;
+    }
+
+    advancePhase(numSamples);
+}
+
+void PartialOscillator::renderWavetable(float* out, int numSamples, const Wavetable& wave, float position) noexcept
+{
+    auto numFrames = wave.getNumFrames();
+
+    //A bent note picks the mip level of its mean frequency over the block
+    auto playedFrequency = phaseWarp != nullptr && numSamples > 0 ? frequency * phaseWarp[numSamples] / numSamples : frequency;
+    auto mipLevel = Wavetable::getMipLevelForFrequency(playedFrequency, sampleRate);
+
+    //Morph between the two frames around the selected position
+    auto framePositionInTable = position * (float)(numFrames - 1);
+    auto frameIndex = juce::jlimit(0, numFrames - 1, (int)framePositionInTable);
+    auto nextFrameIndex = juce::jmin(frameIndex + 1, numFrames - 1);
+
+    WavetableKernel kernel{ wave.getFrame(mipLevel, frameIndex), wave.getFrame(mipLevel, nextFrameIndex), framePositionInTable - (float)frameIndex };
+    renderKernel(out, numSamples, kernel);
+}
+
+juce::String PartialOscillator::runBenchmark()
+{
+    constexpr double sampleRate = 48000;
+    constexpr int blockSize = 512;
+    constexpr int numBlocks = 2000;
+
+    //The sine sits exactly on a bin, so the spectrum needs no window: the fundamental is one bin,
+    //the harmonics are its multiples and everything else is noise
+    constexpr int fftOrder = 13;
+    constexpr int fftSize = 1 << fftOrder;
+    constexpr int fundamentalBin = 93;
+    constexpr double frequency = fundamentalBin * sampleRate / fftSize;
+
+    static_assert(fftSize % blockSize == 0, "The analysed signal is made of whole blocks");
+
+    static const char* tierNames[numSineTiers] = { "exact", "polynomial", "table", "recursive" };
+
+    juce::dsp::ProcessSpec spec{ sampleRate, (juce::uint32)blockSize, 1 };
+    std::vector<float> out((size_t)blockSize);
+
+    juce::dsp::FFT fft(fftOrder);
+    std::vector<float> spectrum(2 * (size_t)fftSize);
+
+    //Millions of samples per second of a block renderer (one std::function call per block, not per sample)
+    auto getThroughput = [&out](const std::function<void(float*)>& renderBlock)
+    {
+        renderBlock(out.data()); //warm up
+
+        auto start = juce::Time::getHighResolutionTicks();
+        float sink = 0;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            renderBlock(out.data());
+            sink += out[0];
+        }
+
+        auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        juce::ignoreUnused(sink);
+
+        return numBlocks * (double)blockSize / seconds / 1e6;
+    };
+
+    auto makeOscillator = [&spec](int waveType, int tier)
+    {
+        PartialOscillator oscillator;
+        oscillator.prepare(spec);
+        oscillator.setWaveType(waveType);
+        oscillator.setSineTier(tier);
+        oscillator.setFrequency(frequency);
+        return oscillator;
+    };
+
+    juce::String report;
+    report << "Sine tiers (" << juce::String(frequency, 1) << " Hz, " << blockSize << " sample blocks):\n";
+
+    for (int tier = 0; tier < numSineTiers; ++tier)
+    {
+        auto oscillator = makeOscillator(sine, tier);
+        auto throughput = getThroughput([&oscillator](float* block) { oscillator.render(block, blockSize); });
+
+        oscillator.reset();
+        std::fill(spectrum.begin(), spectrum.end(), 0.0f);
+
+        for (int offset = 0; offset < fftSize; offset += blockSize)
+            oscillator.render(spectrum.data() + offset, blockSize);
+
+        fft.performFrequencyOnlyForwardTransform(spectrum.data());
+
+        double fundamental = spectrum[(size_t)fundamentalBin];
+        double harmonics = 0, noise = 0;
+
+        for (int bin = 1; bin <= fftSize / 2; ++bin)
+        {
+            if (bin == fundamentalBin)
+                continue;
+
+            auto power = (double)spectrum[(size_t)bin] * spectrum[(size_t)bin];
+            noise += power;
+
+            if (bin % fundamentalBin == 0)
+                harmonics += power;
+        }
+
+        auto toDecibels = [fundamental](double power) { return juce::Decibels::gainToDecibels(std::sqrt(power) / fundamental, -200.0); };
+
+        report << "  " << tierNames[tier] << ": "
+               << juce::String(throughput, 1) << " Msamples/s, "
+               << "THD " << juce::String(toDecibels(harmonics), 1) << " dB, "
+               << "THD+N " << juce::String(toDecibels(noise), 1) << " dB\n";
+    }
+
+    //The loop these kernels replaced: juce::dsp::Oscillator calls its std::function generator for every sample
+    //with the phase in -pi..pi, which the compiler can neither inline nor vectorise
+    auto renderWithGenerator = [](const std::function<float(float)>& generator)
+    {
+        auto phase = 0.0f;
+        auto phaseIncrement = (float)(juce::MathConstants<double>::twoPi * frequency / sampleRate);
+
+        return [generator, phase, phaseIncrement](float* block) mutable
+        {
+            for (int i = 0; i < blockSize; ++i)
+            {
+                block[i] = generator(phase - juce::MathConstants<float>::pi);
+
+                phase += phaseIncrement;
+
+                if (phase >= juce::MathConstants<float>::twoPi)
+                    phase -= juce::MathConstants<float>::twoPi;
+            }
+        };
+    };
+
+    struct WaveComparison
+    {
+        const char* name;
+        int waveType;
+        int tier;
+        std::function<float(float)> generator;
+    };
+
+    const WaveComparison comparisons[] =
+    {
+        { "sine (polynomial tier, std::sin generator)", sine, polynomial, [](float x) { return std::sin(x); } },
+        { "saw", saw, polynomial, [](float x) { return juce::jmap(x, -juce::MathConstants<float>::pi, juce::MathConstants<float>::pi, -1.0f, 1.0f); } },
+        { "square", square, polynomial, [](float x) { return x < 0.0f ? -1.0f : 1.0f; } }
+    };
+
+    report << "Templated wave kernels against a std::function generator per sample:\n";
+
+    for (auto& comparison : comparisons)
+    {
+        auto oscillator = makeOscillator(comparison.waveType, comparison.tier);
+        auto templated = getThroughput([&oscillator](float* block) { oscillator.render(block, blockSize); });
+        auto baseline = getThroughput(renderWithGenerator(comparison.generator));
+
+        report << "  " << comparison.name << ": " << juce::String(templated, 1) << " Msamples/s, std::function "
+               << juce::String(baseline, 1) << " Msamples/s (" << juce::String(templated / baseline, 1) << "x)\n";
+    }
+
+    return report;
+}
@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    PartialOscillator.h
+    Created: 20 Oct 2026 2:37:48pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "WavetableLibrary.h"
+
+//Oscillator of a partial (wave types, sine accuracy tiers and wavetables), in place of juce::dsp::Oscillator.
+//Each wave type is an inline kernel that the render loop template can vectorise
+class PartialOscillator
+{
+public:
+
+    //Same order as the WAVE_TYPE parameters
+    enum WaveType
+    {
+        sine,
+        saw,
+        square
+    };
+
+    //From the most accurate to the cheapest (same order as the SINE_TIER parameters)
+    enum SineTier
+    {
+        exact, //std::sin
+        polynomial, //degree 7 minimax polynomial, max error 6e-7 (-124 dB)
+        table, //4096 points with linear interpolation, max error 3e-7
+        recursive //rotating phasor, re-synchronised with the phase at every block
+    };
+
+    static constexpr int numSineTiers = 4;
+
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+
+    void setFrequency(double newFrequency) noexcept;
+    double getFrequency() const noexcept { return frequency; }
+
+    void setWaveType(int newWaveType) noexcept { waveType = newWaveType; }
+
+    //Only swaps a pointer. The table replaces the wave type, nullptr plays the wave type again
+    void setWavetable(const Wavetable* newTable, float newFramePosition) noexcept;
+
+    void setSineTier(int newTier) noexcept { sineTier = juce::jlimit(0, numSineTiers - 1, newTier); }
+
+    //Plays a CompositeWavetable in place of the wave type until it is set back to nullptr
+    void setCompositeTable(const Wavetable* newTable) noexcept { compositeTable = newTable; }
+
+    //Samples at the unbent frequency elapsed before each sample of the next process calls (warp[0] = 0, one more value
+    //than samples): a voice fills it once for all its partials to apply its pitch bend and glide, so the phase of each
+    //sample is still start + increment * warp[i]. nullptr: constant frequency
+    void setPhaseWarp(const double* newWarp) noexcept { phaseWarp = newWarp; }
+
+    //0..1, position in the cycle
+    double getPhase() const noexcept { return phase; }
+    void setPhase(double newPhase) noexcept { phase = newPhase - std::floor(newPhase); }
+
+    //Polynomial tier for any angle in -pi..pi (also used by the orbit partials)
+    static float sinePolynomial(float x) noexcept
+    {
+        //Minimax coefficients of sin on -pi/2..pi/2 (Remez exchange, odd terms up to x^7)
+        constexpr float c1 = 0.99999661590f;
+        constexpr float c3 = -0.16664828382f;
+        constexpr float c5 = 0.00830632523f;
+        constexpr float c7 = -0.00018363654f;
+
+        //Fold -pi..pi into -pi/2..pi/2 (sin(pi - x) = sin(x))
+        if (x > juce::MathConstants<float>::halfPi)
+            x = juce::MathConstants<float>::pi - x;
+        else if (x < -juce::MathConstants<float>::halfPi)
+            x = -juce::MathConstants<float>::pi - x;
+
+        auto x2 = x * x;
+        return x * (c1 + x2 * (c3 + x2 * (c5 + x2 * c7)));
+    }
+
+    //Throughput and distortion of each sine tier, measured on a rendered sine (not realtime safe)
+    static juce::String runBenchmark();
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        auto& outputBlock = context.getOutputBlock();
+        auto numSamples = (int)outputBlock.getNumSamples();
+
+        if (context.isBypassed)
+        {
+            outputBlock.clear();
+            return;
+        }
+
+        auto* out = outputBlock.getChannelPointer(0);
+
+        if (compositeTable != nullptr)
+            renderWavetable(out, numSamples, *compositeTable, 0.0f);
+        else if (currentTable != nullptr)
+            renderWavetable(out, numSamples, *currentTable, framePosition);
+        else
+            render(out, numSamples);
+
+        for (size_t channel = 1; channel < outputBlock.getNumChannels(); ++channel)
+            juce::FloatVectorOperations::copy(outputBlock.getChannelPointer(channel), out, numSamples);
+    }
+
+private:
+
+    //Picks the kernel of the wave type and sine tier
+    void render(float* out, int numSamples) noexcept;
+    void renderWavetable(float* out, int numSamples, const Wavetable& wave, float position) noexcept;
+    void renderRecursiveSine(float* out, int numSamples) noexcept;
+
+    //out[i] = kernel(phase of sample i), then advances the phase
+    template <typename Kernel>
+    void renderKernel(float* out, int numSamples, const Kernel& kernel) noexcept;
+
+    void advancePhase(int numSamples) noexcept;
+
+    double sampleRate = 44100;
+    double frequency = 440;
+    double increment = 0; //cycles per sample
+
+    //0..1, the output is taken at 2 pi phase - pi like juce::dsp::Oscillator (so that all the wave types line up)
+    double phase = 0;
+
+    //Rotation of one sample for the recursive tier
+    double rotationCos = 1;
+    double rotationSin = 0;
+
+    int waveType = sine;
+    int sineTier = polynomial;
+
+    const Wavetable* currentTable = nullptr;
+    float framePosition = 0;
+
+    const Wavetable* compositeTable = nullptr;
+
+    const double* phaseWarp = nullptr;
+};
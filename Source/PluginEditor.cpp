@@ -9,10 +9,51 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include "InputPlane.h"
+#include "EventReplayer.h"
+#include "DspKernels.h"
+#include "PartialOscillator.h"
+
+namespace
+{
+    //Replays a recording next to it (same name, .wav and .csv) and shows the summary at the end
+    class ReplayWindow : public juce::ThreadWithProgressWindow
+    {
+    public:
+        explicit ReplayWindow(const juce::File& recordingFile)
+            : juce::ThreadWithProgressWindow("Replaying " + recordingFile.getFileName(), true, true), recording(recordingFile)
+        {
+        }
+
+        void run() override
+        {
+            result = replayer.open(recording);
+
+            if (result.wasOk())
+                result = replayer.render(recording.withFileExtension("wav"), recording.withFileExtension("csv"),
+                    [this](double progress) { setProgress(progress); return !threadShouldExit(); });
+        }
+
+        void threadComplete(bool userPressedCancel) override
+        {
+            if (userPressedCancel)
+                return;
+
+            if (result.wasOk())
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon, "Event replay", replayer.getReport());
+            else
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Event replay", result.getErrorMessage());
+        }
+
+    private:
+        juce::File recording;
+        EventReplayer replayer;
+        juce::Result result = juce::Result::ok();
+    };
+}
 
 //==============================================================================
 FractalSynthesisAudioProcessorEditor::FractalSynthesisAudioProcessorEditor (FractalSynthesisAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p), inputPlaneComponent(initialPointXSlider, initialPointYSlider)
+    : AudioProcessorEditor (&p), audioProcessor (p), inputPlaneComponent(p, initialPointXSlider, initialPointYSlider)
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
@@ -47,12 +88,14 @@ FractalSynthesisAudioProcessorEditor::FractalSynthesisAudioProcessorEditor (Frac
         sustainSliders.add(new juce::Slider());
         releaseSliders.add(new juce::Slider());
         waveTypeComboBoxes.add(new juce::ComboBox());
+        wavetableComboBoxes.add(new juce::ComboBox());
 
         attackLabels.add(new juce::Label());
         decayLabels.add(new juce::Label());
         sustainLabels.add(new juce::Label());
         releaseLabels.add(new juce::Label());
         waveTypeLabels.add(new juce::Label());
+        wavetableLabels.add(new juce::Label());
         
 
         setSliderStyle(attackSliders[i]);
@@ -87,36 +130,53 @@ FractalSynthesisAudioProcessorEditor::FractalSynthesisAudioProcessorEditor (Frac
         waveTypeComboBoxes[i]->addItem("Saw", 2);
         waveTypeComboBoxes[i]->addItem("Square", 3);
 
-        attackAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "ATTACK" + std::to_string(i), *attackSliders[i]);
-
-        sustainAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "SUSTAIN" + std::to_string(i), *sustainSliders[i]);
-
-        decayAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "DECAY" + std::to_string(i), *decaySliders[i]);
+        wavetableLabels[i]->attachToComponent(wavetableComboBoxes[i], false);
+        wavetableLabels[i]->setJustificationType(juce::Justification::centred);
+        wavetableLabels[i]->setText("Table", juce::dontSendNotification);
+        wavetableComboBoxes[i]->setTextWhenNothingSelected("Missing table");
+
+        auto* wavetableComboBox = wavetableComboBoxes[i];
+        wavetableComboBox->onChange = [this, i, wavetableComboBox]
+        {
+            if (wavetableComboBox->getSelectedId() > 0 && wavetableAttachments[i] != nullptr)
+                wavetableAttachments[i]->setValueAsCompleteGesture((float)(wavetableComboBox->getSelectedId() - 1));
+        };
+
+        //Create and init wave visualizers
+        auto waveVis = new juce::AudioVisualiserComponent(1);
+        waveVis->setBufferSize(512);
+        waveVis->setSamplesPerBlock(256);
+        waveVis->setRepaintRate(30);
+        waveVis->setColours(juce::Colours::black, juce::Colours::deepskyblue);
+        waveVisualisers.add(waveVis);
 
-        releaseAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "RELEASE" + std::to_string(i), *releaseSliders[i]);
+    }
 
-        waveTypeAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.apvts, "WAVE_TYPE" + std::to_string(i), *waveTypeComboBoxes[i]);
 
+    for (size_t i = 0; i < fractalImages.size(); i++)
+    {
+        fractalImages[i] = audioProcessor.getSharedResources().getFractalImage(i);
     }
 
 
-    fractalComboBoxAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.apvts, "FRACTAL_FUNCTION", fractalFunctionComboBox);
+    //Part n plays on MIDI channel n in multi-timbral mode, otherwise only the first part plays (on every channel)
+    for (int i = 0; i < processor_consts::NUM_PARTS; i++)
+        partComboBox.addItem("Part " + juce::String(i + 1), i + 1);
 
+    partComboBox.setSelectedId(1, juce::dontSendNotification);
 
-    sliderInitialPointXAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "INITIAL_POINT_X", initialPointXSlider);
+    multiTimbralAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(audioProcessor.apvts, "MULTITIMBRAL", multiTimbralButton);
 
+    updateWavetableChoosers();
 
-    sliderInitialPointYAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, "INITIAL_POINT_Y", initialPointYSlider);
-    
+    attachPart(0);
 
-    mandelbrotImage = juce::ImageCache::getFromMemory(BinaryData::Mandelbrot2_png, BinaryData::Mandelbrot2_pngSize);
-    burningShipImage = juce::ImageCache::getFromMemory(BinaryData::BurningShip2_png, BinaryData::BurningShip2_pngSize);
-    tricornImage = juce::ImageCache::getFromMemory(BinaryData::Tricorn2_png, BinaryData::Tricorn2_pngSize);
-    
+    partComboBox.addListener(this);
+    fractalFunctionComboBox.addListener(this);
 
-    currentImage = mandelbrotImage;
+    addAndMakeVisible(partComboBox);
 
-    fractalFunctionComboBox.addListener(this);
+    addAndMakeVisible(multiTimbralButton);
    
     addAndMakeVisible(fractalFunctionComboBox);
 
@@ -139,17 +199,27 @@ FractalSynthesisAudioProcessorEditor::FractalSynthesisAudioProcessorEditor (Frac
 
         addAndMakeVisible(waveTypeComboBoxes[i]);
 
-       addAndMakeVisible(audioProcessor.waveVisualisers[i]);
+        addAndMakeVisible(wavetableComboBoxes[i]);
+
+       addAndMakeVisible(waveVisualisers[i]);
 
     }
 
 
     setSize(700, 700);
 
+    audioProcessor.setWaveScopesActive(true);
+    startTimerHz(30);
+
 }
 
 FractalSynthesisAudioProcessorEditor::~FractalSynthesisAudioProcessorEditor()
 {
+    stopTimer();
+    audioProcessor.setWaveScopesActive(false);
+
+    //A replay in progress is stopped (the recording itself goes on without the editor)
+    replayWindow.reset();
 }
 
 //==============================================================================
@@ -188,7 +258,7 @@ void FractalSynthesisAudioProcessorEditor::paint (juce::Graphics& g)
     g.setColour(juce::Colours::darkorange);
     for (size_t i = 0; i < processor_consts::NUM_PARTIALS; i++)
     {
-        g.drawRoundedRectangle(audioProcessor.waveVisualisers[i]->getBounds().expanded(3).toFloat(), 5.0f, 2.0f);
+        g.drawRoundedRectangle(waveVisualisers[i]->getBounds().expanded(3).toFloat(), 5.0f, 2.0f);
     }
 
 
@@ -220,19 +290,273 @@ void FractalSynthesisAudioProcessorEditor::resized()
 
 }
 
+void FractalSynthesisAudioProcessorEditor::mouseDown(const juce::MouseEvent& event)
+{
+    if (!event.mods.isPopupMenu())
+        return;
+
+    auto recording = audioProcessor.isEventRecording();
+    auto replaying = replayWindow != nullptr && replayWindow->isThreadRunning();
+
+    juce::PopupMenu menu;
+    menu.addItem(recordItem, recording ? "Stop event recording" : "Start event recording");
+    menu.addItem(replayItem, "Replay a recording...", !recording && !replaying);
+    menu.addItem(showRecordingsItem, "Show recordings");
+    menu.addSeparator();
+    menu.addItem(orbitMappingItem, "Edit orbit mapping...");
+    menu.addItem(benchmarkItem, "Run benchmarks");
+
+    //The callback is dropped if the editor is deleted while the menu is open
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this).withMousePosition(),
+        juce::ModalCallbackFunction::forComponent(contextMenuCallback, this));
+}
+
+void FractalSynthesisAudioProcessorEditor::contextMenuCallback(int result, FractalSynthesisAudioProcessorEditor* editor)
+{
+    if (editor == nullptr || result == 0)
+        return;
+
+    auto& processor = editor->audioProcessor;
+    auto directory = FractalSynthesisAudioProcessor::getDefaultRecordingsDirectory();
+
+    switch (result)
+    {
+    case recordItem:
+        if (processor.isEventRecording())
+        {
+            processor.stopEventRecording();
+        }
+        else
+        {
+            auto file = directory.getChildFile(juce::Time::getCurrentTime().formatted("%Y-%m-%d %H-%M-%S") + ".fer");
+
+            if (!processor.startEventRecording(file))
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Event recording",
+                    "Can't record to " + file.getFullPathName() + " (the plugin must be playing)");
+        }
+        break;
+    case replayItem:
+        editor->chooseRecordingToReplay();
+        break;
+    case showRecordingsItem:
+        directory.createDirectory();
+        directory.startAsProcess();
+        break;
+    case orbitMappingItem:
+    {
+        auto partIndex = juce::jmax(0, editor->partComboBox.getSelectedId() - 1);
+        editor->showOrbitMappingWindow(partIndex, processor.getOrbitMapping(partIndex), {});
+        break;
+    }
+    case benchmarkItem:
+        //Takes a few seconds: the kernels are timed on a background thread, the report is shown when it is done.
+        //New processors need the message thread (timers, async updaters), so their benchmarks are run there after it
+        juce::Thread::launch([]
+            {
+                auto kernels = DspKernels::runBenchmark() + "\n" + PartialOscillator::runBenchmark();
+
+                juce::MessageManager::callAsync([kernels]
+                    {
+                        auto report = kernels + "\n" + FractalSynthesisAudioProcessor::runInstantiationBenchmark(16)
+                            + "\n" + FractalSynthesisAudioProcessor::runMicroblockBenchmark();
+
+                        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon, "Benchmarks", report);
+                    });
+            });
+        break;
+    default:
+        break;
+    }
+}
+
+void FractalSynthesisAudioProcessorEditor::chooseRecordingToReplay()
+{
+    recordingChooser = std::make_unique<juce::FileChooser>("Replay a recording",
+        FractalSynthesisAudioProcessor::getDefaultRecordingsDirectory(), "*.fer");
+
+    juce::Component::SafePointer<FractalSynthesisAudioProcessorEditor> safeThis(this);
+
+    recordingChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+        [safeThis](const juce::FileChooser& chooser)
+        {
+            auto file = chooser.getResult();
+
+            if (safeThis == nullptr || !file.existsAsFile())
+                return;
+
+            safeThis->replayWindow = std::make_unique<ReplayWindow>(file);
+            safeThis->replayWindow->launchThread();
+        });
+}
+
+void FractalSynthesisAudioProcessorEditor::showOrbitMappingWindow(int partIndex, const juce::String& text, const juce::String& message)
+{
+    const juce::String help =
+        "One line per setting: detune[i] = ... and rate[i] = ... (tremolo rate in Hz), evaluated for each partial i.\n"
+        "z[i] is the point of the orbit of partial i and c the seed: use them with re(), im(), abs() or arg(). "
+        "Also available: i, pi, + - * / ^, sqrt, sin, cos, exp, log, floor, min, max, pow and sum (over the partials).\n"
+        "The settings left out, or an empty text, keep the built-in mapping.";
+
+    mappingWindow.reset();
+
+    mappingEditor.setMultiLine(true);
+    mappingEditor.setReturnKeyStartsNewLine(true);
+    mappingEditor.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 14.0f, juce::Font::plain));
+    mappingEditor.setSize(460, 140);
+    mappingEditor.setText(text, false);
+
+    mappingWindow = std::make_unique<juce::AlertWindow>("Orbit mapping of part " + juce::String(partIndex + 1),
+        message.isNotEmpty() ? message : help, juce::AlertWindow::NoIcon, this);
+
+    mappingWindow->addCustomComponent(&mappingEditor);
+    mappingWindow->addButton("Apply", 1);
+    mappingWindow->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+
+    juce::Component::SafePointer<FractalSynthesisAudioProcessorEditor> safeThis(this);
+
+    mappingWindow->enterModalState(true, juce::ModalCallbackFunction::create([safeThis, partIndex](int result)
+        {
+            if (safeThis == nullptr || result == 0)
+                return;
+
+            //Compiled here, off the audio thread
+            auto newText = safeThis->mappingEditor.getText();
+            auto compiled = safeThis->audioProcessor.setOrbitMapping(partIndex, newText);
+
+            if (compiled.failed())
+            {
+                auto error = compiled.getErrorMessage();
+
+                //Opened again once this window is gone
+                juce::MessageManager::callAsync([safeThis, partIndex, newText, error]
+                    {
+                        if (safeThis != nullptr)
+                            safeThis->showOrbitMappingWindow(partIndex, newText, error);
+                    });
+            }
+        }));
+}
+
 void FractalSynthesisAudioProcessorEditor::comboBoxChanged(juce::ComboBox* combo){
     
 
-    if (combo->getSelectedId() == 1)
-        currentImage = mandelbrotImage;
-    else if (combo->getSelectedId() == 2)
-        currentImage = burningShipImage;
-    else if(combo->getSelectedId() == 3)
-        currentImage = tricornImage;
+    if (combo == &partComboBox)
+    {
+        attachPart(partComboBox.getSelectedId() - 1);
+        return;
+    }
+
+    updateFractalImage();
+
+}
+
+void FractalSynthesisAudioProcessorEditor::attachPart(int partIndex)
+{
+    partIndex = juce::jlimit(0, processor_consts::NUM_PARTS - 1, partIndex);
+    auto prefix = FractalSynthesisAudioProcessor::getPartParameterPrefix(partIndex);
+
+    //The old attachments must go before the new ones take the same controls
+    fractalComboBoxAttachment.reset();
+    sliderInitialPointXAttachment.reset();
+    sliderInitialPointYAttachment.reset();
+
+    fractalComboBoxAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.apvts, prefix + "FRACTAL_FUNCTION", fractalFunctionComboBox);
+
+    sliderInitialPointXAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, prefix + "INITIAL_POINT_X", initialPointXSlider);
+
+    sliderInitialPointYAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, prefix + "INITIAL_POINT_Y", initialPointYSlider);
+
+    for (size_t i = 0; i < processor_consts::NUM_PARTIALS; i++)
+    {
+        auto indexString = juce::String(i);
+
+        attackAttachments[i].reset();
+        sustainAttachments[i].reset();
+        decayAttachments[i].reset();
+        releaseAttachments[i].reset();
+        waveTypeAttachments[i].reset();
+        wavetableAttachments[i].reset();
+
+        attackAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, prefix + "ATTACK" + indexString, *attackSliders[i]);
+
+        sustainAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, prefix + "SUSTAIN" + indexString, *sustainSliders[i]);
+
+        decayAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, prefix + "DECAY" + indexString, *decaySliders[i]);
+
+        releaseAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, prefix + "RELEASE" + indexString, *releaseSliders[i]);
+
+        waveTypeAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.apvts, prefix + "WAVE_TYPE" + indexString, *waveTypeComboBoxes[i]);
+
+        auto* wavetableComboBox = wavetableComboBoxes[(int)i];
+        wavetableAttachments[i] = std::make_unique<juce::ParameterAttachment>(*audioProcessor.apvts.getParameter(prefix + "WAVETABLE" + indexString),
+            [wavetableComboBox](float index) { wavetableComboBox->setSelectedId((int)index + 1, juce::dontSendNotification); });
+        wavetableAttachments[i]->sendInitialUpdate();
+    }
+
+    //The wave visualisers and the input plane follow the selected part
+    audioProcessor.setEditedPart(partIndex);
+    inputPlaneComponent.setPart(partIndex);
+
+    for (auto* waveVis : waveVisualisers)
+        waveVis->clear();
+
+    updateFractalImage();
+}
+
+void FractalSynthesisAudioProcessorEditor::updateFractalImage()
+{
+    auto index = fractalFunctionComboBox.getSelectedId() - 1;
+
+    if (index >= 0 && index < (int)fractalImages.size())
+    {
+        currentImage = fractalImages[index]->image;
+        inputPlaneComponent.setFractal(index);
+    }
 
 
     repaint();
+}
+
+
+void FractalSynthesisAudioProcessorEditor::updateWavetableChoosers()
+{
+    auto& library = audioProcessor.getSharedResources().getWavetableLibrary();
+
+    if (library.getNumTables() == numListedWavetables)
+        return;
+
+    auto names = library.getTableNames();
+    numListedWavetables = names.size();
+
+    for (size_t i = 0; i < processor_consts::NUM_PARTIALS; i++)
+    {
+        auto* comboBox = wavetableComboBoxes[(int)i];
+        comboBox->clear(juce::dontSendNotification);
+        comboBox->addItem("Off", 1);
 
+        for (int table = 0; table < names.size(); table++)
+            comboBox->addItem(names[table], table + 2);
+
+        //Selects the table of the param again
+        if (wavetableAttachments[i] != nullptr)
+            wavetableAttachments[i]->sendInitialUpdate();
+    }
+}
+
+void FractalSynthesisAudioProcessorEditor::timerCallback()
+{
+    updateWavetableChoosers();
+
+    float samples[1024];
+    const float* channels[] = { samples };
+
+    for (int i = 0; i < waveVisualisers.size(); i++)
+    {
+        int numSamples;
+
+        while ((numSamples = audioProcessor.pullWaveScopeSamples(i, samples, juce::numElementsInArray(samples))) > 0)
+            waveVisualisers[i]->pushBuffer(channels, 1, numSamples);
+    }
 }
 
 
@@ -264,8 +588,10 @@ void FractalSynthesisAudioProcessorEditor::buildOscSubArea(int index, juce::Rect
     sustainSliders[index]->setBounds(oscSRArea.removeFromLeft(oscSRArea.getWidth() / 2).reduced(3));
     releaseSliders[index]->setBounds(oscSRArea.reduced(3));
 
-    waveTypeComboBoxes[index]->setBounds(oscWaveTypeArea.withHeight(oscWaveTypeArea.getHeight() * 0.95));
-    audioProcessor.waveVisualisers[index]->setBounds(oscWaveVisualizerArea.withHeight(oscWaveVisualizerArea.getHeight()*0.95).reduced(3));
+    oscWaveTypeArea = oscWaveTypeArea.withHeight(oscWaveTypeArea.getHeight() * 0.95);
+    waveTypeComboBoxes[index]->setBounds(oscWaveTypeArea.removeFromLeft(oscWaveTypeArea.getWidth() / 2).reduced(2, 0));
+    wavetableComboBoxes[index]->setBounds(oscWaveTypeArea.reduced(2, 0));
+    waveVisualisers[index]->setBounds(oscWaveVisualizerArea.withHeight(oscWaveVisualizerArea.getHeight()*0.95).reduced(3));
     
 }
 
@@ -278,7 +604,10 @@ void FractalSynthesisAudioProcessorEditor::buildFractalArea(juce::Rectangle<int>
     inputPlaneComponent.setBounds(inputPlaneArea.reduced(3));
 
     auto comboBoxArea = tempBounds.removeFromTop(tempBounds.getHeight() * 0.33).reduced(5);
-    fractalFunctionComboBox.setBounds(comboBoxArea);
+    auto partArea = comboBoxArea.removeFromRight(comboBoxArea.getWidth() / 2);
+    fractalFunctionComboBox.setBounds(comboBoxArea.reduced(2, 0));
+    partComboBox.setBounds(partArea.removeFromLeft(partArea.getWidth() / 2).reduced(2, 0));
+    multiTimbralButton.setBounds(partArea.reduced(2, 0));
 
     auto initialPointXSliderArea = (tempBounds.removeFromTop(tempBounds.getHeight() * 0.5).reduced(5));
     initialPointXSlider.setBounds(initialPointXSliderArea.reduced(5));
@@ -15,7 +15,7 @@
 //==============================================================================
 /**
 */
-class FractalSynthesisAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::ComboBox::Listener
+class FractalSynthesisAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::ComboBox::Listener, private juce::Timer
 {
 public:
     FractalSynthesisAudioProcessorEditor (FractalSynthesisAudioProcessor&);
@@ -25,6 +25,9 @@ public:
     void paint (juce::Graphics&) override;
     void resized() override;
 
+    //Right click on the background: event recording and replay, orbit mapping, benchmarks
+    void mouseDown(const juce::MouseEvent& event) override;
+
 
 
 private:
@@ -34,19 +37,56 @@ private:
 
     void comboBoxChanged(juce::ComboBox* combo) override;
 
+    //Moves the partial samples collected by the processor into the wave visualisers, refreshes the wavetable choosers
+    void timerCallback() override;
+
     void setSliderStyle(juce::Slider* slider);
 
     void buildOscSubArea(int index, juce::Rectangle<int> bounds);
 
     void buildFractalArea(juce::Rectangle<int> bounds);
+
+    //Attaches the controls to the params of the given part (the controls are shared by all the parts)
+    void attachPart(int partIndex);
+
+    void updateFractalImage();
+
+    //Fills the wavetable choosers with the tables of the library (they are scanned in the background, so the list grows)
+    void updateWavetableChoosers();
+
+    //Runs the item chosen in the right click menu (mouseDown)
+    static void contextMenuCallback(int result, FractalSynthesisAudioProcessorEditor* editor);
+
+    enum ContextMenuItems
+    {
+        recordItem = 1,
+        replayItem,
+        showRecordingsItem,
+        orbitMappingItem,
+        benchmarkItem
+    };
+
+    //Asks for a recording and replays it in the background
+    void chooseRecordingToReplay();
+
+    std::unique_ptr<juce::FileChooser> recordingChooser;
+    std::unique_ptr<juce::ThreadWithProgressWindow> replayWindow;
+
+    //Edits the orbit mapping of a part, a text that doesn't compile comes back with its error
+    void showOrbitMappingWindow(int partIndex, const juce::String& text, const juce::String& message);
+
+    juce::TextEditor mappingEditor; //shown by the window, so declared before it
+    std::unique_ptr<juce::AlertWindow> mappingWindow;
     
-    juce::Image mandelbrotImage;
-    juce::Image burningShipImage;
-    juce::Image tricornImage;
+    //Background images, decoded once and shared by all the editors
+    std::array<SharedResources::ImageResource::Ptr, 3> fractalImages;
 
     juce::Image currentImage;
 
     //Buttons, combobox, sliders...
+    juce::ComboBox partComboBox;
+    juce::ToggleButton multiTimbralButton{ "Multi-timbral" };
+
     juce::ComboBox fractalFunctionComboBox;
 
     juce::Slider initialPointXSlider;
@@ -74,6 +114,14 @@ private:
 
     juce::OwnedArray<juce::ComboBox> waveTypeComboBoxes;
 
+    juce::OwnedArray<juce::Label> wavetableLabels;
+
+    juce::OwnedArray<juce::ComboBox> wavetableComboBoxes; //item id = WAVETABLE param + 1 (1: off)
+
+    int numListedWavetables = -1;
+
+
+    juce::OwnedArray<juce::AudioVisualiserComponent> waveVisualisers;
 
     InputPlane inputPlaneComponent;
 
@@ -83,6 +131,8 @@ private:
 
     //Attachments (must be declared after the GUI elements to avoid crashes when closing the plugin)
    
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> multiTimbralAttachment;
+
     std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> fractalComboBoxAttachment;
 
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> sliderInitialPointXAttachment;
@@ -98,6 +148,10 @@ private:
     std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>, processor_consts::NUM_PARTIALS> releaseAttachments;
 
     std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment>, processor_consts::NUM_PARTIALS> waveTypeAttachments;
+
+    //The WAVETABLE params are plain indexes and the choosers only list the tables loaded so far, so a ComboBoxAttachment
+    //(that spreads the items over the whole range) doesn't fit
+    std::array<std::unique_ptr<juce::ParameterAttachment>, processor_consts::NUM_PARTIALS> wavetableAttachments;
     
 
     juce::Rectangle<int> osc1Area;
@@ -10,69 +10,89 @@
 #include "PluginEditor.h"
 #include "SynthSound.h"
 #include "SynthVoice.h"
+#include "SynthPart.h"
+#include "DspKernels.h"
+
+namespace
+{
+    //Written by the processor only: hosts show it but don't record automation for it
+    class ReadOnlyIntParameter : public juce::AudioParameterInt
+    {
+    public:
+        using juce::AudioParameterInt::AudioParameterInt;
+
+        bool isAutomatable() const override { return false; }
+    };
+
+    //One optional output per partial after the main one, off by default
+    juce::AudioProcessor::BusesProperties withPartialOutputs(const juce::AudioProcessor::BusesProperties& buses)
+    {
+        auto result = buses;
+
+        for (int j = 0; j < processor_consts::NUM_PARTIALS; j++)
+            result = result.withOutput("Partial " + juce::String(j + 1), juce::AudioChannelSet::stereo(), false);
+
+        return result;
+    }
+}
 
 //==============================================================================
 FractalSynthesisAudioProcessor::FractalSynthesisAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
+     : AudioProcessor (withPartialOutputs (BusesProperties()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
-                       ), apvts (*this, nullptr, "Parameters", FractalSynthesisAudioProcessor::createParams())//consutructors of the audio components
+                       )), apvts (*this, nullptr, "Parameters", FractalSynthesisAudioProcessor::createParams())//consutructors of the audio components
 #endif
 {
 
-    //Create synth voices
-
-    //add voicesNumber voices to the synth (allows voicesNumber MIDI notes to be played at the same time)
-  
-    synth = new juce::Synthesiser();
-    synth->addSound(new SynthSound());
-    
-    for (size_t voice = 0; voice < processor_consts::NUM_VOICES; voice++)
+    //The voices are only created in the first prepareToPlay and the wave visualisers by the editor,
+    //so that hosts can instantiate the plugin quickly (e.g. when loading big sessions).
+    //The parts themselves are light: each one listens to its own fractal and wave type params
+    for (int i = 0; i < processor_consts::NUM_PARTS; i++)
     {
-        synth->addVoice(new SynthVoice(processor_consts::NUM_PARTIALS));
-
-    }
-
-    //Create and init wave visualizers
-    for (size_t i = 0; i < processor_consts::NUM_PARTIALS; i++)
-    {
-        auto waveVis = new juce::AudioVisualiserComponent(1);
-        waveVis->setBufferSize(512);
-        waveVis->setSamplesPerBlock(256);
-        waveVis->setRepaintRate(30);
-        waveVis->setColours(juce::Colours::black, juce::Colours::deepskyblue);
-        waveVisualisers.add(waveVis);
+        parts.add(new SynthPart(i, apvts, *sharedResources, commands));
+        compositeRenderer.addTable(&parts.getLast()->getCompositeWavetable());
     }
 
-    //Add this as listener to the fractal params
-    //(usually this is not needed when working with apvts and attachments,
-    //but for performance reasons we don't want to recompute
-    //the fractal succession all the time)
-    apvts.addParameterListener("FRACTAL_FUNCTION", this);
+    multiTimbral = apvts.getRawParameterValue("MULTITIMBRAL");
+    microblockSize = apvts.getRawParameterValue("MICROBLOCK_SIZE");
+    polyphony = apvts.getRawParameterValue("POLYPHONY");
+    apvts.addParameterListener("POLYPHONY", this);
+    apvts.addParameterListener("MULTITIMBRAL", this);
 
-    apvts.addParameterListener("INITIAL_POINT_X", this);
+    updateMidiChannels();
 
-    apvts.addParameterListener("INITIAL_POINT_Y", this);
+    //The partial outputs are found in prepareToPlay
+    partialBusOffsets.fill(-1);
 
-    //I also use the callback to update the wavetype instead of doing it inside process block
-    //Since it would probably be a bit computationally heavy, and we don't care too much aboute response time
-    //for these params
-    apvts.addParameterListener("WAVE_TYPE0", this);
-    apvts.addParameterListener("WAVE_TYPE1", this);
-    apvts.addParameterListener("WAVE_TYPE2", this);
-    apvts.addParameterListener("WAVE_TYPE3", this);
+    cpuLevelParameter = apvts.getParameter("CPU_LEVEL");
+    startTimerHz(10);
 
+    recorder.setNumParameters(getParameters().size());
 
 }
 
 FractalSynthesisAudioProcessor::~FractalSynthesisAudioProcessor()
 {
+    stopTimer();
+    cancelPendingUpdate();
+    apvts.removeParameterListener("MULTITIMBRAL", this);
+    apvts.removeParameterListener("POLYPHONY", this);
+
+    recorder.stop();
+    compositeRenderer.stop();
+
+    renderPool.reset();
 
+    //The voices hold references to the shared tables, so delete them before cleaning the shared cache
+    parts.clear();
+
+    sharedResources->releaseUnusedResources();
 }
 
 //==============================================================================
@@ -110,7 +130,7 @@ bool FractalSynthesisAudioProcessor::isMidiEffect() const
 
 double FractalSynthesisAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return masterEffects.getTailLengthSeconds();
 }
 
 int FractalSynthesisAudioProcessor::getNumPrograms()
@@ -143,18 +163,56 @@ void FractalSynthesisAudioProcessor::prepareToPlay (double sampleRate, int sampl
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
 
+    createVoices();
+
+    sharedResources->startLoadingWavetables();
+    compositeRenderer.start();
+
+    governor.prepare(sampleRate);
+
+    //Reads the CPU features before the first block (the kernels are chosen once per process)
+    DspKernels::get();
+
+    //The voices render for the main output, the partial outputs have the same channels
+    auto numChannels = getMainBusNumOutputChannels();
+    auto numOutputChannels = getTotalNumOutputChannels();
 
-    //Prepare all the voices inside the synth
+    updatePartialBuses();
 
-    for (int i = 0; i < synth->getNumVoices(); i++)
+    //Nothing changed since the last call (e.g. the host toggled the transport or the offline mode):
+    //the voices and their memory are still there, just stop what was playing
+    if (sampleRate == preparedSampleRate && samplesPerBlock <= preparedBlockSize && numChannels == preparedNumChannels
+        && numOutputChannels == preparedNumOutputChannels)
     {
-        if (auto voice = dynamic_cast<SynthVoice*>(synth->getVoice(i)))
+        for (auto* part : parts)
         {
-            voice->prepareToPlay(sampleRate, samplesPerBlock, getTotalNumOutputChannels());
+            if (part->hasVoices() && !part->isReady())
+                part->prepareToPlay(sampleRate, preparedBlockSize, numChannels, numOutputChannels);
+
+            part->allNotesOff();
         }
 
+        masterEffects.reset();
+        updateLatency();
+        preparePartialBusDelays(sampleRate, preparedBlockSize, numChannels);
+        return;
+    }
+
+    //Prepare all the voices inside the parts (in place, nothing is re-created)
+    for (auto* part : parts)
+    {
+        if (part->hasVoices())
+            part->prepareToPlay(sampleRate, samplesPerBlock, numChannels, numOutputChannels);
     }
-    synth->setCurrentPlaybackSampleRate(sampleRate);
+
+    masterEffects.prepare(sampleRate, samplesPerBlock, numChannels);
+    updateLatency();
+    preparePartialBusDelays(sampleRate, samplesPerBlock, numChannels);
+
+    preparedSampleRate = sampleRate;
+    preparedBlockSize = samplesPerBlock;
+    preparedNumChannels = numChannels;
+    preparedNumOutputChannels = numOutputChannels;
 
 }
 
@@ -162,8 +220,10 @@ void FractalSynthesisAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
-    synth->clearSounds();
-    synth->clearVoices();
+    // The voices and their buffers are kept: hosts often release and prepare again with the same settings,
+    // and the next prepareToPlay must find the synth ready to play (without a burst of allocations)
+    for (auto* part : parts)
+        part->allNotesOff();
   
 }
 
@@ -182,6 +242,15 @@ bool FractalSynthesisAudioProcessor::isBusesLayoutSupported (const BusesLayout&
      && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
 
+    //Each partial output is off or has the channels of the main output
+    for (int bus = 1; bus < layouts.outputBuses.size(); ++bus)
+    {
+        auto channelSet = layouts.getChannelSet(false, bus);
+
+        if (!channelSet.isDisabled() && channelSet != layouts.getMainOutputChannelSet())
+            return false;
+    }
+
     // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
@@ -196,6 +265,8 @@ bool FractalSynthesisAudioProcessor::isBusesLayoutSupported (const BusesLayout&
 void FractalSynthesisAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    governor.beginBlock();
+
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -209,57 +280,143 @@ void FractalSynthesisAudioProcessor::processBlock (juce::AudioBuffer<float>& buf
         buffer.clear (i, 0, buffer.getNumSamples());
 
 
-    std::complex<double> z = 0; //starting z
-    std::complex<double> c = 0; //starting point
+    auto numSamples = buffer.getNumSamples();
+    auto bpm = getHostBpm();
+
+    //Views of the buses of the host buffer, the voices add their partials straight into them
+    referToOutputBuses(buffer, numSamples, outputs);
 
-    if (updatedFractal)
+    //Checked once, so that a recording always has whole blocks
+    auto recordEvents = recorder.isRecording();
+
+    if (recordEvents)
     {
-        //Get the starting point for the fractal
-        auto& startingX = *apvts.getRawParameterValue("INITIAL_POINT_X");
-        auto& startingY = *apvts.getRawParameterValue("INITIAL_POINT_Y");
+        recorder.recordBlockStart(numSamples, governor.getLevel(), bpm);
+        recorder.recordParameters(getParameters());
+        recorder.recordMidi(midiMessages);
+    }
+
+    //Apply the updates received since the last block (each part recomputes its fractal at most once)
+    SynthCommand command;
 
+    while (commands.pop(command))
+    {
+        if (recordEvents && command.type == SynthCommand::seedPoint)
+            recorder.recordSeedPoint(command.part, command.x, command.y);
 
-        float x = startingX.load();
-        float y = startingY.load();
+        parts[command.part]->handleCommand(command);
+    }
 
-        c = std::complex<double>(x, y);
+    for (auto* part : parts)
+        part->applyPendingCommands();
 
-        generateFractalSuccession(c);
+    int numActiveParts = 0;
 
-        generateLFORates(fractalPoints);
+    if (isMultiTimbral())
+    {
+        //Skip the parts that are silent and receive nothing in this block
+        for (auto* part : parts)
+        {
+            if (part->isReady() && part->isActive(midiMessages))
+                activeParts[(size_t)numActiveParts++] = part;
+        }
+    }
+    else if (parts[0]->isReady())
+    {
+        activeParts[0] = parts[0];
+        numActiveParts = 1;
+    }
 
-        generateFreqDetunes(fractalPoints);
+    governor.setNonRealtime(isNonRealtime());
+    auto quality = CpuGovernor::getQuality(governor.getLevel());
+    auto microblockSamples = getMicroblockSamples((int)microblockSize->load());
+    auto numVoices = (int)polyphony->load();
 
-        updatedFractal = false;
+    for (int i = 0; i < numActiveParts; ++i)
+    {
+        activeParts[(size_t)i]->setQuality(quality);
+        activeParts[(size_t)i]->setMicroblockSize(microblockSamples);
+        activeParts[(size_t)i]->setPolyphony(numVoices);
     }
 
+    auto pool = activeRenderPool.load(std::memory_order_acquire);
 
-    for (int i = 0; i < synth->getNumVoices(); ++i)
+    if (numActiveParts > 1 && pool != nullptr && numSamples <= preparedBlockSize)
     {
-        
-        if (auto voice = dynamic_cast<SynthVoice*>(synth->getVoice(i)))
+        //Every part renders in its own buffer on a different core, then the buffers are mixed here
+        currentMidi = &midiMessages;
+        currentNumSamples = numSamples;
+
+        pool->run(renderPartJob, this, numActiveParts);
+
+        //The part buffers have all the output buses
+        for (int i = 0; i < numActiveParts; ++i)
         {
-            // Osc controls
-            // ADSR
-            // LFO ecc...
+            auto& partBuffer = activeParts[(size_t)i]->getPartBuffer();
 
-            for (size_t j = 0; j < processor_consts::NUM_PARTIALS; j++)
-            {
-                updateADSR(j, voice);
-                //Push current voice and partial buffer to wave visualizer
-                waveVisualisers[j]->pushBuffer(*voice->synthBuffers[j]);
-            }
-            voice->setFreqDetunes(freqDetunes);
-            voice->setLFORates(lfoRates);
-            
+            for (int channel = 0; channel < juce::jmin(buffer.getNumChannels(), partBuffer.getNumChannels()); ++channel)
+                buffer.addFrom(channel, 0, partBuffer, channel, 0, numSamples);
         }
-    
     }
-  
-    synth->renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
+    else
+    {
+        //A single part (the usual case) renders straight into the output
+        for (int i = 0; i < numActiveParts; ++i)
+            activeParts[(size_t)i]->render(outputs, midiMessages, numSamples);
+    }
+
+    //The partials with their own output join the main mix once, after all the parts
+    for (auto& partialBus : outputs.partials)
+    {
+        for (int channel = 0; channel < juce::jmin(partialBus.getNumChannels(), outputs.main.getNumChannels()); ++channel)
+            outputs.main.addFrom(channel, 0, partialBus, channel, 0, numSamples);
+    }
+
+    //Once on the summed output (the partial outputs stay dry)
+    masterEffects.process(outputs.main, numSamples, bpm);
 
+    //The partial outputs follow the latency of the limiter (what was in the delays is stale when it changes)
+    auto latency = masterEffects.getProcessedLatencySamples();
+
+    if (latency != partialBusLatency)
+    {
+        for (auto& delay : partialBusDelays)
+            delay.reset();
+
+        partialBusLatency = latency;
+    }
+
+    if (latency > 0)
+    {
+        for (size_t j = 0; j < partialBusDelays.size(); j++)
+        {
+            auto& partialBus = outputs.partials[j];
+
+            if (partialBus.getNumChannels() != preparedNumChannels)
+                continue;
+
+            juce::dsp::AudioBlock<float> block(partialBus);
+            partialBusDelays[j].setDelay((float)latency);
+            partialBusDelays[j].process(juce::dsp::ProcessContextReplacing<float>(block));
+        }
+    }
+
+    //Push the partials of the part shown in the editor to the wave visualisers (only if the editor is open)
+    if (waveScopesActive.load(std::memory_order_relaxed))
+    {
+        auto* shownPart = parts[editedPart.load(std::memory_order_relaxed)];
+
+        if (shownPart->isReady())
+            shownPart->pushWaveScopes(waveScopes);
+    }
+
+
+    if (recordEvents)
+        recorder.recordBlockEnd();
 
     midiMessages.clear();
+
+    governor.endBlock(numSamples);
 }
 
 //==============================================================================
@@ -279,216 +436,434 @@ void FractalSynthesisAudioProcessor::getStateInformation (juce::MemoryBlock& des
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
+    auto state = apvts.copyState();
+
+    for (auto* part : parts)
+        part->writeState(state);
+
+    std::unique_ptr<juce::XmlElement> xml(state.createXml());
+    copyXmlToBinary(*xml, destData);
 }
 
 void FractalSynthesisAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
+    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
+
+    if (xml == nullptr || !xml->hasTagName(apvts.state.getType()))
+        return;
+
+    auto state = juce::ValueTree::fromXml(*xml);
+
+    //Sessions saved before the multi-timbral mode only have the seed of the first part
+    for (auto* part : parts)
+        part->readState(state);
+
+    apvts.replaceState(state);
 }
 
-void FractalSynthesisAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+void FractalSynthesisAudioProcessor::setSeedPoint(int partIndex, DoubleDouble x, DoubleDouble y)
 {
-    //Here we update the values of the synths based on the selected fractal function
-
+    parts[partIndex]->setSeedPoint(x, y);
+}
 
+void FractalSynthesisAudioProcessor::getSeedPoint(int partIndex, DoubleDouble& x, DoubleDouble& y) const
+{
+    parts[partIndex]->getSeedPoint(x, y);
+}
 
-    if (parameterID.compare("FRACTAL_FUNCTION")==0)
-    {
-        int fractalOption = newValue;
+juce::Result FractalSynthesisAudioProcessor::setOrbitMapping(int partIndex, const juce::String& text)
+{
+    return parts[partIndex]->setOrbitMapping(text);
+}
 
-        switch (fractalOption)
-        {
-        case 0:
-            currentFractal = mandelbrot;
-            break;
-        case 1:
-            currentFractal = burningShip;
-            break;
-        case 2:
-            currentFractal = tricorn;
-        default:
-            break;
-        }
+juce::String FractalSynthesisAudioProcessor::getOrbitMapping(int partIndex) const
+{
+    return parts[partIndex]->getOrbitMapping();
+}
 
-        updatedFractal = true;
-    }
-    else if (parameterID.compare("INITIAL_POINT_X")==0 || parameterID.compare("INITIAL_POINT_Y")==0)
+void FractalSynthesisAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    //The fractal and wave type params are handled by the parts,
+    //here the voices of the other parts are created when the multi-timbral mode is switched on
+    //(and the missing voices when the polyphony grows)
+    if (parameterID == "MULTITIMBRAL" || parameterID == "POLYPHONY")
     {
-        updatedFractal = true;
+        if (synchronousStructuralChanges.load())
+            applyStructuralChanges();
+        else
+            triggerAsyncUpdate();
     }
+}
 
+void FractalSynthesisAudioProcessor::applyStructuralChanges()
+{
+    createVoices();
 
-    if (parameterID.contains("WAVE_TYPE"))
+    //Parts created after the processor was prepared must be prepared before the audio thread can render them
+    if (preparedSampleRate > 0)
     {
-        int index = parameterID.getLastCharacter() - '0';
-        int newChoice = newValue;
-
-        for (int i = 0; i < synth->getNumVoices(); ++i)
+        for (auto* part : parts)
         {
-            if (auto voice = dynamic_cast<SynthVoice*>(synth->getVoice(i)))
-            {
-
-                voice->setWaveType(index, newChoice);
-            }
+            if (part->hasVoices() && !part->isReady())
+                part->prepareToPlay(preparedSampleRate, preparedBlockSize, preparedNumChannels, preparedNumOutputChannels);
         }
     }
 
+    updateMidiChannels();
 }
 
-juce::AudioProcessorValueTreeState::ParameterLayout FractalSynthesisAudioProcessor::createParams()
+void FractalSynthesisAudioProcessor::updateMidiChannels()
 {
-    std::vector<std::unique_ptr<juce::RangedAudioParameter>> params;
+    auto multi = isMultiTimbral();
 
-    params.push_back(std::make_unique<juce::AudioParameterChoice>("FRACTAL_FUNCTION", "Fractal Function",
-        juce::StringArray("Mandelbrot Set", "Burning Ship Set", "Tricorn"), 0));
+    for (int i = 0; i < parts.size(); ++i)
+        parts[i]->setMidiChannel(multi ? i + 1 : 0);
+}
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("INITIAL_POINT_X", "Initial Point X", -1, 1, 0.5));
+void FractalSynthesisAudioProcessor::timerCallback()
+{
+    auto level = governor.getLevel();
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("INITIAL_POINT_Y", "Initial Point Y", -1, 1, 0.5));
+    if ((int)cpuLevelParameter->convertFrom0to1(cpuLevelParameter->getValue()) != level)
+        cpuLevelParameter->setValueNotifyingHost(cpuLevelParameter->convertTo0to1((float)level));
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("ATTACK0", "Attack",
-        juce::NormalisableRange<float> {0.01f, 1.0f, 0.001f}, 0.01f));
+    //The LIMITER param changes the latency
+    if (preparedSampleRate > 0)
+        updateLatency();
+}
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("DECAY0", "Decay",
-        juce::NormalisableRange<float> {0.1f, 1.0f, 0.001f}, 0.1f));
-    
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("SUSTAIN0", "Sustain",
-        juce::NormalisableRange<float> {0.1f, 1.0f, 0.001f}, 1.0f));
-    
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("RELEASE0", "Release",
-        juce::NormalisableRange<float> {0.1f, 3.0f, 0.001f}, 0.4f));
+void FractalSynthesisAudioProcessor::updateLatency()
+{
+    auto latency = masterEffects.getLatencySamples();
 
-    params.push_back(std::make_unique<juce::AudioParameterChoice>("WAVE_TYPE0", "Wave type",
-        juce::StringArray("Sine", "Saw", "Square"), 0));
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
+}
 
+double FractalSynthesisAudioProcessor::getHostBpm()
+{
+    if (auto* playHead = getPlayHead())
+    {
+        if (auto position = playHead->getPosition())
+        {
+            if (auto bpm = position->getBpm())
+                return *bpm;
+        }
+    }
 
+    return 0;
+}
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("ATTACK1", "Attack",
-        juce::NormalisableRange<float> {0.01f, 1.0f, 0.001f}, 0.01f));
+bool FractalSynthesisAudioProcessor::startEventRecording(const juce::File& file)
+{
+    EventRecordingHeader header{};
+    std::memcpy(header.magic, "FER1", 4);
+    header.version = EventRecordingHeader::currentVersion;
+    header.sampleRate = getSampleRate();
+    header.blockSize = getBlockSize();
+    header.numChannels = getMainBusNumOutputChannels();
+    header.numParameters = getParameters().size();
+
+    //The replay starts from the state of this moment
+    juce::MemoryBlock state;
+    getStateInformation(state);
+    header.stateSize = (juce::int64)state.getSize();
+
+    if (header.sampleRate <= 0 || header.blockSize <= 0)
+        return false;
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("DECAY1", "Decay",
-        juce::NormalisableRange<float> {0.1f, 1.0f, 0.001f}, 0.1f));
+    file.getParentDirectory().createDirectory();
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("SUSTAIN1", "Sustain",
-        juce::NormalisableRange<float> {0.1f, 1.0f, 0.001f}, 1.0f));
+    return recorder.start(file, header, state);
+}
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("RELEASE1", "Release",
-        juce::NormalisableRange<float> {0.1f, 3.0f, 0.001f}, 0.4f));
+juce::File FractalSynthesisAudioProcessor::getDefaultRecordingsDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("DelayLama").getChildFile("Fractasizer").getChildFile("Recordings");
+}
 
-    params.push_back(std::make_unique<juce::AudioParameterChoice>("WAVE_TYPE1", "Wave type",
-        juce::StringArray("Sine", "Saw", "Square"), 0));
+void FractalSynthesisAudioProcessor::preparePartialBusDelays(double sampleRate, int samplesPerBlock, int numChannels)
+{
+    juce::dsp::ProcessSpec spec;
+    spec.sampleRate = sampleRate;
+    spec.maximumBlockSize = (juce::uint32)samplesPerBlock;
+    spec.numChannels = (juce::uint32)numChannels;
 
+    for (auto& delay : partialBusDelays)
+    {
+        delay.setMaximumDelayInSamples(masterEffects.getMaxLatencySamples());
+        delay.prepare(spec);
+    }
 
+    partialBusLatency = 0;
+}
 
+void FractalSynthesisAudioProcessor::updatePartialBuses()
+{
+    auto numChannels = getMainBusNumOutputChannels();
 
+    for (int j = 0; j < processor_consts::NUM_PARTIALS; j++)
+    {
+        auto* bus = getBus(false, j + 1);
+        auto enabled = bus != nullptr && bus->isEnabled() && bus->getNumberOfChannels() == numChannels;
 
+        partialBusOffsets[(size_t)j] = enabled ? getChannelIndexInProcessBlockBuffer(false, j + 1, 0) : -1;
+    }
+}
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("ATTACK2", "Attack",
-        juce::NormalisableRange<float> {0.01f, 1.0f, 0.001f}, 0.01f));
+void FractalSynthesisAudioProcessor::referToOutputBuses(juce::AudioBuffer<float>& buffer, int numSamples, PartOutputs& busViews) const
+{
+    auto** channels = buffer.getArrayOfWritePointers();
+    auto numChannels = juce::jmin(preparedNumChannels, buffer.getNumChannels());
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("DECAY2", "Decay",
-        juce::NormalisableRange<float> {0.1f, 1.0f, 0.001f}, 0.1f));
+    busViews.main.setDataToReferTo(channels, numChannels, numSamples);
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("SUSTAIN2", "Sustain",
-        juce::NormalisableRange<float> {0.1f, 1.0f, 0.001f}, 1.0f));
+    for (size_t j = 0; j < busViews.partials.size(); j++)
+    {
+        auto offset = partialBusOffsets[j];
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("RELEASE2", "Release",
-        juce::NormalisableRange<float> {0.1f, 3.0f, 0.001f}, 0.4f));
+        //A bus without channels makes the voices keep the partial in the main output
+        if (offset >= 0 && offset + numChannels <= buffer.getNumChannels())
+            busViews.partials[j].setDataToReferTo(channels + offset, numChannels, numSamples);
+        else
+            busViews.partials[j].setDataToReferTo(channels, 0, numSamples);
+    }
+}
 
-    params.push_back(std::make_unique<juce::AudioParameterChoice>("WAVE_TYPE2", "Wave type",
-        juce::StringArray("Sine", "Saw", "Square"), 0));
+void FractalSynthesisAudioProcessor::renderPartJob(void* context, int jobIndex)
+{
+    auto& processor = *static_cast<FractalSynthesisAudioProcessor*>(context);
+    auto* part = processor.activeParts[(size_t)jobIndex];
 
+    auto& partBuffer = part->getPartBuffer();
+    partBuffer.clear(0, processor.currentNumSamples);
 
+    auto& partOutputs = processor.partOutputs[(size_t)jobIndex];
+    processor.referToOutputBuses(partBuffer, processor.currentNumSamples, partOutputs);
 
+    part->render(partOutputs, *processor.currentMidi, processor.currentNumSamples);
+}
 
+juce::AudioProcessorValueTreeState::ParameterLayout FractalSynthesisAudioProcessor::createParams()
+{
+    std::vector<std::unique_ptr<juce::RangedAudioParameter>> params;
 
+    //The first params are those of the single-part version, with the same IDs and in the same order (hosts can automate
+    //by index): SynthPart::addParameters starts with them and the first part has no ID prefix
+    SynthPart::addParameters(0, params);
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("ATTACK3", "Attack",
-        juce::NormalisableRange<float> {0.01f, 1.0f, 0.001f}, 0.01f));
+    constexpr size_t numOriginalParams = 3 + 5 * processor_consts::NUM_PARTIALS;
+    jassert(params.size() > numOriginalParams && params[numOriginalParams - 1]->paramID == "WAVE_TYPE" + juce::String(processor_consts::NUM_PARTIALS - 1));
+    juce::ignoreUnused(numOriginalParams);
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("DECAY3", "Decay",
-        juce::NormalisableRange<float> {0.1f, 1.0f, 0.001f}, 0.1f));
+    params.push_back(std::make_unique<juce::AudioParameterBool>("MULTITIMBRAL", "Multi-timbral", false));
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("SUSTAIN3", "Sustain",
-        juce::NormalisableRange<float> {0.1f, 1.0f, 0.001f}, 1.0f));
+    for (int i = 1; i < processor_consts::NUM_PARTS; i++)
+        SynthPart::addParameters(i, params);
 
-    params.push_back(std::make_unique<juce::AudioParameterFloat>("RELEASE3", "Release",
-        juce::NormalisableRange<float> {0.1f, 3.0f, 0.001f}, 0.4f));
+    params.push_back(std::make_unique<ReadOnlyIntParameter>("CPU_LEVEL", "CPU governor level", 0, CpuGovernor::maxLevel, 0));
 
-    params.push_back(std::make_unique<juce::AudioParameterChoice>("WAVE_TYPE3", "Wave type",
-        juce::StringArray("Sine", "Saw", "Square"), 0));
+    MasterEffects::addParameters(params);
 
+    //Voices advance together in slices of this many samples, so that big host blocks don't overflow the caches
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("MICROBLOCK_SIZE", "Microblock size",
+        juce::StringArray{ "Off", "16", "32", "64", "128" }, 3));
 
+    //Notes per part (voices are created when it grows, so big values cost memory)
+    params.push_back(std::make_unique<juce::AudioParameterInt>("POLYPHONY", "Polyphony", 1, processor_consts::MAX_VOICES, processor_consts::NUM_VOICES));
 
     return { params.begin(), params.end() };
 }
 
-std::complex<double> FractalSynthesisAudioProcessor::mandelbrot(std::complex<double> z, std::complex<double> c)
+void FractalSynthesisAudioProcessor::createVoices()
 {
-    return std::pow(z, 2) + c;
+    //The other parts (and their workers) only cost memory once the multi-timbral mode has been used
+    auto numParts = isMultiTimbral() ? parts.size() : 1;
+    auto numVoices = (int)polyphony->load();
+
+    //Voices are never deleted when the polyphony is lowered, the extra ones just stay free
+    for (int i = 0; i < numParts; i++)
+    {
+        if (parts[i]->getNumVoices() < numVoices)
+            parts[i]->createVoices(numVoices);
+    }
+
+    if (numParts > 1 && renderPool == nullptr)
+    {
+        //The audio thread renders a part too
+        auto numWorkers = juce::jlimit(0, processor_consts::NUM_PARTS - 1, juce::SystemStats::getNumCpus() - 1);
+
+        renderPool = std::make_unique<PartRenderPool>(numWorkers);
+        activeRenderPool.store(renderPool.get(), std::memory_order_release);
+    }
 }
 
-std::complex<double> FractalSynthesisAudioProcessor::burningShip(std::complex<double> z, std::complex<double> c)
+void FractalSynthesisAudioProcessor::setWaveScopesActive(bool shouldBeActive)
 {
-    std::complex<double> z1(std::abs(z.real()), std::abs(z.imag()));
-    return std::pow(z1, 2) + c;
+    //The audio thread doesn't touch the fifos while the scopes are inactive, so they can be reset here
+    if (shouldBeActive && !waveScopesActive.load())
+    {
+        for (auto& scope : waveScopes)
+            scope.fifo.reset();
+    }
+
+    waveScopesActive.store(shouldBeActive);
 }
 
-std::complex<double> FractalSynthesisAudioProcessor::tricorn(std::complex<double> z, std::complex<double> c)
+int FractalSynthesisAudioProcessor::pullWaveScopeSamples(int partialIndex, float* destination, int maxSamples)
 {
-    return pow(conj(z), 2) + c;
+    return waveScopes[(size_t)partialIndex].pull(destination, maxSamples);
 }
 
-
-void FractalSynthesisAudioProcessor::generateFractalSuccession(std::complex<double> c)
+juce::String FractalSynthesisAudioProcessor::runInstantiationBenchmark(int numInstances)
 {
+    //The timers and async updaters of the instances must belong to the message thread
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    constexpr double sampleRate = 48000;
+    constexpr int blockSize = 512;
 
-    std::complex<double> z = 0; //starting z
+    auto getMilliseconds = [](juce::int64 ticks) { return juce::Time::highResolutionTicksToSeconds(ticks) * 1000.0; };
 
-    for (size_t synthNumber = 0; synthNumber < processor_consts::NUM_PARTIALS; synthNumber++)
+    juce::OwnedArray<FractalSynthesisAudioProcessor> instances;
+    juce::int64 constructionTicks = 0, prepareTicks = 0;
+
+    //All alive together like in a session, so the shared resources are only built by the first one
+    for (int i = 0; i < numInstances; ++i)
     {
-        z = currentFractal(z, c);
-        fractalPoints[synthNumber] = z;
+        auto start = juce::Time::getHighResolutionTicks();
+        instances.add(new FractalSynthesisAudioProcessor());
+        auto constructed = juce::Time::getHighResolutionTicks();
+
+        instances.getLast()->setRateAndBufferSizeDetails(sampleRate, blockSize);
+        instances.getLast()->prepareToPlay(sampleRate, blockSize);
+
+        constructionTicks += constructed - start;
+        prepareTicks += juce::Time::getHighResolutionTicks() - constructed;
     }
+
+    auto start = juce::Time::getHighResolutionTicks();
+    instances.clear();
+    auto destructionTicks = juce::Time::getHighResolutionTicks() - start;
+
+    auto perInstance = [numInstances, getMilliseconds](juce::int64 ticks)
+    {
+        return juce::String(getMilliseconds(ticks) / juce::jmax(1, numInstances), 2) + " ms";
+    };
+
+    juce::String report;
+    report << "Instantiation (" << numInstances << " instances, " << (int)sampleRate << " Hz, " << blockSize << " samples), per instance:\n"
+           << "  construction: " << perInstance(constructionTicks) << "\n"
+           << "  prepareToPlay: " << perInstance(prepareTicks) << "\n"
+           << "  destruction: " << perInstance(destructionTicks) << "\n"
+           << "  total: " << juce::String(getMilliseconds(constructionTicks + prepareTicks + destructionTicks), 1) << " ms\n";
+
+    return report;
 }
 
-void FractalSynthesisAudioProcessor::generateLFORates(std::vector<std::complex<double>> fractalSuccession)
+juce::String FractalSynthesisAudioProcessor::runMicroblockBenchmark()
 {
+    //Every run creates a new instance, see runInstantiationBenchmark
+    JUCE_ASSERT_MESSAGE_THREAD
 
-    double total = 0;
+    constexpr double sampleRate = 48000;
+    constexpr int secondsPerRun = 2;
+    constexpr int chord[] = { 48, 55, 60, 64, 67, 71, 74, 79 };
+    constexpr int hostBlockSizes[] = { 256, 512, 1024, 2048, 4096 };
 
-    for (auto& fractalPoint : fractalSuccession)
-            total += std::abs(fractalPoint.imag());
+    constexpr int numChoices = 5; //of the MICROBLOCK_SIZE param
 
-    for (size_t i = 0; i < fractalSuccession.size(); i++)
+    juce::String report;
+    report << "Microblocks (" << (int)(sizeof(chord) / sizeof(chord[0])) << " held notes, offline), ms per second of audio:\n"
+           << "  host block";
+
+    for (int choice = 0; choice < numChoices; ++choice)
+        report << " | " << (choice > 0 ? juce::String(getMicroblockSamples(choice)) : juce::String("Off")).paddedLeft(' ', 5);
+
+    report << "\n";
+
+    for (auto hostBlockSize : hostBlockSizes)
     {
-        lfoRates[i] = std::abs(fractalSuccession[i].imag()) * 10 / total;
-    }
+        report << "  " << juce::String(hostBlockSize).paddedLeft(' ', 10);
+
+        for (int choice = 0; choice < numChoices; ++choice)
+        {
+            //A new instance for each run, so that every run starts from the same voices and cache state
+            FractalSynthesisAudioProcessor processor;
+            processor.setNonRealtime(true); //full quality, like a bounce
+
+            auto* parameter = processor.apvts.getParameter("MICROBLOCK_SIZE");
+            parameter->setValueNotifyingHost(parameter->convertTo0to1((float)choice));
+
+            processor.setRateAndBufferSizeDetails(sampleRate, hostBlockSize);
+            processor.prepareToPlay(sampleRate, hostBlockSize);
+
+            juce::AudioBuffer<float> buffer(processor.getTotalNumOutputChannels(), hostBlockSize);
+            juce::MidiBuffer midi;
+
+            for (auto note : chord)
+                midi.addEvent(juce::MidiMessage::noteOn(1, note, 0.8f), 0);
+
+            //The first block starts the notes and is not timed
+            buffer.clear();
+            processor.processBlock(buffer, midi);
+            midi.clear();
 
+            auto numBlocks = (int)(secondsPerRun * sampleRate) / hostBlockSize;
+            auto start = juce::Time::getHighResolutionTicks();
 
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                buffer.clear();
+                processor.processBlock(buffer, midi);
+            }
+
+            auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            auto renderedSeconds = numBlocks * hostBlockSize / sampleRate;
+
+            report << " | " << juce::String(seconds * 1000.0 / renderedSeconds, 1).paddedLeft(' ', 5);
+        }
+
+        report << "\n";
+    }
+
+    return report;
 }
 
-void FractalSynthesisAudioProcessor::generateFreqDetunes(std::vector<std::complex<double>> fractalSuccession)
+juce::String FractalSynthesisAudioProcessor::getMemoryReport() const
 {
+    size_t partsSize = 0;
+    size_t compositeSize = 0;
+    int numVoices = 0;
 
-    freqDetunes[0] = 1; //Always keep the fundamental unchanged
-    for (size_t i = 1; i < fractalSuccession.size(); i++)
+    for (auto* part : parts)
     {
-        freqDetunes[i] = std::abs(fractalSuccession[i].real());
+        partsSize += part->getSizeInBytes();
+        compositeSize += part->getCompositeWavetable().getSizeInBytes();
+        numVoices += part->getNumVoices();
     }
-}
 
-void FractalSynthesisAudioProcessor::updateADSR(int partialIndex, SynthVoice* voice)
-{
-    auto indexString = std::to_string(partialIndex);
+    auto instanceSize = sizeof(*this) + partsSize + masterEffects.getSizeInBytes() - sizeof(masterEffects);
+
+    juce::String report;
 
-    auto& attack = *apvts.getRawParameterValue("ATTACK" + indexString);
-    auto& decay = *apvts.getRawParameterValue("DECAY" + indexString);
-    auto& sustain = *apvts.getRawParameterValue("SUSTAIN" + indexString);
-    auto& release = *apvts.getRawParameterValue("RELEASE" + indexString);
+    report << "Per instance: " << juce::File::descriptionOfSizeInBytes((juce::int64)instanceSize) << "\n"
+           << "  parts (" << parts.size() << ", " << numVoices << " voices): " << juce::File::descriptionOfSizeInBytes((juce::int64)partsSize) << "\n"
+           << "  wave scope fifos (" << waveScopes.size() << "): " << juce::File::descriptionOfSizeInBytes((juce::int64)sizeof(waveScopes)) << "\n"
+           << "  master effects: " << juce::File::descriptionOfSizeInBytes((juce::int64)masterEffects.getSizeInBytes()) << "\n"
+           << "  CPU governor: level " << governor.getLevel() << ", load " << juce::String(governor.getLoad() * 100.0f, 1) << "%\n"
+           << "  part render workers: " << (renderPool != nullptr ? renderPool->getNumWorkers() : 0) << "\n"
+           << "  composite tables: " << juce::File::descriptionOfSizeInBytes((juce::int64)compositeSize) << "\n"
+           << "  DSP kernels: " << DspKernels::getName(DspKernels::getActiveInstructionSet()) << "\n"
+           << "  event recorder: " << (recorder.isRecording() ? recorder.getFile().getFileName() : juce::String("off")) << "\n"
+           << "Shared by " << sharedResources.getReferenceCount() << " instances: "
+           << juce::File::descriptionOfSizeInBytes((juce::int64)sharedResources->getSharedSizeInBytes()) << "\n"
+           << sharedResources->getReport();
 
-    voice->updateADSR(partialIndex, attack.load(), decay.load(), sustain.load(), release.load());
+    return report;
 }
 
 
@@ -10,20 +10,19 @@
 
 #include <JuceHeader.h>
 #include "SynthVoice.h"
-
-
-namespace processor_consts
-{
-    //number of partials to generate for additive synthesis
-    static constexpr int NUM_PARTIALS = 4;
-    //Define the number of polyphonies (max number of MIDI notes that can be played at the same time)
-    static constexpr int NUM_VOICES = 10;
-}
+#include "SynthPart.h"
+#include "PartRenderPool.h"
+#include "CpuGovernor.h"
+#include "MasterEffects.h"
+#include "EventRecorder.h"
+#include "CompositeWavetable.h"
+#include "SharedResources.h"
+#include "DoubleDouble.h"
 
 //==============================================================================
 /**
 */
-class FractalSynthesisAudioProcessor : public juce::AudioProcessor, juce::AudioProcessorValueTreeState::Listener
+class FractalSynthesisAudioProcessor : public juce::AudioProcessor, juce::AudioProcessorValueTreeState::Listener, private juce::AsyncUpdater, private juce::Timer
 {
 public:
     //==============================================================================
@@ -66,6 +65,52 @@ public:
 
     void parameterChanged(const juce::String& parameterID, float newValue) override;
 
+    SharedResources& getSharedResources() noexcept { return *sharedResources; }
+
+    //Seed point of the fractal succession of a part with more precision than the INITIAL_POINT parameters
+    //(so that a point found with a deep zoom can be recalled exactly).
+    //The precise seed is used as long as the parameters still hold its rounded value.
+    void setSeedPoint(int partIndex, DoubleDouble x, DoubleDouble y);
+    void getSeedPoint(int partIndex, DoubleDouble& x, DoubleDouble& y) const;
+
+    //Mapping from the orbit to the detunes and LFO rates of a part (message thread, see OrbitMapping).
+    //An empty text is the built-in mapping; a text with errors is rejected and the part keeps its mapping
+    juce::Result setOrbitMapping(int partIndex, const juce::String& text);
+    juce::String getOrbitMapping(int partIndex) const;
+
+    //Prefix of the parameter IDs of a part ("" for the first one)
+    static juce::String getPartParameterPrefix(int partIndex) { return SynthPart::getParameterPrefix(partIndex); }
+
+    bool isMultiTimbral() const { return multiTimbral->load() > 0.5f; }
+
+    //Current level of the CPU governor (0 is full quality)
+    int getCpuLevel() const noexcept { return governor.getLevel(); }
+
+    //Human readable report of the memory owned by this instance and of the memory shared by all the instances
+    juce::String getMemoryReport() const;
+
+    //Records everything processBlock receives from now on, to replay it with the EventReplayer (message thread)
+    bool startEventRecording(const juce::File& file);
+    void stopEventRecording() { recorder.stop(); }
+    bool isEventRecording() const noexcept { return recorder.isRecording(); }
+
+    static juce::File getDefaultRecordingsDirectory();
+
+    //Times the construction, the first prepareToPlay and the destruction of new instances, like a host loading
+    //a session (message thread, like the hosts)
+    static juce::String runInstantiationBenchmark(int numInstances);
+
+    //Times a held chord rendered offline with every MICROBLOCK_SIZE choice and host block sizes from 256 to 4096
+    //(message thread, blocks it for a few seconds)
+    static juce::String runMicroblockBenchmark();
+
+    //Used by the EventReplayer: renders every block at the recorded level of the CPU governor
+    void setForcedCpuLevel(int level) noexcept { governor.setForcedLevel(level); }
+
+    //Used by the EventReplayer, that changes the params and calls processBlock on its own thread: the MULTITIMBRAL and
+    //POLYPHONY changes create the voices right away on the thread that makes them, instead of later on the message thread
+    void setSynchronousStructuralChanges(bool shouldBeSynchronous) noexcept { synchronousStructuralChanges.store(shouldBeSynchronous); }
+
 
 
 
@@ -73,48 +118,115 @@ public:
 
     juce::AudioProcessorValueTreeState apvts;
 
-  
-    
-    juce::OwnedArray<juce::AudioVisualiserComponent> waveVisualisers;
+    //Called by the editor: the samples of the partials are only collected while an editor is open
+    void setWaveScopesActive(bool shouldBeActive);
+
+    //Called by the editor to read the samples to show in the wave visualiser of the given partial
+    int pullWaveScopeSamples(int partialIndex, float* destination, int maxSamples);
+
+    //Part shown by the editor (the wave scopes follow it)
+    void setEditedPart(int partIndex) { editedPart.store(juce::jlimit(0, processor_consts::NUM_PARTS - 1, partIndex)); }
  
 private:
 
+    std::array<WaveScopeFifo, processor_consts::NUM_PARTIALS> waveScopes;
 
-    //Synth variables
+    std::atomic<bool> waveScopesActive{ false };
+    std::atomic<int> editedPart{ 0 };
 
+    //Creates the voices of the parts that will play, up to the POLYPHONY param (and the workers of the pool in multi-timbral mode)
+    void createVoices();
 
+    //Creates the voices and prepares the parts created while the processor was already playing
+    void applyStructuralChanges();
+    void handleAsyncUpdate() override { applyStructuralChanges(); }
 
-    std::vector<juce::Synthesiser*> synths;
+    //Routes the channels to the parts: every channel to the first part, or one channel per part
+    void updateMidiChannels();
 
-    juce::Synthesiser* synth;
+    //Renders the given active part (called by the pool)
+    static void renderPartJob(void* context, int jobIndex);
 
-    std::vector<std::complex<double>> fractalPoints = { 0, 0, 0, 0 }; //to store the fractal points
+    //Finds the channels of the enabled partial outputs in the process buffer (after a layout change)
+    void updatePartialBuses();
 
-    std::vector<double> lfoRates = { 3, 3, 3, 3 }; //Hz, default values
-    std::vector<double> freqDetunes = { 1, 2, 3, 4 }; //default values
+    //Points the views to the buses of a buffer laid out like the process buffer (no allocation, no copy)
+    void referToOutputBuses(juce::AudioBuffer<float>& buffer, int numSamples, PartOutputs& busViews) const;
 
-    juce::AudioProcessorValueTreeState::ParameterLayout createParams();
+    //First channel of each partial output in the process buffer, -1 if it is off
+    std::array<int, processor_consts::NUM_PARTIALS> partialBusOffsets{};
+
+    //The partial outputs skip the master effects, but the latency reported to the host moves all the buses:
+    //they are delayed by the latency of the limiter to stay aligned with the main output
+    std::array<juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::None>, processor_consts::NUM_PARTIALS> partialBusDelays;
+    int partialBusLatency = 0;
+
+    //Not realtime safe
+    void preparePartialBusDelays(double sampleRate, int samplesPerBlock, int numChannels);
 
+    //Bus views of the host buffer, and of the part buffers when the parts render in parallel
+    PartOutputs outputs;
+    std::array<PartOutputs, processor_consts::NUM_PARTS> partOutputs;
 
-    //static utility functions for fractal computation
-    static std::complex<double> mandelbrot(std::complex<double> z, std::complex<double> c);
+    //Reports the level of the governor to the host through the read-only CPU_LEVEL param (and the latency)
+    void timerCallback() override;
 
-    static std::complex<double> burningShip(std::complex<double> z, std::complex<double> c);
-    
-    static std::complex<double> tricorn(std::complex<double> z, std::complex<double> c);
+    //Reports the latency of the master effects to the host (when it changes)
+    void updateLatency();
+
+    //Settings of the last prepareToPlay, to skip the work when the host prepares again with the same ones
+    double preparedSampleRate = 0;
+    int preparedBlockSize = 0;
+    int preparedNumChannels = 0; //main output
+    int preparedNumOutputChannels = 0; //all the buses
+
+
+    //Synth variables
 
-    std::complex<double>(*currentFractal)(std::complex<double> z, std::complex<double> c) = mandelbrot; //default fractal
+    //Immutable data shared by all the instances of the plugin in the process
+    juce::SharedResourcePointer<SharedResources> sharedResources;
 
-    void generateFractalSuccession(std::complex<double> c);
+    //Fractal, seed and wave type updates for the audio thread, applied at the start of each block
+    CommandQueue commands;
 
-    void generateLFORates(std::vector<std::complex<double>> fractalSuccession);
+    //One part per MIDI channel, only the first one plays unless the multi-timbral mode is on
+    juce::OwnedArray<SynthPart> parts;
 
-    void generateFreqDetunes(std::vector<std::complex<double>> fractalSuccession);
+    std::atomic<float>* multiTimbral;
+    std::atomic<float>* microblockSize;
+    std::atomic<float>* polyphony;
+    std::atomic<bool> synchronousStructuralChanges{ false };
 
-    void updateADSR(int partialIndex, SynthVoice* voice);
+    //Created with the voices of the other parts, the first time the multi-timbral mode is enabled
+    std::unique_ptr<PartRenderPool> renderPool;
+    std::atomic<PartRenderPool*> activeRenderPool{ nullptr };
+
+    //Parts to render in the current block (filled by the audio thread, read by the pool)
+    std::array<SynthPart*, processor_consts::NUM_PARTS> activeParts{};
+    const juce::MidiBuffer* currentMidi = nullptr;
+    int currentNumSamples = 0;
+
+    //Lowers the quality of the voices when the rendering gets close to the block duration
+    CpuGovernor governor;
+    juce::RangedAudioParameter* cpuLevelParameter;
+
+    //Delay and reverb on the sum of the parts
+    MasterEffects masterEffects{ apvts };
+
+    //Tempo of the host for the synced delay (0 if unknown)
+    double getHostBpm();
+
+    //Optional, off unless started from the editor
+    EventRecorder recorder;
+
+    //Renders the composite tables of the parts in the background (started with the first prepareToPlay)
+    CompositeWavetableRenderer compositeRenderer;
+
+    juce::AudioProcessorValueTreeState::ParameterLayout createParams();
 
+    //Samples of a MICROBLOCK_SIZE choice (0 for "Off")
+    static int getMicroblockSamples(int choice) noexcept { return choice > 0 ? 8 << choice : 0; }
 
-    bool updatedFractal = true; //defaults to true to start up the first computation
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FractalSynthesisAudioProcessor)
@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    SharedResources.cpp
+    Created: 18 Oct 2026 2:40:35pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "SharedResources.h"
+
+SharedResources::SineTable::SineTable()
+    : table([](float x) { return std::sin(x); }, -juce::MathConstants<float>::pi, juce::MathConstants<float>::pi, numPoints)
+{
+}
+
+size_t SharedResources::SineTable::getSizeInBytes() const
+{
+    return sizeof(SineTable) + (numPoints + 1) * sizeof(float);
+}
+
+SharedResources::ImageResource::ImageResource(const void* data, size_t dataSize)
+    : image(juce::ImageFileFormat::loadFrom(data, dataSize))
+{
+}
+
+size_t SharedResources::ImageResource::getSizeInBytes() const
+{
+    //Decoded images are stored as ARGB
+    return sizeof(ImageResource) + (size_t)image.getWidth() * (size_t)image.getHeight() * 4;
+}
+
+SharedResources::SineTable::Ptr SharedResources::getLFOSineTable()
+{
+    return getOrCreate<SineTable>("lfoSineTable", [] { return new SineTable(); });
+}
+
+SharedResources::ImageResource::Ptr SharedResources::getFractalImage(int fractalIndex)
+{
+    switch (fractalIndex)
+    {
+    case 1:
+        return getOrCreate<ImageResource>("burningShipImage",
+            [] { return new ImageResource(BinaryData::BurningShip2_png, BinaryData::BurningShip2_pngSize); });
+    case 2:
+        return getOrCreate<ImageResource>("tricornImage",
+            [] { return new ImageResource(BinaryData::Tricorn2_png, BinaryData::Tricorn2_pngSize); });
+    default:
+        return getOrCreate<ImageResource>("mandelbrotImage",
+            [] { return new ImageResource(BinaryData::Mandelbrot2_png, BinaryData::Mandelbrot2_pngSize); });
+    }
+}
+
+void SharedResources::startLoadingWavetables()
+{
+    //Only once per process, and only when an instance actually gets ready to play
+    if (!wavetablesRequested.exchange(true))
+        wavetableLibrary.rescan();
+}
+
+void SharedResources::releaseUnusedResources()
+{
+    const juce::ScopedLock sl(lock);
+
+    for (auto it = resources.begin(); it != resources.end();)
+    {
+        //The cache itself holds one reference
+        if (it->second->getReferenceCount() <= 1)
+            it = resources.erase(it);
+        else
+            ++it;
+    }
+}
+
+size_t SharedResources::getSharedSizeInBytes() const
+{
+    const juce::ScopedLock sl(lock);
+
+    size_t total = wavetableLibrary.getMappedSize() + timbreMap.getMappedSize();
+
+    for (auto& resource : resources)
+        total += resource.second->getSizeInBytes();
+
+    return total;
+}
+
+juce::String SharedResources::getReport() const
+{
+    const juce::ScopedLock sl(lock);
+
+    juce::String report;
+
+    for (auto& resource : resources)
+        report << "  " << resource.first << ": " << juce::File::descriptionOfSizeInBytes((juce::int64)resource.second->getSizeInBytes())
+               << " (" << resource.second->getReferenceCount() - 1 << " users)\n";
+
+    report << "  wavetables (" << wavetableLibrary.getNumTables() << ", memory mapped): "
+           << juce::File::descriptionOfSizeInBytes((juce::int64)wavetableLibrary.getMappedSize()) << "\n";
+
+    report << "  timbre map (memory mapped): " << juce::File::descriptionOfSizeInBytes((juce::int64)timbreMap.getMappedSize()) << "\n";
+
+    return report;
+}
@@ -0,0 +1,116 @@
+/*
+  ==============================================================================
+
+    SharedResources.h
+    Created: 18 Oct 2026 2:40:18pm
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "WavetableLibrary.h"
+#include "TimbreMap.h"
+
+//Process-wide cache of the immutable data used by the plugin (lookup tables, images, wavetables...).
+//Use it through a juce::SharedResourcePointer<SharedResources>, so that every plugin instance loaded
+//in the same host process shares a single copy of the data.
+class SharedResources
+{
+public:
+
+    //Base class for any immutable data stored in the cache
+    class Resource : public juce::ReferenceCountedObject
+    {
+    public:
+        using Ptr = juce::ReferenceCountedObjectPtr<Resource>;
+
+        //Used by the memory report
+        virtual size_t getSizeInBytes() const = 0;
+    };
+
+    //Sine lookup table shared by all the LFOs (input range -pi..pi)
+    class SineTable : public Resource
+    {
+    public:
+        using Ptr = juce::ReferenceCountedObjectPtr<SineTable>;
+
+        static constexpr size_t numPoints = 128;
+
+        SineTable();
+
+        size_t getSizeInBytes() const override;
+
+        juce::dsp::LookupTableTransform<float> table;
+    };
+
+    //A decoded image (e.g. the fractal backgrounds of the editor)
+    class ImageResource : public Resource
+    {
+    public:
+        using Ptr = juce::ReferenceCountedObjectPtr<ImageResource>;
+
+        ImageResource(const void* data, size_t dataSize);
+
+        size_t getSizeInBytes() const override;
+
+        juce::Image image;
+    };
+
+    SharedResources() = default;
+
+    //Returns the resource stored with the given key, creating it on the first request.
+    //Must not be called from the audio thread (it locks and may allocate).
+    template <typename ResourceType>
+    juce::ReferenceCountedObjectPtr<ResourceType> getOrCreate(const juce::String& key, const std::function<ResourceType* ()>& create)
+    {
+        const juce::ScopedLock sl(lock);
+
+        auto& resource = resources[key];
+
+        if (resource == nullptr)
+            resource = create();
+
+        auto* typedResource = dynamic_cast<ResourceType*>(resource.get());
+        jassert(typedResource != nullptr); //the same key was used for another resource type
+
+        return typedResource;
+    }
+
+    SineTable::Ptr getLFOSineTable();
+
+    //Index as the FRACTAL_FUNCTION parameter (0 Mandelbrot, 1 Burning Ship, 2 Tricorn)
+    ImageResource::Ptr getFractalImage(int fractalIndex);
+
+    WavetableLibrary& getWavetableLibrary() noexcept { return wavetableLibrary; }
+
+    //Starts the background scan of the wavetables the first time it is called
+    void startLoadingWavetables();
+
+    //Index of the timbres over the seed plane (built on request, then memory mapped)
+    TimbreMap& getTimbreMap() noexcept { return timbreMap; }
+
+    //Drops the cached resources that are not used by anybody anymore
+    void releaseUnusedResources();
+
+    //Bytes of data currently held by the cache (including the mapped wavetables)
+    size_t getSharedSizeInBytes() const;
+
+    //One line per cached resource
+    juce::String getReport() const;
+
+private:
+
+    juce::CriticalSection lock;
+
+    std::map<juce::String, Resource::Ptr> resources;
+
+    WavetableLibrary wavetableLibrary;
+
+    std::atomic<bool> wavetablesRequested{ false };
+
+    TimbreMap timbreMap{ *this };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SharedResources)
+};
@@ -0,0 +1,808 @@
+/*
+  ==============================================================================
+
+    SynthPart.cpp
+    Created: 19 Oct 2026 9:21:52am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "SynthPart.h"
+
+SynthPart::SynthPart(int partIndex, juce::AudioProcessorValueTreeState& apvts, SharedResources& sharedResources, CommandQueue& commands)
+    : partIndex(partIndex), prefix(getParameterPrefix(partIndex)), apvts(apvts), sharedResources(sharedResources), commands(commands)
+{
+    sound = new SynthSound();
+    synth.addSound(sound);
+
+    initialPointX = apvts.getRawParameterValue(getParameterID("INITIAL_POINT_X"));
+    initialPointY = apvts.getRawParameterValue(getParameterID("INITIAL_POINT_Y"));
+    sineTier = apvts.getRawParameterValue(getParameterID("SINE_TIER"));
+    orbitPartialCount = apvts.getRawParameterValue(getParameterID("ORBIT_PARTIALS"));
+    orbitCrossover = apvts.getRawParameterValue(getParameterID("ORBIT_CROSSOVER"));
+    orbitLevel = apvts.getRawParameterValue(getParameterID("ORBIT_LEVEL"));
+    compositeCache = apvts.getRawParameterValue(getParameterID("COMPOSITE_CACHE"));
+    pitchBendRange = apvts.getRawParameterValue(getParameterID("PITCH_BEND_RANGE"));
+    glideTime = apvts.getRawParameterValue(getParameterID("GLIDE_TIME"));
+    modWheelDepth = apvts.getRawParameterValue(getParameterID("MOD_WHEEL_DEPTH"));
+    globalLFOMode = apvts.getRawParameterValue(getParameterID("GLOBAL_LFO"));
+
+    lfoTable = sharedResources.getLFOSineTable();
+
+    for (size_t j = 0; j < processor_consts::NUM_PARTIALS; j++)
+    {
+        auto indexString = juce::String(j);
+
+        attacks[j] = apvts.getRawParameterValue(getParameterID("ATTACK" + indexString));
+        decays[j] = apvts.getRawParameterValue(getParameterID("DECAY" + indexString));
+        sustains[j] = apvts.getRawParameterValue(getParameterID("SUSTAIN" + indexString));
+        releases[j] = apvts.getRawParameterValue(getParameterID("RELEASE" + indexString));
+        waveTypes[j] = apvts.getRawParameterValue(getParameterID("WAVE_TYPE" + indexString));
+        wavetableIndexes[j] = apvts.getRawParameterValue(getParameterID("WAVETABLE" + indexString));
+        wavetablePositions[j] = apvts.getRawParameterValue(getParameterID("WAVETABLE_POSITION" + indexString));
+    }
+
+    //Add this as listener to the fractal params
+    //(usually this is not needed when working with apvts and attachments,
+    //but for performance reasons we don't want to recompute
+    //the fractal succession all the time)
+    apvts.addParameterListener(getParameterID("FRACTAL_FUNCTION"), this);
+    apvts.addParameterListener(getParameterID("INITIAL_POINT_X"), this);
+    apvts.addParameterListener(getParameterID("INITIAL_POINT_Y"), this);
+
+    //The wave type is also updated in the callback: it is heavier and we don't care too much about response time
+    for (int j = 0; j < processor_consts::NUM_PARTIALS; j++)
+        apvts.addParameterListener(getParameterID("WAVE_TYPE" + juce::String(j)), this);
+
+    //The callbacks are only received for changes, so pick up the current fractal and seed (no audio thread yet)
+    currentFractal = getFractalFunction((int)apvts.getRawParameterValue(getParameterID("FRACTAL_FUNCTION"))->load());
+    audioSeedX = (double)initialPointX->load();
+    audioSeedY = (double)initialPointY->load();
+
+    pendingWaveTypes.fill(-1);
+
+    //The free voices are not updated in every block, so a voice gets the current settings when it starts a note
+    synth.onVoiceStarting = [this](juce::SynthesiserVoice& voice)
+    {
+        if (auto* synthVoice = dynamic_cast<SynthVoice*>(&voice))
+            configureVoice(*synthVoice);
+    };
+
+    synth.getVoiceLevel = [](juce::SynthesiserVoice& voice)
+    {
+        auto* synthVoice = dynamic_cast<SynthVoice*>(&voice);
+        return synthVoice != nullptr ? synthVoice->getLevel() : 0.0f;
+    };
+}
+
+SynthPart::~SynthPart()
+{
+    apvts.removeParameterListener(getParameterID("FRACTAL_FUNCTION"), this);
+    apvts.removeParameterListener(getParameterID("INITIAL_POINT_X"), this);
+    apvts.removeParameterListener(getParameterID("INITIAL_POINT_Y"), this);
+
+    for (int j = 0; j < processor_consts::NUM_PARTIALS; j++)
+        apvts.removeParameterListener(getParameterID("WAVE_TYPE" + juce::String(j)), this);
+}
+
+juce::String SynthPart::getParameterPrefix(int partIndex)
+{
+    if (partIndex == 0)
+        return {};
+
+    return "P" + juce::String(partIndex + 1) + "_";
+}
+
+void SynthPart::addParameters(int partIndex, std::vector<std::unique_ptr<juce::RangedAudioParameter>>& params)
+{
+    auto idPrefix = getParameterPrefix(partIndex);
+    auto namePrefix = partIndex == 0 ? juce::String() : "Part " + juce::String(partIndex + 1) + " ";
+
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(idPrefix + "FRACTAL_FUNCTION", namePrefix + "Fractal Function",
+        juce::StringArray("Mandelbrot Set", "Burning Ship Set", "Tricorn"), 0));
+
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(idPrefix + "INITIAL_POINT_X", namePrefix + "Initial Point X", -1, 1, 0.5));
+
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(idPrefix + "INITIAL_POINT_Y", namePrefix + "Initial Point Y", -1, 1, 0.5));
+
+    for (int j = 0; j < processor_consts::NUM_PARTIALS; j++)
+    {
+        auto indexString = juce::String(j);
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(idPrefix + "ATTACK" + indexString, namePrefix + "Attack",
+            juce::NormalisableRange<float> {0.01f, 1.0f, 0.001f}, 0.01f));
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(idPrefix + "DECAY" + indexString, namePrefix + "Decay",
+            juce::NormalisableRange<float> {0.1f, 1.0f, 0.001f}, 0.1f));
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(idPrefix + "SUSTAIN" + indexString, namePrefix + "Sustain",
+            juce::NormalisableRange<float> {0.1f, 1.0f, 0.001f}, 1.0f));
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(idPrefix + "RELEASE" + indexString, namePrefix + "Release",
+            juce::NormalisableRange<float> {0.1f, 3.0f, 0.001f}, 0.4f));
+
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(idPrefix + "WAVE_TYPE" + indexString, namePrefix + "Wave type",
+            juce::StringArray("Sine", "Saw", "Square"), 0));
+    }
+
+    //Everything below comes after the params of the original version, so that hosts that automate by index still find them
+
+    //0: off (the partial plays its wave type), n: table n - 1 of the library
+    for (int j = 0; j < processor_consts::NUM_PARTIALS; j++)
+    {
+        auto indexString = juce::String(j);
+
+        params.push_back(std::make_unique<juce::AudioParameterInt>(idPrefix + "WAVETABLE" + indexString, namePrefix + "Wavetable",
+            0, WavetableLibrary::maxTables, 0, juce::String(),
+            [](int value, int) { return value == 0 ? juce::String("Off") : juce::String(value); }));
+
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(idPrefix + "WAVETABLE_POSITION" + indexString, namePrefix + "Wavetable position",
+            0.0f, 1.0f, 0.0f));
+    }
+
+    //Accuracy of the sine partials (the polynomial is already below what a float can resolve)
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(idPrefix + "SINE_TIER", namePrefix + "Sine accuracy",
+        juce::StringArray("Exact", "Polynomial", "Table", "Recursive"), 1));
+
+    //Extra sine partials further along the orbit, none by default
+    params.push_back(std::make_unique<juce::AudioParameterInt>(idPrefix + "ORBIT_PARTIALS", namePrefix + "Orbit partials",
+        0, OrbitPartials::maxPartials, 0));
+
+    //Above this many audible orbit partials a voice renders them with the inverse FFT instead of the oscillator bank
+    params.push_back(std::make_unique<juce::AudioParameterInt>(idPrefix + "ORBIT_CROSSOVER", namePrefix + "Orbit crossover",
+        0, OrbitPartials::maxPartials, 32));
+
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(idPrefix + "ORBIT_LEVEL", namePrefix + "Orbit level",
+        0.0f, 1.0f, 0.5f));
+
+    //Notes of harmonic patches play a pre-rendered mix of the partials, off by default
+    params.push_back(std::make_unique<juce::AudioParameterBool>(idPrefix + "COMPOSITE_CACHE", namePrefix + "Composite cache", false));
+
+    //Semitones up and down
+    params.push_back(std::make_unique<juce::AudioParameterInt>(idPrefix + "PITCH_BEND_RANGE", namePrefix + "Pitch bend range", 0, 24, 2));
+
+    //Seconds to glide from the previous note of the part, 0: off
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(idPrefix + "GLIDE_TIME", namePrefix + "Glide time",
+        juce::NormalisableRange<float> {0.0f, 2.0f, 0.001f, 0.5f}, 0.0f));
+
+    //Tremolo depth added by the mod wheel
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(idPrefix + "MOD_WHEEL_DEPTH", namePrefix + "Mod wheel depth",
+        0.0f, 1.0f, 0.5f));
+
+    //One set of tremolo LFOs for the whole part (all the notes in phase) instead of free-running LFOs in every voice
+    params.push_back(std::make_unique<juce::AudioParameterBool>(idPrefix + "GLOBAL_LFO", namePrefix + "Global LFO", false));
+
+    ModulationMatrix::addParameters(idPrefix, namePrefix, params);
+}
+
+void SynthPart::createVoices(int numVoices)
+{
+    //add voices to the synth up to numVoices (allows numVoices MIDI notes to be played at the same time)
+    auto lfoTable = sharedResources.getLFOSineTable();
+
+    numVoices = juce::jmin(numVoices, processor_consts::MAX_VOICES);
+
+    if (synth.getNumVoices() >= numVoices)
+        return;
+
+    for (int i = synth.getNumVoices(); i < numVoices; i++)
+    {
+        auto voice = new SynthVoice(processor_consts::NUM_PARTIALS, lfoTable);
+
+        //The wave type callbacks may have been received before the voices existed
+        for (int j = 0; j < processor_consts::NUM_PARTIALS; j++)
+        {
+            voice->setWaveType(j, (int)waveTypes[(size_t)j]->load());
+        }
+
+        //Voices added while the part is playing must be ready before the audio thread can pick them
+        if (preparedSampleRate > 0)
+            voice->prepareToPlay(preparedSampleRate, preparedBlockSize, preparedNumChannels);
+
+        synth.addVoice(voice);
+    }
+
+    synth.updateVoiceLists();
+}
+
+void SynthPart::prepareToPlay(double sampleRate, int samplesPerBlock, int numChannels, int numOutputChannels)
+{
+    //Prepare all the voices inside the synth (in place, nothing is re-created)
+    for (int i = 0; i < synth.getNumVoices(); i++)
+    {
+        if (auto voice = dynamic_cast<SynthVoice*>(synth.getVoice(i)))
+        {
+            voice->prepareToPlay(sampleRate, samplesPerBlock, numChannels);
+        }
+    }
+    synth.setCurrentPlaybackSampleRate(sampleRate);
+
+    partBuffer.setSize(numOutputChannels, samplesPerBlock, false, true, true);
+
+    //The most updates a block can have (the CPU governor only makes them less frequent)
+    auto maxTicks = samplesPerBlock / CpuGovernor::getQuality(0).lfoUpdateInterval + 1;
+    globalLFOValues.resize((size_t)(maxTicks * processor_consts::NUM_PARTIALS));
+    samplesToGlobalTick = 1;
+
+    preparedSampleRate = sampleRate;
+    preparedBlockSize = samplesPerBlock;
+    preparedNumChannels = numChannels;
+
+    ready.store(true, std::memory_order_release);
+}
+
+void SynthPart::allNotesOff()
+{
+    synth.allNotesOff(0, false);
+}
+
+void SynthPart::setMidiChannel(int midiChannel)
+{
+    if (sound->getMidiChannel() == midiChannel)
+        return;
+
+    sound->setMidiChannel(midiChannel);
+
+    //Notes started on other channels would never receive their note off
+    synth.allNotesOff(0, false);
+}
+
+bool SynthPart::isActive(const juce::MidiBuffer& midiMessages) const
+{
+    if (synth.getNumActiveVoices() > 0)
+        return true;
+
+    for (const auto metadata : midiMessages)
+    {
+        auto message = metadata.getMessage();
+
+        //Controllers and pitch wheel count too, the voices must not miss them
+        if (message.getChannel() > 0 && sound->appliesToChannel(message.getChannel()))
+            return true;
+    }
+
+    return false;
+}
+
+void SynthPart::render(PartOutputs& outputs, const juce::MidiBuffer& midiMessages, int numSamples)
+{
+    partialOutputs = outputs.hasPartialOutputs() ? outputs.partials.data() : nullptr;
+
+    auto orbitCount = (int)orbitPartialCount->load();
+    auto level = orbitLevel->load();
+
+    if (updatedFractal || orbitCount != lastOrbitPartialCount || level != lastOrbitLevel)
+    {
+        //Get the starting point for the fractal (both coordinates come from the same command, so a gesture on the
+        //input plane never mixes the new x with the old y)
+        std::complex<double> c((double)audioSeedX, (double)audioSeedY); //starting point
+
+        generateFractalSuccession(currentFractal, c, fractalPoints);
+
+        generateLFORates(fractalPoints, lfoRates);
+
+        generateFreqDetunes(fractalPoints, freqDetunes);
+
+        //The user mapping replaces the settings it assigns
+        if (!audioMapping.isEmpty())
+            OrbitMapping::run(audioMapping, fractalPoints.data(), c, freqDetunes.data(), lfoRates.data());
+
+        generateOrbitPartials(c, orbitCount, level);
+
+        ModulationMatrix::computeOrbitSources(fractalPoints, orbitSources.data());
+
+        updatedFractal = false;
+        lastOrbitPartialCount = orbitCount;
+        lastOrbitLevel = level;
+    }
+
+    //Look up the selected wavetables once per block (lock free, tables are never freed while the library lives)
+    for (size_t j = 0; j < processor_consts::NUM_PARTIALS; j++)
+    {
+        auto table = (int)wavetableIndexes[j]->load();
+        currentWavetables[j] = table > 0 ? sharedResources.getWavetableLibrary().getTable(table - 1) : nullptr;
+        currentFramePositions[j] = wavetablePositions[j]->load();
+    }
+
+    modulationMatrix.update();
+
+    updateCompositeTable();
+
+    //Only the playing voices, the others are configured when they start a note
+    synth.forEachActiveVoice([this](juce::SynthesiserVoice& voice)
+    {
+        if (auto* synthVoice = dynamic_cast<SynthVoice*>(&voice))
+            configureVoice(*synthVoice);
+    });
+
+    //A block bigger than announced is rendered in chunks of the prepared size, so that the global LFO updates
+    //and the buffers of the voices never grow on the audio thread
+    auto chunkSize = juce::jmax(1, preparedBlockSize);
+
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        auto length = juce::jmin(chunkSize, numSamples - start);
+
+        if (globalLFOMode->load() >= 0.5f)
+            updateGlobalLFO(start, length);
+
+        synth.renderNextBlock(outputs.main, midiMessages, start, length);
+    }
+}
+
+void SynthPart::pushWaveScopes(std::array<WaveScopeFifo, processor_consts::NUM_PARTIALS>& waveScopes)
+{
+    synth.forEachActiveVoice([&waveScopes](juce::SynthesiserVoice& voice)
+    {
+        if (auto* synthVoice = dynamic_cast<SynthVoice*>(&voice))
+        {
+            for (size_t j = 0; j < processor_consts::NUM_PARTIALS; j++)
+                waveScopes[j].push(synthVoice->synthBuffers[j]->getReadPointer(0), synthVoice->synthBuffers[j]->getNumSamples());
+        }
+    });
+}
+
+void SynthPart::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    //Called on whatever thread the host uses: the changes go to the audio thread as commands
+    auto name = parameterID.substring(prefix.length());
+
+    SynthCommand command;
+    command.part = partIndex;
+
+    if (name == "FRACTAL_FUNCTION")
+    {
+        command.type = SynthCommand::fractalFunction;
+        command.intValue = (int)newValue;
+    }
+    else if (name == "INITIAL_POINT_X" || name == "INITIAL_POINT_Y")
+    {
+        command.type = SynthCommand::seedParameter;
+        command.index = name.getLastCharacter() == 'X' ? 0 : 1;
+        command.x = (double)newValue;
+
+        //The input plane sets the precise seed before the parameters: their change is only its rounded copy.
+        //This can be the audio thread (host automation), so the seed is only checked if the lock is free
+        const juce::SpinLock::ScopedTryLockType seedTryLock(seedLock);
+
+        if (seedTryLock.isLocked() && pickSeedCoordinate(newValue, command.index == 0 ? preciseSeedX : preciseSeedY) != (double)newValue)
+            return;
+    }
+    else if (name.startsWith("WAVE_TYPE"))
+    {
+        command.type = SynthCommand::waveType;
+        command.index = name.getLastCharacter() - '0';
+        command.intValue = (int)newValue;
+    }
+    else
+    {
+        return;
+    }
+
+    sendCommand(command);
+}
+
+void SynthPart::sendCommand(const SynthCommand& command)
+{
+    if (!commands.push(command))
+        resyncRequested.store(true, std::memory_order_release);
+}
+
+void SynthPart::handleCommand(const SynthCommand& command)
+{
+    switch (command.type)
+    {
+    case SynthCommand::fractalFunction:
+        currentFractal = getFractalFunction(command.intValue);
+        updatedFractal = true;
+        break;
+    case SynthCommand::seedPoint:
+        audioSeedX = command.x;
+        audioSeedY = command.y;
+        updatedFractal = true;
+        break;
+    case SynthCommand::seedParameter:
+    {
+        //Only a change that moves the seed away from the precise one (automation, host controls) is applied
+        auto& coordinate = command.index == 0 ? audioSeedX : audioSeedY;
+        auto value = pickSeedCoordinate((float)(double)command.x, coordinate);
+
+        if (value != coordinate)
+        {
+            coordinate = value;
+            updatedFractal = true;
+        }
+        break;
+    }
+    case SynthCommand::waveType:
+        if (command.index >= 0 && command.index < processor_consts::NUM_PARTIALS)
+            pendingWaveTypes[(size_t)command.index] = command.intValue;
+        break;
+    }
+}
+
+void SynthPart::applyPendingCommands()
+{
+    //Some commands were lost because the queue was full: read the whole state again
+    if (resyncRequested.exchange(false, std::memory_order_acquire))
+    {
+        currentFractal = getFractalFunction((int)apvts.getRawParameterValue(getParameterID("FRACTAL_FUNCTION"))->load());
+
+        for (size_t j = 0; j < processor_consts::NUM_PARTIALS; j++)
+            pendingWaveTypes[j] = (int)waveTypes[j]->load();
+
+        const juce::SpinLock::ScopedTryLockType seedTryLock(seedLock);
+
+        if (seedTryLock.isLocked())
+        {
+            audioSeedX = pickSeedCoordinate(initialPointX->load(), preciseSeedX);
+            audioSeedY = pickSeedCoordinate(initialPointY->load(), preciseSeedY);
+        }
+        else
+        {
+            resyncRequested.store(true, std::memory_order_relaxed); //try again in the next block
+        }
+
+        updatedFractal = true;
+    }
+
+    //A new orbit mapping was compiled (if its lock is busy, it is taken in a later block)
+    if (mappingChanged.load(std::memory_order_acquire))
+    {
+        const juce::SpinLock::ScopedTryLockType mappingTryLock(mappingLock);
+
+        if (mappingTryLock.isLocked())
+        {
+            audioMapping = pendingMapping;
+            mappingChanged.store(false, std::memory_order_relaxed);
+            updatedFractal = true;
+        }
+    }
+
+    //The voices are being prepared on another thread, keep the wave types for later
+    if (!isReady())
+        return;
+
+    for (int j = 0; j < processor_consts::NUM_PARTIALS; j++)
+    {
+        auto choice = pendingWaveTypes[(size_t)j];
+
+        if (choice < 0)
+            continue;
+
+        for (int i = 0; i < synth.getNumVoices(); ++i)
+        {
+            if (auto voice = dynamic_cast<SynthVoice*>(synth.getVoice(i)))
+            {
+                voice->setWaveType(j, choice);
+            }
+        }
+
+        pendingWaveTypes[(size_t)j] = -1;
+    }
+}
+
+SynthPart::FractalFunction SynthPart::getFractalFunction(int fractalIndex)
+{
+    switch (fractalIndex)
+    {
+    case 1:
+        return burningShip;
+    case 2:
+        return tricorn;
+    default:
+        return mandelbrot;
+    }
+}
+
+void SynthPart::setSeedPoint(DoubleDouble x, DoubleDouble y)
+{
+    {
+        const juce::SpinLock::ScopedLockType sl(seedLock);
+        preciseSeedX = x;
+        preciseSeedY = y;
+    }
+
+    SynthCommand command;
+    command.type = SynthCommand::seedPoint;
+    command.part = partIndex;
+    command.x = x;
+    command.y = y;
+
+    sendCommand(command);
+}
+
+void SynthPart::getSeedPoint(DoubleDouble& x, DoubleDouble& y) const
+{
+    auto parameterX = initialPointX->load();
+    auto parameterY = initialPointY->load();
+
+    const juce::SpinLock::ScopedLockType sl(seedLock);
+    x = pickSeedCoordinate(parameterX, preciseSeedX);
+    y = pickSeedCoordinate(parameterY, preciseSeedY);
+}
+
+DoubleDouble SynthPart::pickSeedCoordinate(float parameterValue, const DoubleDouble& preciseValue)
+{
+    //Tolerance for the rounding of the value through the float (normalised) parameter
+    if (std::abs((double)preciseValue - parameterValue) < 1e-5)
+        return preciseValue;
+
+    return parameterValue;
+}
+
+void SynthPart::writeState(juce::ValueTree& state) const
+{
+    {
+        const juce::SpinLock::ScopedLockType sl(seedLock);
+        state.setProperty(getParameterID("SEED_X"), preciseSeedX.toString(), nullptr);
+        state.setProperty(getParameterID("SEED_Y"), preciseSeedY.toString(), nullptr);
+    }
+
+    auto text = getOrbitMapping();
+
+    if (text.isNotEmpty())
+        state.setProperty(getParameterID("ORBIT_MAPPING"), text, nullptr);
+}
+
+void SynthPart::readState(const juce::ValueTree& state)
+{
+    auto seedX = getParameterID("SEED_X");
+    auto seedY = getParameterID("SEED_Y");
+
+    if (state.hasProperty(seedX) && state.hasProperty(seedY))
+        setSeedPoint(DoubleDouble::fromString(state[seedX].toString()), DoubleDouble::fromString(state[seedY].toString()));
+
+    //Sessions without a mapping use the built-in one
+    setOrbitMapping(state[getParameterID("ORBIT_MAPPING")].toString());
+}
+
+juce::Result SynthPart::setOrbitMapping(const juce::String& text)
+{
+    //Compiled on the calling thread, the audio thread only copies the program
+    OrbitMapping::Program program;
+    auto result = OrbitMapping::compile(text, program);
+
+    if (result.failed())
+        return result;
+
+    {
+        const juce::SpinLock::ScopedLockType sl(mappingLock);
+        mappingText = text;
+        pendingMapping = program;
+    }
+
+    mappingChanged.store(true, std::memory_order_release);
+    return result;
+}
+
+juce::String SynthPart::getOrbitMapping() const
+{
+    const juce::SpinLock::ScopedLockType sl(mappingLock);
+    return mappingText;
+}
+
+size_t SynthPart::getSizeInBytes() const
+{
+    size_t size = sizeof(*this) + partBuffer.getNumChannels() * partBuffer.getNumSamples() * sizeof(float)
+        + globalLFOValues.size() * sizeof(float);
+
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+    {
+        if (auto voice = dynamic_cast<SynthVoice*>(synth.getVoice(i)))
+            size += voice->getSizeInBytes();
+    }
+
+    return size;
+}
+
+std::complex<double> SynthPart::mandelbrot(std::complex<double> z, std::complex<double> c)
+{
+    return std::pow(z, 2) + c;
+}
+
+std::complex<double> SynthPart::burningShip(std::complex<double> z, std::complex<double> c)
+{
+    std::complex<double> z1(std::abs(z.real()), std::abs(z.imag()));
+    return std::pow(z1, 2) + c;
+}
+
+std::complex<double> SynthPart::tricorn(std::complex<double> z, std::complex<double> c)
+{
+    return pow(conj(z), 2) + c;
+}
+
+void SynthPart::generateFractalSuccession(FractalFunction fractal, std::complex<double> c, std::vector<std::complex<double>>& fractalSuccession)
+{
+    std::complex<double> z = 0; //starting z
+
+    for (size_t synthNumber = 0; synthNumber < processor_consts::NUM_PARTIALS; synthNumber++)
+    {
+        z = fractal(z, c);
+        fractalSuccession[synthNumber] = z;
+    }
+}
+
+void SynthPart::generateLFORates(const std::vector<std::complex<double>>& fractalSuccession, std::vector<double>& lfoRates)
+{
+    double total = 0;
+
+    for (auto& fractalPoint : fractalSuccession)
+            total += std::abs(fractalPoint.imag());
+
+    for (size_t i = 0; i < fractalSuccession.size(); i++)
+    {
+        lfoRates[i] = std::abs(fractalSuccession[i].imag()) * 10 / total;
+    }
+}
+
+void SynthPart::generateFreqDetunes(const std::vector<std::complex<double>>& fractalSuccession, std::vector<double>& freqDetunes)
+{
+    freqDetunes[0] = 1; //Always keep the fundamental unchanged
+    for (size_t i = 1; i < fractalSuccession.size(); i++)
+    {
+        freqDetunes[i] = std::abs(fractalSuccession[i].real());
+    }
+}
+
+void SynthPart::generateOrbitPartials(std::complex<double> c, int count, float level)
+{
+    std::complex<double> z = fractalPoints.back();
+    numOrbitPartials = 0;
+
+    for (int k = 0; k < juce::jmin(count, OrbitPartials::maxPartials); ++k)
+    {
+        z = currentFractal(z, c);
+
+        //An escaping orbit only gives partials far above the note from here on (and overflows soon after)
+        if (std::norm(z) > 4096.0)
+            break;
+
+        orbitDetunes[(size_t)k] = std::abs(z.real());
+        orbitGains[(size_t)k] = 1.0f / (processor_consts::NUM_PARTIALS + k + 1); //decreasing with the order like the main partials
+        ++numOrbitPartials;
+    }
+
+    float total = 0;
+    for (int k = 0; k < numOrbitPartials; ++k)
+        total += orbitGains[(size_t)k];
+
+    for (int k = 0; k < numOrbitPartials; ++k)
+        orbitGains[(size_t)k] *= 0.5f * level / total;
+}
+
+void SynthPart::updateGlobalLFO(int startSample, int numSamples)
+{
+    auto interval = quality.lfoUpdateInterval;
+
+    //The interval can have been lowered by the CPU governor
+    samplesToGlobalTick = juce::jlimit(1, interval, samplesToGlobalTick);
+
+    auto numTicks = samplesToGlobalTick <= numSamples ? (numSamples - samplesToGlobalTick) / interval + 1 : 0;
+    auto size = (size_t)(numTicks * processor_consts::NUM_PARTIALS);
+
+    //Sized in prepareToPlay for the most updates of a chunk
+    jassert(globalLFOValues.size() >= size);
+
+    auto* values = globalLFOValues.data();
+
+    for (int j = 0; j < processor_consts::NUM_PARTIALS; j++)
+    {
+        auto increment = juce::MathConstants<double>::twoPi * lfoRates[(size_t)j] * interval / preparedSampleRate;
+        auto& phase = globalLFOPhases[(size_t)j];
+
+        //Same steps as the LFOs of the voices: the value of the update, then the phase moves on
+        for (int t = 0; t < numTicks; t++)
+        {
+            values[t * processor_consts::NUM_PARTIALS + j] = lfoTable->table.processSampleUnchecked((float)phase);
+
+            phase += increment;
+            if (phase >= juce::MathConstants<double>::pi)
+                phase -= juce::MathConstants<double>::twoPi;
+        }
+    }
+
+    globalLFO.firstTick = startSample + samplesToGlobalTick;
+    globalLFO.interval = interval;
+    globalLFO.numTicks = numTicks;
+    globalLFO.values = values;
+
+    samplesToGlobalTick += numTicks * interval - numSamples;
+}
+
+void SynthPart::configureVoice(SynthVoice& voice)
+{
+    for (size_t j = 0; j < processor_consts::NUM_PARTIALS; j++)
+    {
+        updateADSR(j, &voice);
+        voice.setWavetable(j, currentWavetables[j], currentFramePositions[j]);
+    }
+
+    voice.setFreqDetunes(freqDetunes);
+    voice.setLFORates(lfoRates);
+    voice.setSineTier((int)sineTier->load());
+    voice.setOrbitPartials(orbitDetunes.data(), orbitGains.data(), numOrbitPartials);
+    voice.setOrbitCrossover((int)orbitCrossover->load());
+    voice.setQuality(quality);
+    voice.setModulation(&modulationMatrix.getRoutes(), orbitSources.data());
+    voice.setCompositeTable(currentCompositeTable, compositeSettings);
+    voice.setPartialOutputs(partialOutputs);
+    voice.setGlobalLFO(globalLFOMode->load() >= 0.5f ? &globalLFO : nullptr);
+    voice.setExpression((int)pitchBendRange->load(), (double)glideTime->load(), modWheelDepth->load(), &lastNoteFrequency);
+}
+
+void SynthPart::updateCompositeTable()
+{
+    currentCompositeTable = nullptr;
+    compositeSettings = {};
+
+    //The partials of a table can't go to their own outputs
+    if (compositeCache->load() < 0.5f || partialOutputs != nullptr)
+        return;
+
+    //The table has a single envelope and can't move the partials apart (the tremolo and its modulation are applied after)
+    for (size_t j = 1; j < processor_consts::NUM_PARTIALS; j++)
+    {
+        if (attacks[j]->load() != attacks[0]->load() || decays[j]->load() != decays[0]->load()
+            || sustains[j]->load() != sustains[0]->load() || releases[j]->load() != releases[0]->load())
+            return;
+    }
+
+    constexpr int partialRoutes = (1 << ModulationMatrix::pitch) | (1 << ModulationMatrix::gain) | (1 << ModulationMatrix::pan);
+
+    if ((modulationMatrix.getRoutes().usedTypes & partialRoutes) != 0)
+        return;
+
+    std::array<int, CompositeWavetable::numPartials> currentWaveTypes;
+
+    for (size_t j = 0; j < processor_consts::NUM_PARTIALS; j++)
+    {
+        //The table only has the basic wave types
+        if (wavetableIndexes[j]->load() >= 0.5f)
+            return;
+
+        currentWaveTypes[j] = (int)waveTypes[j]->load();
+    }
+
+    //Detunes that are not close to harmonics of a common base are rendered additively
+    compositeSettings = CompositeWavetable::findSettings(freqDetunes, currentWaveTypes);
+
+    if (!compositeSettings.isValid())
+        return;
+
+    //Rendered in the background, the notes are additive until it is ready
+    compositeWavetable.request(compositeSettings);
+    currentCompositeTable = compositeWavetable.getTable(compositeSettings);
+}
+
+void SynthPart::updateADSR(int partialIndex, SynthVoice* voice)
+{
+    voice->updateADSR(partialIndex, attacks[(size_t)partialIndex]->load(), decays[(size_t)partialIndex]->load(),
+        sustains[(size_t)partialIndex]->load(), releases[(size_t)partialIndex]->load());
+}
+
+void WaveScopeFifo::push(const float* data, int numSamples)
+{
+    //Drop what doesn't fit, the scope doesn't need every sample
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    std::copy_n(data, size1, samples.begin() + start1);
+    std::copy_n(data + size1, size2, samples.begin() + start2);
+
+    fifo.finishedWrite(size1 + size2);
+}
+
+int WaveScopeFifo::pull(float* destination, int maxSamples)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(maxSamples, start1, size1, start2, size2);
+
+    std::copy_n(samples.begin() + start1, size1, destination);
+    std::copy_n(samples.begin() + start2, size2, destination + size1);
+
+    fifo.finishedRead(size1 + size2);
+
+    return size1 + size2;
+}
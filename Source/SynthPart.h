@@ -0,0 +1,303 @@
+/*
+  ==============================================================================
+
+    SynthPart.h
+    Created: 19 Oct 2026 9:21:37am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "SynthVoice.h"
+#include "SynthSound.h"
+#include "SharedResources.h"
+#include "DoubleDouble.h"
+#include "MpscQueue.h"
+#include "FractalSynthesiser.h"
+#include "OrbitMapping.h"
+
+
+namespace processor_consts
+{
+    //number of partials to generate for additive synthesis
+    static constexpr int NUM_PARTIALS = 4;
+    //Define the number of polyphonies (max number of MIDI notes that can be played at the same time),
+    //the default of the POLYPHONY param and its maximum
+    static constexpr int NUM_VOICES = 10;
+    static constexpr int MAX_VOICES = FractalSynthesiser::maxVoices;
+    //One part for each MIDI channel in multi-timbral mode
+    static constexpr int NUM_PARTS = 16;
+}
+
+static_assert(processor_consts::NUM_PARTIALS == ModulationMatrix::numPartials && processor_consts::NUM_PARTIALS == CompositeWavetable::numPartials,
+    "The modulation matrix and the composite tables have one slot per partial");
+
+//Single producer (audio thread), single consumer (editor) queue of the samples shown by a wave visualiser
+struct WaveScopeFifo
+{
+    static constexpr int capacity = 4096;
+
+    juce::AbstractFifo fifo{ capacity };
+    std::array<float, capacity> samples{};
+
+    void push(const float* data, int numSamples);
+    int pull(float* destination, int maxSamples);
+};
+
+//Where a part renders a block: views of the output buses, either of the host buffer or of a part buffer with the
+//same layout (nothing is copied). A partial whose bus is off (no channels) stays in the main output
+struct PartOutputs
+{
+    juce::AudioBuffer<float> main;
+    std::array<juce::AudioBuffer<float>, processor_consts::NUM_PARTIALS> partials;
+
+    bool hasPartialOutputs() const noexcept
+    {
+        return std::any_of(partials.begin(), partials.end(), [](const juce::AudioBuffer<float>& bus) { return bus.getNumChannels() > 0; });
+    }
+};
+
+//Update sent to the audio thread (parameter callbacks and GUI can run on any thread)
+struct SynthCommand
+{
+    enum Type
+    {
+        fractalFunction, //intValue: index as the FRACTAL_FUNCTION parameter
+        seedPoint, //x, y: precise seed from the GUI or the state
+        seedParameter, //an INITIAL_POINT parameter moved away from the precise seed (index: 0 x, 1 y, x: value)
+        waveType //index: partial, intValue: choice as the WAVE_TYPE parameter
+    };
+
+    Type type = fractalFunction;
+    int part = 0;
+    int index = 0;
+    int intValue = 0;
+    DoubleDouble x;
+    DoubleDouble y;
+};
+
+using CommandQueue = MpscQueue<SynthCommand, 1024>;
+
+//One timbre of the synth: its own synthesiser and voices, fractal function, seed point and partial settings.
+//Part 0 uses the original parameter IDs (so old sessions still load), part n uses them with the "P<n+1>_" prefix.
+class SynthPart : private juce::AudioProcessorValueTreeState::Listener
+{
+public:
+
+    SynthPart(int partIndex, juce::AudioProcessorValueTreeState& apvts, SharedResources& sharedResources, CommandQueue& commands);
+    ~SynthPart() override;
+
+    static juce::String getParameterPrefix(int partIndex);
+
+    //Adds the parameters of a part to the layout
+    static void addParameters(int partIndex, std::vector<std::unique_ptr<juce::RangedAudioParameter>>& params);
+
+    juce::String getParameterID(const juce::String& name) const { return prefix + name; }
+
+    //Adds voices up to the given number (not realtime safe, allocates; the new voices are prepared if the part is)
+    void createVoices(int numVoices);
+    bool hasVoices() const noexcept { return synth.getNumVoices() > 0; }
+
+    //The audio thread only renders the parts that have been prepared. numChannels is the main output of the voices,
+    //numOutputChannels all the output buses (the size of the part buffer)
+    void prepareToPlay(double sampleRate, int samplesPerBlock, int numChannels, int numOutputChannels);
+    bool isReady() const noexcept { return ready.load(std::memory_order_acquire); }
+
+    void allNotesOff();
+
+    //Audio thread: commands are only recorded here, the state is updated once in applyPendingCommands
+    //(so that a burst of automation costs a single recompute)
+    void handleCommand(const SynthCommand& command);
+    void applyPendingCommands();
+
+    //0 answers to every channel, 1..16 to that channel only
+    void setMidiChannel(int midiChannel);
+
+    //True if some voice is still sounding or the block has messages on the channel of the part
+    bool isActive(const juce::MidiBuffer& midiMessages) const;
+
+    //Updates the voices and adds the rendered block to the outputs (each partial to its own bus if it has one, the rest
+    //to the main bus). Can be called from a worker thread.
+    void render(PartOutputs& outputs, const juce::MidiBuffer& midiMessages, int numSamples);
+
+    //Quality chosen by the CPU governor for the next blocks (audio thread only)
+    void setQuality(const CpuGovernor::Quality& newQuality) noexcept { quality = newQuality; }
+
+    //Samples rendered by all the voices before moving on (0: each voice renders the whole block), audio thread only
+    void setMicroblockSize(int size) noexcept { synth.setMicroblockSize(size); }
+
+    //Notes that can sound at the same time, audio thread only (voices are only created by createVoices)
+    void setPolyphony(int numVoices) noexcept { synth.setPolyphony(numVoices); }
+
+    //Rendered by the CompositeWavetableRenderer of the processor
+    CompositeWavetable& getCompositeWavetable() noexcept { return compositeWavetable; }
+
+    //Scratch buffer used when several parts are rendered in parallel (same channels as the output buses of the processor)
+    juce::AudioBuffer<float>& getPartBuffer() noexcept { return partBuffer; }
+
+    //Pushes the partials of the last block to the wave scopes (audio thread only)
+    void pushWaveScopes(std::array<WaveScopeFifo, processor_consts::NUM_PARTIALS>& waveScopes);
+
+    //Any thread except the audio one
+    void setSeedPoint(DoubleDouble x, DoubleDouble y);
+    void getSeedPoint(DoubleDouble& x, DoubleDouble& y) const;
+
+    //Any thread except the audio one: compiles the orbit mapping (see OrbitMapping) and gives it to the audio thread.
+    //If the text doesn't compile, the part keeps its current mapping
+    juce::Result setOrbitMapping(const juce::String& text);
+    juce::String getOrbitMapping() const;
+
+    //Saves / restores the precise seed point and the orbit mapping in the plugin state
+    void writeState(juce::ValueTree& state) const;
+    void readState(const juce::ValueTree& state);
+
+    size_t getSizeInBytes() const;
+
+    int getNumVoices() const noexcept { return synth.getNumVoices(); }
+
+    using FractalFunction = std::complex<double>(*)(std::complex<double> z, std::complex<double> c);
+
+    static FractalFunction getFractalFunction(int fractalIndex);
+
+    //Mapping from the seed point to the synth settings, also used offline by the timbre map.
+    //The vectors must already have NUM_PARTIALS elements.
+    static void generateFractalSuccession(FractalFunction fractal, std::complex<double> c, std::vector<std::complex<double>>& fractalSuccession);
+
+    static void generateLFORates(const std::vector<std::complex<double>>& fractalSuccession, std::vector<double>& lfoRates);
+
+    static void generateFreqDetunes(const std::vector<std::complex<double>>& fractalSuccession, std::vector<double>& freqDetunes);
+
+private:
+
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+
+    int partIndex;
+    juce::String prefix;
+
+    juce::AudioProcessorValueTreeState& apvts;
+    SharedResources& sharedResources;
+    CommandQueue& commands;
+
+    //Routes of the MOD_* params of the part, read by the voices at control rate
+    ModulationMatrix modulationMatrix{ apvts, prefix };
+    std::array<float, ModulationMatrix::numOrbitSources> orbitSources{};
+
+    //Sends a command, or asks the audio thread to read everything again if the queue is full
+    void sendCommand(const SynthCommand& command);
+    std::atomic<bool> resyncRequested{ false };
+
+    FractalSynthesiser synth;
+    SynthSound* sound;
+
+    std::atomic<bool> ready{ false };
+
+    CpuGovernor::Quality quality;
+
+    juce::AudioBuffer<float> partBuffer;
+
+    //Raw parameter values, looked up once instead of by name in every block
+    std::atomic<float>* initialPointX;
+    std::atomic<float>* initialPointY;
+    std::atomic<float>* sineTier;
+    std::atomic<float>* orbitPartialCount;
+    std::atomic<float>* orbitCrossover;
+    std::atomic<float>* orbitLevel;
+    std::atomic<float>* compositeCache;
+    std::atomic<float>* pitchBendRange;
+    std::atomic<float>* glideTime;
+    std::atomic<float>* modWheelDepth;
+    std::atomic<float>* globalLFOMode;
+    std::array<std::atomic<float>*, processor_consts::NUM_PARTIALS> attacks, decays, sustains, releases, waveTypes, wavetableIndexes, wavetablePositions;
+
+    std::vector<std::complex<double>> fractalPoints = { 0, 0, 0, 0 }; //to store the fractal points
+
+    std::vector<double> lfoRates = { 3, 3, 3, 3 }; //Hz, default values
+    std::vector<double> freqDetunes = { 1, 2, 3, 4 }; //default values
+
+    //static utility functions for fractal computation
+    static std::complex<double> mandelbrot(std::complex<double> z, std::complex<double> c);
+
+    static std::complex<double> burningShip(std::complex<double> z, std::complex<double> c);
+
+    static std::complex<double> tricorn(std::complex<double> z, std::complex<double> c);
+
+    //Audio thread state (only changed by the commands)
+    FractalFunction currentFractal = mandelbrot; //default fractal
+
+    //Continues the succession after the main partials (the gains are normalised so that the layer peaks at level / 2)
+    void generateOrbitPartials(std::complex<double> c, int count, float level);
+
+    void updateADSR(int partialIndex, SynthVoice* voice);
+
+    //Picks the composite table of this block (none if the COMPOSITE_CACHE param is off or the patch can't use one)
+    void updateCompositeTable();
+
+    CompositeWavetable compositeWavetable;
+    CompositeWavetable::Settings compositeSettings;
+    const Wavetable* currentCompositeTable = nullptr;
+
+    //Partial buses of the block being rendered (nullptr: everything goes to the main output)
+    juce::AudioBuffer<float>* partialOutputs = nullptr;
+
+    //Frequency of the last note started by a voice of the part, the next one glides from it (0: no note yet)
+    double lastNoteFrequency = 0;
+
+    //Global LFO mode: the tremolo LFOs of the part, read by all its voices (phases in -pi..pi)
+    SharedResources::SineTable::Ptr lfoTable;
+    std::array<double, processor_consts::NUM_PARTIALS> globalLFOPhases{};
+    std::vector<float> globalLFOValues;
+    SynthVoice::GlobalLFO globalLFO;
+    int samplesToGlobalTick = 1; //position of the next update in the next block
+
+    //Computes the updates of the LFOs in this chunk of the block, at the interval of the voices
+    void updateGlobalLFO(int startSample, int numSamples);
+
+    //Gives the settings of this block to a voice (only the playing voices and the ones starting a note get them)
+    void configureVoice(SynthVoice& voice);
+
+    //Wavetables selected in this block
+    std::array<const Wavetable*, processor_consts::NUM_PARTIALS> currentWavetables{};
+    std::array<float, processor_consts::NUM_PARTIALS> currentFramePositions{};
+
+    //Settings of the last prepareToPlay, for the voices created later
+    double preparedSampleRate = 0;
+    int preparedBlockSize = 0;
+    int preparedNumChannels = 0;
+
+
+    bool updatedFractal = true; //defaults to true to start up the first computation
+
+    std::array<double, OrbitPartials::maxPartials> orbitDetunes{};
+    std::array<float, OrbitPartials::maxPartials> orbitGains{};
+    int numOrbitPartials = 0;
+
+    //Settings of the last orbit computation
+    int lastOrbitPartialCount = 0;
+    float lastOrbitLevel = -1;
+
+    std::array<int, processor_consts::NUM_PARTIALS> pendingWaveTypes; //-1: unchanged
+
+    //Seed of the audio thread, both coordinates always come from the same update
+    DoubleDouble audioSeedX{ 0.5 };
+    DoubleDouble audioSeedY{ 0.5 };
+
+    //Copy of the precise seed for the GUI and the state
+    mutable juce::SpinLock seedLock;
+    DoubleDouble preciseSeedX{ 0.5 };
+    DoubleDouble preciseSeedY{ 0.5 };
+
+    //Returns the precise coordinate if the parameter wasn't moved away from it
+    static DoubleDouble pickSeedCoordinate(float parameterValue, const DoubleDouble& preciseValue);
+
+    //Text of the orbit mapping and its last program, the audio thread takes a copy of the program when it changes
+    mutable juce::SpinLock mappingLock;
+    juce::String mappingText;
+    OrbitMapping::Program pendingMapping;
+    std::atomic<bool> mappingChanged{ false };
+
+    OrbitMapping::Program audioMapping; //audio thread
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SynthPart)
+};
@@ -15,5 +15,12 @@ class SynthSound : public juce::SynthesiserSound
 {
 public:
     bool appliesToNote(int midiNoteNumber) override { return true;  }
-    bool appliesToChannel(int midiChannel) override { return true;  }
+    bool appliesToChannel(int midiChannel) override { return channel == 0 || channel == midiChannel; }
+
+    //0 answers to every channel (single timbre), 1..16 to that channel only (multi-timbral parts)
+    void setMidiChannel(int newChannel) { channel = newChannel; }
+    int getMidiChannel() const { return channel; }
+
+private:
+    std::atomic<int> channel{ 0 };
 };
\ No newline at end of file
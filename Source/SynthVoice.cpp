@@ -10,16 +10,21 @@
 
 #include "SynthVoice.h"
 #include "PluginProcessor.h"
+#include "DspKernels.h"
 
 
-SynthVoice::SynthVoice(int numPartials)
+SynthVoice::SynthVoice(int numPartials, SharedResources::SineTable::Ptr lfoTable) : lfoTable(lfoTable)
 {
 
     this->numPartials = numPartials;
+    numRenderedPartials = numPartials;
+
+    //The modulation destinations have a fixed number of partials
+    jassert(numPartials <= ModulationMatrix::numPartials);
 
     for (size_t i = 0; i < numPartials; i++)
     {
-        processorChains.push_back(juce::dsp::ProcessorChain<juce::dsp::Oscillator<float>, juce::dsp::Gain<float>, juce::dsp::Panner<float>>{});
+        processorChains.push_back(juce::dsp::ProcessorChain<PartialOscillator, juce::dsp::Panner<float>>{});
 
         adsrParams.push_back(juce::ADSR::Parameters());
         adsr.push_back(juce::ADSR());
@@ -28,23 +33,23 @@ SynthVoice::SynthVoice(int numPartials)
     }
     for (size_t i = 0; i < numPartials; i++)
     {
-        lfos.push_back(juce::dsp::Oscillator<float>{ [](float x) { return std::sin(x); }, 128 });
+        lfoPhases.push_back(0.0);
+        lfoIncrements.push_back(0.0);
     }
 
     for (int i = 0; i < numPartials; ++i)
     {
 
-        processorChains[i].get<oscIndex>().initialise([](float x) { return std::sin(x); });
-        processorChains[i].get<gainIndex>().setGainLinear(0.5f/(i+1)); //weighted amplitude of the partial (decreasing with the "order")
-        fixedGains.push_back(0.5f / (i + 1)); //weighted amplitude of the partial
-
-        lfos[i].setFrequency(3); //just a default value
+        processorChains[i].get<oscIndex>().setSineTier(patchSineTier);
+        tremoloGains.push_back(CompositeWavetable::getPartialGain(i)); //weighted amplitude of the partial (decreasing with the "order")
+        fixedGains.push_back(CompositeWavetable::getPartialGain(i)); //weighted amplitude of the partial
     }
 
     for (int i = 0; i < numPartials; ++i)
     {
 
         detuneFactors.push_back(i + 1);
+        targetDetunes.push_back(i + 1);
     }
 
     for (size_t i = 0; i < numPartials; i++)
@@ -57,6 +62,11 @@ SynthVoice::SynthVoice(int numPartials)
         lfoDepths.push_back(0.5f);
     }
 
+    for (size_t i = 0; i < numPartials; i++)
+    {
+        partialFrequencies.push_back(0.0);
+    }
+
 }
 
 bool SynthVoice::canPlaySound(juce::SynthesiserSound* sound)
@@ -68,15 +78,73 @@ void SynthVoice::startNote(int midiNoteNumber, float velocity, juce::Synthesiser
 {
 
     auto freq = juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber);
+    noteFrequency = freq;
+
+    //The note starts on the current bend, and glides from the previous note of the part
+    pitchWheelPosition = currentPitchWheelPosition;
+    targetBendOctaves = bendOctaves = getBendOctaves();
+    glideOctaves = 0;
+
+    if (lastNoteFrequency != nullptr)
+    {
+        if (glideTime > 0 && *lastNoteFrequency > 0)
+            glideOctaves = std::log2(*lastNoteFrequency / freq);
+
+        *lastNoteFrequency = freq;
+    }
+
+    frequencyMultiplier = std::exp2(bendOctaves + glideOctaves);
 
 
     for (int i = 0; i < numPartials; ++i)
     {
-        processorChains[i].get<oscIndex>().setFrequency(freq * detuneFactors[i]);
+        detuneFactors[i] = targetDetunes[i];
+        partialFrequencies[i] = freq * detuneFactors[i];
+        processorChains[i].get<oscIndex>().setFrequency(partialFrequencies[i]);
+        processorChains[i].get<oscIndex>().reset();
+        processorChains[i].get<panIndex>().setPan(voicePan);
 
         adsr[i].noteOn();
     }
 
+    //The whole mix from one table, at the base frequency of its harmonics
+    compositeTable = numPartials == CompositeWavetable::numPartials ? offeredCompositeTable : nullptr;
+    compositeSettings = offeredCompositeSettings;
+
+    processorChains[0].get<oscIndex>().setCompositeTable(compositeTable);
+
+    if (compositeTable != nullptr)
+        processorChains[0].get<oscIndex>().setFrequency(freq / compositeSettings.denominator);
+
+    //The modulation starts from the unmodulated settings set above
+    appliedPitch.fill(0.0f);
+    appliedPan.fill(0.0f);
+
+    if (std::any_of(appliedRate.begin(), appliedRate.end(), [](float rate) { return rate != 0.0f; }))
+    {
+        appliedRate.fill(0.0f);
+        updateLFOIncrements();
+    }
+
+    modulationSources[ModulationMatrix::velocity] = velocity;
+    modulationEnvelope.noteOn();
+    updateModulation();
+
+    orbitPartials.startNote(freq, orbitCrossover);
+    orbitAdsr.noteOn();
+
+    stealFadeRemaining = 0;
+
+    //A new note starts all its partials from the envelope, nothing to fade in
+    lastRenderedPartials = numRenderedPartials;
+    fadeInRemaining = 0;
+
+    //Counted at full level until its envelopes stop rising
+    lastEnvelopes.fill(0.0f);
+    level = 0.0f;
+
+    for (int i = 0; i < numPartials; ++i)
+        level += fixedGains[i] * voiceGain;
 
 }
 
@@ -88,6 +156,9 @@ void SynthVoice::stopNote(float velocity, bool allowTailOff)
         adsr[i].noteOff();
     }
 
+    orbitAdsr.noteOff();
+    modulationEnvelope.noteOff();
+
 
     bool active = false;
     for (int i = 0; i < numPartials; ++i)
@@ -101,10 +172,20 @@ void SynthVoice::stopNote(float velocity, bool allowTailOff)
 
 void SynthVoice::pitchWheelMoved(int newPitchWheelValue)
 {
+    //Reached smoothly, sample by sample
+    pitchWheelPosition = newPitchWheelValue;
+    targetBendOctaves = getBendOctaves();
 }
 
 void SynthVoice::controllerMoved(int controllerNumber, int newControllerValue)
 {
+    if (controllerNumber == 1)
+        modulationSources[ModulationMatrix::modWheel] = (float)newControllerValue / 127.0f;
+}
+
+void SynthVoice::channelPressureChanged(int newChannelPressureValue)
+{
+    modulationSources[ModulationMatrix::channelPressure] = (float)newChannelPressureValue / 127.0f;
 }
 
 void SynthVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
@@ -116,37 +197,96 @@ void SynthVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int sta
     if (!isVoiceActive())
         return;
 
+    //A block bigger than announced in prepareToPlay is rendered in chunks of the prepared size, and the scratch
+    //buffers start again from their first sample when a chunk doesn't fit after the previous one, so that they
+    //never grow on the audio thread (the wave scopes then only get the last chunk)
+    for (int offset = 0; offset < numSamples && isVoiceActive();)
+    {
+        auto length = juce::jmin(preparedBlockSize, numSamples - offset);
+        auto outputStart = startSample + offset;
 
+        if (outputStart + length <= preparedBlockSize)
+            scratchOffset = 0;
+        else if (outputStart < scratchOffset || outputStart - scratchOffset + length > preparedBlockSize)
+            scratchOffset = outputStart;
 
+        renderSegment(outputBuffer, outputStart, outputStart - scratchOffset, length);
 
-    //AudioBlock it's just an alias for the given buffer needed by DSP classes (so by modifying
-    //the AudioBlock we are actually modifying the given buffer)
-    juce::OwnedArray< juce::dsp::AudioBlock<float>> audioBlocks;
+        offset += length;
+    }
+}
+
+void SynthVoice::renderSegment(juce::AudioBuffer<float>& outputBuffer, int outputStart, int startSample, int numSamples)
+{
+    //The partials are rendered at the same position as in the output buffer: the synthesiser can call this once per
+    //microblock, and the wave scopes still get the whole block. A block always starts from its first sample.
+    //startSample is the position in the scratch buffers, outputStart the one in the output (the same unless
+    //the block is bigger than announced)
+    auto end = startSample + numSamples;
+    auto outputOffset = outputStart - startSample;
 
     for (size_t i = 0; i < numPartials; i++)
     {
-        //Set the size for the local temp buffer (only re-allocate if needed)
-        synthBuffers[i]->setSize(outputBuffer.getNumChannels(), numSamples, false, false, true);
-        //clear the local temp buffer
-        synthBuffers[i]->clear();
-        audioBlocks.add(new juce::dsp::AudioBlock<float>{ *synthBuffers[i]});
+        //Set the size for the local temp buffer (the memory is allocated in prepareToPlay for the prepared block size)
+        if (startSample == 0 || end > synthBuffers[i]->getNumSamples())
+            synthBuffers[i]->setSize(outputBuffer.getNumChannels(), end, true, false, true);
+
+        //The voice was idle before this call (e.g. the note started in the middle of the block)
+        if (startSample != renderedEnd)
+            synthBuffers[i]->clear(0, startSample);
+
+        //clear the part of the local temp buffer rendered now
+        synthBuffers[i]->clear(startSample, numSamples);
     }
 
-    for (size_t pos = 0; pos < (size_t) numSamples;)
+    renderedEnd = end;
+
+    //A composite note renders all its partials through the chain of the first one
+    auto numPartialsToRender = compositeTable != nullptr ? 1 : numRenderedPartials;
+
+    //With the global LFO the updates happen on its ticks, on the same samples for all the voices of the part
+    if (globalLFO != nullptr)
+        lfoUpdateCounter = (size_t)getSamplesToGlobalTick(outputStart);
+    else
+        hasGlobalLFOOutputs = false;
+
+    for (size_t pos = (size_t)startSample; pos < (size_t)end;)
             {
-                auto max = juce::jmin ((size_t) numSamples - pos, lfoUpdateCounter);
+                auto max = juce::jmin ((size_t)end - pos, lfoUpdateCounter, phaseWarp.size() - 1);
+
+                //Shared by all the partials of this sub-block
+                auto* warp = updatePhaseWarp((int)max);
 
+                float renderedLevel = 0.0f;
 
-                for (int i = 0; i < numPartials; ++i)
+                for (int i = 0; i < numPartialsToRender; ++i)
                 {
-                    auto block = audioBlocks[i]->getSubBlock(pos, max);
+                    processorChains[i].get<oscIndex>().setPhaseWarp(warp);
 
+                    //AudioBlock it's just an alias for the given buffer needed by DSP classes (so by modifying
+                    //the AudioBlock we are actually modifying the given buffer)
+                    auto block = juce::dsp::AudioBlock<float>(*synthBuffers[i]).getSubBlock(pos, max);
 
                     juce::dsp::ProcessContextReplacing<float> context(block);
 
                     processorChains[i].process(context);
 
-                    adsr[i].applyEnvelopeToBuffer(*synthBuffers[i], pos, max);
+                    for (size_t n = 0; n < max; ++n)
+                        envelopeBuffer[n] = adsr[i].getNextSample();
+
+                    applyEnvelope(*synthBuffers[i], (int)pos, (int)max, tremoloGains[(size_t)i]);
+
+                    renderedLevel += trackPartialLevel(i, envelopeBuffer[max - 1]);
+                }
+
+                level = renderedLevel;
+
+                //The partials dropped by the CPU governor keep their envelopes moving, so that they come back
+                //at the level of the note
+                for (int i = numPartialsToRender; i < numPartials && compositeTable == nullptr; ++i)
+                {
+                    for (size_t n = 0; n < max; ++n)
+                        adsr[i].getNextSample();
                 }
 
                 pos += max;
@@ -154,56 +294,279 @@ void SynthVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int sta
 
                 if (lfoUpdateCounter == 0)
                 {
-                    lfoUpdateCounter = lfoUpdateRate;
-                    for (int i = 0; i < numPartials; ++i)
+                    lfoUpdateCounter = lfoUpdateInterval;
+
+                    if (globalLFO != nullptr)
                     {
-                        applyLFO(i);
+                        readGlobalLFO((int)pos + outputOffset);
+                        lfoUpdateCounter = (size_t)globalLFO->interval;
+                    }
+                    updateModulation();
+
+                    if (compositeTable != nullptr)
+                    {
+                        applyCompositeLFO();
+                    }
+                    else
+                    {
+                        //The dropped partials too, their LFOs stay in phase with the other voices
+                        for (int i = 0; i < numPartials; ++i)
+                        {
+                            applyLFO(i);
+                        }
                     }
                 }
             }
 
-    for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel)
+    //The partials that the CPU governor renders again fade in (their oscillators stood still while they were dropped)
+    if (compositeTable == nullptr)
     {
-        for (size_t i = 0; i < numPartials; i++)
+        if (numPartialsToRender > lastRenderedPartials)
         {
-            //Add the local temp buffer to the final audio output buffer
-            outputBuffer.addFrom(channel, startSample, *synthBuffers[i], channel, 0, numSamples);
+            fadeInFrom = lastRenderedPartials;
+            fadeInRemaining = partialFadeInSamples;
+        }
+
+        lastRenderedPartials = numPartialsToRender;
 
+        auto length = juce::jmin(numSamples, fadeInRemaining);
+
+        if (length > 0)
+        {
+            auto startGain = 1.0f - (float)fadeInRemaining / (float)partialFadeInSamples;
+            auto endGain = 1.0f - (float)(fadeInRemaining - length) / (float)partialFadeInSamples;
+
+            for (int i = fadeInFrom; i < numPartialsToRender; ++i)
+                synthBuffers[i]->applyGainRamp(startSample, length, startGain, endGain);
+
+            fadeInRemaining -= length;
         }
+    }
+
+    //Under load the release tails are cut: a short fade out (spread over the next calls when they are microblocks),
+    //then the voice is freed
+    if (stealFadeRemaining == 0 && stealReleasedVoices && isPlayingButReleased())
+        stealFadeRemaining = stealFadeSamples;
+
+    auto fadeLength = juce::jmin(numSamples, stealFadeRemaining);
+    auto fadeStart = (float)stealFadeRemaining / (float)stealFadeSamples;
+    auto fadeEnd = (float)(stealFadeRemaining - fadeLength) / (float)stealFadeSamples;
+
+    auto applyStealFade = [fadeLength, fadeStart, fadeEnd, numSamples](juce::AudioBuffer<float>& buffer, int offset)
+    {
+        buffer.applyGainRamp(offset, fadeLength, fadeStart, fadeEnd);
+        buffer.clear(offset + fadeLength, numSamples - fadeLength);
+    };
 
+    bool stealing = stealFadeRemaining > 0;
+    stealFadeRemaining -= fadeLength;
+    bool stolen = stealing && stealFadeRemaining == 0;
+
+    if (stealing)
+    {
+        for (int i = 0; i < numPartialsToRender; ++i)
+            applyStealFade(*synthBuffers[i], startSample);
+    }
+
+    for (size_t i = 0; i < numPartialsToRender; i++)
+    {
+        //Add the local temp buffer to the output of the partial (straight into the host bus when it has one),
+        //or to the final audio output buffer
+        auto* destination = &outputBuffer;
+
+        if (partialOutputs != nullptr && partialOutputs[i].getNumChannels() > 0)
+            destination = &partialOutputs[i];
+
+        auto numChannels = juce::jmin(destination->getNumChannels(), synthBuffers[i]->getNumChannels(), maxChannels);
+
+        float* destinationChannels[maxChannels];
+        const float* sourceChannels[maxChannels];
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            destinationChannels[channel] = destination->getWritePointer(channel, outputStart);
+            sourceChannels[channel] = synthBuffers[i]->getReadPointer(channel, startSample);
+        }
+
+        DspKernels::get().addChannels(destinationChannels, sourceChannels, numChannels, numSamples);
     }
 
+    //The orbit partials go with the highest partials when the CPU governor drops some
+    if (orbitPartials.getNumPartials() > 0 && numRenderedPartials == numPartials)
+    {
+        //Both are sized in prepareToPlay for the biggest segment
+        jassert(orbitBuffer.getNumSamples() >= numSamples && (int)envelopeBuffer.size() >= numSamples);
+
+        orbitPartials.setFrequencyScale(frequencyMultiplier);
+        orbitPartials.render(orbitBuffer.getWritePointer(0), numSamples);
+
+        for (int n = 0; n < numSamples; ++n)
+            envelopeBuffer[(size_t)n] = orbitAdsr.getNextSample();
+
+        applyEnvelope(orbitBuffer, 0, numSamples, 1.0f);
 
+        if (stealing)
+            applyStealFade(orbitBuffer, 0);
+
+        auto numChannels = juce::jmin(outputBuffer.getNumChannels(), maxChannels);
+
+        float* destinationChannels[maxChannels];
+        const float* sourceChannels[maxChannels];
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            destinationChannels[channel] = outputBuffer.getWritePointer(channel, outputStart);
+            sourceChannels[channel] = orbitBuffer.getReadPointer(0);
+        }
+
+        DspKernels::get().addChannels(destinationChannels, sourceChannels, numChannels, numSamples);
+    }
+
+
+    //The partials that are not rendered don't keep the voice alive
     bool active = false;
-    for (int i = 0; i < numPartials; ++i)
+    for (int i = 0; i < numPartialsToRender; ++i)
     {
         active |= adsr[i].isActive();
     }
 
-    if (!active)
+    if (stolen)
+    {
+        for (auto& envelope : adsr)
+            envelope.reset();
+
+        orbitAdsr.reset();
+    }
+
+    if (!active || stolen)
         clearCurrentNote();
 
 }
 
+float SynthVoice::trackPartialLevel(int i, float envelope) noexcept
+{
+    auto rising = envelope > lastEnvelopes[(size_t)i];
+    lastEnvelopes[(size_t)i] = envelope;
+
+    return fixedGains[i] * voiceGain * (rising ? 1.0f : envelope);
+}
+
+void SynthVoice::applyEnvelope(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, float gain) noexcept
+{
+    auto numChannels = juce::jmin(buffer.getNumChannels(), maxChannels);
+    float* channels[maxChannels];
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        channels[channel] = buffer.getWritePointer(channel, startSample);
+
+    DspKernels::get().applyEnvelope(channels, numChannels, envelopeBuffer.data(), gain, numSamples);
+}
+
 void SynthVoice::applyLFO(int i)
 {
-    auto lfoOut = lfos[i].processSample(0.0f);
-    auto depth = fixedGains[i] * lfoDepths[i];
-    auto gainVariation = juce::jmap(lfoOut, -1.0f, 1.0f, fixedGains[i] - depth, fixedGains[i] + depth);
-    processorChains[i].get<gainIndex>().setGainLinear(gainVariation);
+    tremoloGains[(size_t)i] = getTremoloGain(i);
+
+    if (!hasGlobalLFOOutputs)
+        advanceLFO(i);
+}
+
+int SynthVoice::getSamplesToGlobalTick(int startSample) const noexcept
+{
+    if (startSample < globalLFO->firstTick)
+        return globalLFO->firstTick - startSample;
+
+    //The first tick after startSample (a tick on startSample was applied by the previous call)
+    auto ticksBefore = (startSample - globalLFO->firstTick) / globalLFO->interval + 1;
+    return globalLFO->firstTick + ticksBefore * globalLFO->interval - startSample;
+}
+
+void SynthVoice::readGlobalLFO(int position) noexcept
+{
+    auto tick = (position - globalLFO->firstTick) / globalLFO->interval;
+
+    //Only the updates of the current block exist
+    if (tick < 0 || tick >= globalLFO->numTicks)
+        return;
+
+    std::copy_n(globalLFO->values + tick * ModulationMatrix::numPartials, ModulationMatrix::numPartials, globalLFOOutputs.begin());
+    hasGlobalLFOOutputs = true;
+}
+
+void SynthVoice::applyCompositeLFO()
+{
+    float gain = 0.0f;
+    float totalLevel = 0.0f;
+
+    for (int i = 0; i < numPartials; ++i)
+    {
+        gain += getTremoloGain(i);
+        totalLevel += fixedGains[i];
+
+        if (!hasGlobalLFOOutputs)
+            advanceLFO(i);
+    }
+
+    //The levels of the partials are already in the table
+    tremoloGains[0] = gain / totalLevel;
+}
+
+void SynthVoice::advanceLFO(int i)
+{
+    lfoPhases[i] += lfoIncrements[i];
+    if (lfoPhases[i] >= juce::MathConstants<double>::pi)
+        lfoPhases[i] -= juce::MathConstants<double>::twoPi;
+}
+
+float SynthVoice::getTremoloGain(int i) const
+{
+    auto lfoOut = hasGlobalLFOOutputs ? globalLFOOutputs[(size_t)i] : lfoTable->table.processSampleUnchecked((float)lfoPhases[i]);
+
+    //The matrix scales the gain (0..2 times) and moves the depth of the tremolo around the one of the patch
+    auto gainModulation = modulationValues[(size_t)ModulationMatrix::getDestinationIndex(ModulationMatrix::gain, i)];
+    auto depthModulation = modulationValues[(size_t)ModulationMatrix::getDestinationIndex(ModulationMatrix::tremoloDepth, i)];
+
+    auto partialGain = fixedGains[i] * voiceGain * juce::jlimit(0.0f, 2.0f, 1.0f + gainModulation);
+    auto wheelDepth = modWheelDepth * modulationSources[ModulationMatrix::modWheel];
+    auto depth = partialGain * juce::jlimit(0.0f, 1.0f, lfoDepths[i] + depthModulation + wheelDepth);
+    return juce::jmap(lfoOut, -1.0f, 1.0f, partialGain - depth, partialGain + depth);
 }
 
 void SynthVoice::prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannelsNumber)
 {
 
     //Prepare oscillator (passing ProcessSpec)
+    //This can be called again on a prepared voice (e.g. sample rate change): everything is re-prepared in place
+    //and the buffers are only re-allocated when they need to grow
 
+    if (isVoiceActive())
+        clearCurrentNote();
 
     for (int i = 0; i < numPartials; ++i)
     {
         adsr[i].setSampleRate(sampleRate);
+        adsr[i].reset();
+
+        //Scratch memory for the biggest block the host will send
+        synthBuffers[i]->setSize(outputChannelsNumber, samplesPerBlock, false, true, true);
     }
 
+    renderedEnd = 0;
+    stealFadeRemaining = 0;
+
+    orbitAdsr.setSampleRate(sampleRate);
+    orbitAdsr.reset();
+    orbitBuffer.setSize(1, samplesPerBlock, false, true, true);
+    preparedBlockSize = juce::jmax(1, samplesPerBlock);
+    scratchOffset = 0;
+    orbitPartials.prepare(sampleRate);
+    envelopeBuffer.resize((size_t)samplesPerBlock);
+
+    //One value per sample of the longest sub-block, plus the end
+    phaseWarp.resize((size_t)samplesPerBlock + 1);
+    bendOctaves = targetBendOctaves;
+    glideOctaves = 0;
+    frequencyMultiplier = std::exp2(bendOctaves);
+
 
     juce::dsp::ProcessSpec spec;
     spec.maximumBlockSize = samplesPerBlock;
@@ -217,28 +580,45 @@ void SynthVoice::prepareToPlay(double sampleRate, int samplesPerBlock, int outpu
         processorChains[i].prepare(spec);
     }
 
-    for (int i = 0; i < numPartials; i++)
-    {
-        lfos[i].
-            prepare({ spec.sampleRate / lfoUpdateRate, spec.maximumBlockSize, spec.numChannels });
-    }
+    controlRate = spec.sampleRate / lfoUpdateInterval;
+    updateLFOIncrements();
+    updateDetuneGlide();
+
+    modulationEnvelope.setSampleRate(controlRate);
+    modulationEnvelope.reset();
 
     isPrepared = true;
 }
 
 
-void SynthVoice::setGain(float gainValue)
+size_t SynthVoice::getSizeInBytes() const
 {
-    //Not implemented for the moment
+    size_t size = sizeof(*this);
+
+    for (auto* buffer : synthBuffers)
+        size += sizeof(*buffer) + (size_t)buffer->getNumChannels() * (size_t)buffer->getNumSamples() * sizeof(float);
+
+    size += processorChains.size() * sizeof(processorChains[0]);
+    size += adsr.size() * (sizeof(juce::ADSR) + sizeof(juce::ADSR::Parameters));
+    size += orbitPartials.getSizeInBytes() + (size_t)orbitBuffer.getNumSamples() * sizeof(float);
+    size += phaseWarp.size() * sizeof(double) + (tremoloGains.size() + envelopeBuffer.size()) * sizeof(float);
 
+    return size;
+}
+
+void SynthVoice::setGain(float gainValue)
+{
+    //Applied with the tremolo, at the next LFO update
+    voiceGain = gainValue;
 }
 
 void SynthVoice::setPan(float panValue)
 {
+    voicePan = panValue;
 
     for (int i = 0; i < numPartials; ++i)
     {
-        processorChains[i].get<panIndex>().setPan(panValue);
+        processorChains[i].get<panIndex>().setPan(juce::jlimit(-1.0f, 1.0f, voicePan + appliedPan[i]));
     }
 }
 
@@ -247,7 +627,7 @@ void SynthVoice::setFreqDetunes(const std::vector<double>& freqDetunes)
 
     for (int i = 0; i < numPartials; ++i)
     {
-        detuneFactors[i] = freqDetunes[i];
+        targetDetunes[i] = (float)freqDetunes[i];
     }
 
 }
@@ -257,9 +637,176 @@ void SynthVoice::setLFORates(const std::vector<double>& lfoRates)
     for (size_t i = 0; i < numPartials; i++)
     {
         this->lfoRates[i] = lfoRates[i];
-        lfos[i].setFrequency(lfoRates[i]);
     }
 
+    updateLFOIncrements();
+}
+
+void SynthVoice::updateLFOIncrements()
+{
+    if (controlRate <= 0)
+        return;
+
+    for (size_t i = 0; i < numPartials; i++)
+    {
+        //+-1 of rate modulation is +-2 octaves
+        lfoIncrements[i] = juce::MathConstants<double>::twoPi * lfoRates[i] * std::exp2(2.0 * appliedRate[i]) / controlRate;
+    }
+}
+
+const double* SynthVoice::updatePhaseWarp(int numSamples)
+{
+    auto startMultiplier = frequencyMultiplier;
+    auto sampleRate = getSampleRate();
+
+    //One pole towards the wheel, snapped once the step is inaudible
+    auto bendDifference = targetBendOctaves - bendOctaves;
+
+    if (std::abs(bendDifference) < 1e-6)
+        bendOctaves = targetBendOctaves;
+    else
+        bendOctaves += (1.0 - std::exp(-numSamples / (bendSmoothingTime * sampleRate))) * bendDifference;
+
+    //The glide is 95% done after the glide time
+    if (std::abs(glideOctaves) < 1e-5 || glideTime <= 0)
+        glideOctaves = 0;
+    else
+        glideOctaves *= std::exp(-3.0 * numSamples / (glideTime * sampleRate));
+
+    frequencyMultiplier = std::exp2(bendOctaves + glideOctaves);
+
+    if (startMultiplier == 1.0 && frequencyMultiplier == 1.0)
+        return nullptr;
+
+    //Sum of a linear ramp of the multiplier: a plain loop the compiler vectorises
+    auto slope = (frequencyMultiplier - startMultiplier) / numSamples;
+    auto* warp = phaseWarp.data();
+
+    for (int i = 0; i <= numSamples; ++i)
+        warp[i] = i * startMultiplier + slope * (0.5 * i * (i - 1));
+
+    return warp;
+}
+
+void SynthVoice::setExpression(int bendRange, double glideSeconds, float wheelDepth, double* newLastNoteFrequency)
+{
+    if (bendRange != pitchBendRange)
+    {
+        pitchBendRange = bendRange;
+        targetBendOctaves = getBendOctaves();
+    }
+
+    glideTime = glideSeconds;
+    modWheelDepth = wheelDepth;
+    lastNoteFrequency = newLastNoteFrequency;
+}
+
+void SynthVoice::updateDetuneGlide()
+{
+    if (controlRate > 0)
+        detuneGlideCoefficient = (float)(1.0 - std::exp(-1.0 / (detuneGlideTime * controlRate)));
+}
+
+void SynthVoice::setCompositeTable(const Wavetable* table, const CompositeWavetable::Settings& settings)
+{
+    offeredCompositeTable = table;
+    offeredCompositeSettings = settings;
+
+    //The seed moved (or the patch changed): the partials take over
+    if (compositeTable != nullptr && table != compositeTable)
+        leaveCompositeMode();
+}
+
+void SynthVoice::leaveCompositeMode()
+{
+    auto& compositeOscillator = processorChains[0].get<oscIndex>();
+    auto basePhase = compositeOscillator.getPhase();
+
+    compositeOscillator.setCompositeTable(nullptr);
+
+    for (int i = 0; i < numPartials; ++i)
+    {
+        auto& oscillator = processorChains[i].get<oscIndex>();
+
+        //Partial i is harmonic n of the base, so its phase is n times the phase of the table
+        oscillator.setPhase(basePhase * compositeSettings.harmonics[(size_t)i]);
+        oscillator.setFrequency(partialFrequencies[i] * std::exp2((double)appliedPitch[(size_t)i]));
+
+        tremoloGains[(size_t)i] = getTremoloGain(i);
+
+        //Only the envelope of the first partial was running (they all had the same settings)
+        if (i > 0)
+            adsr[i] = adsr[0];
+    }
+
+    compositeTable = nullptr;
+}
+
+void SynthVoice::setModulation(const ModulationMatrix::CompiledRoutes* routes, const float* newOrbitSources)
+{
+    modulationRoutes = routes;
+    orbitSources = newOrbitSources;
+}
+
+void SynthVoice::updateModulation()
+{
+    modulationSources[ModulationMatrix::envelope] = modulationEnvelope.getNextSample();
+
+    //One step of the detune glide (a one pole towards the last detunes of the part).
+    //A composite note keeps its frequencies, it leaves its table when the detunes change
+    std::array<bool, ModulationMatrix::numPartials> detuneChanged{};
+
+    for (int i = 0; i < numRenderedPartials && compositeTable == nullptr; ++i)
+    {
+        auto difference = targetDetunes[i] - detuneFactors[i];
+
+        if (difference == 0.0f)
+            continue;
+
+        //Snap once the step is inaudible
+        detuneFactors[i] = std::abs(difference) < 1e-5f * std::abs(targetDetunes[i]) ? targetDetunes[i] : detuneFactors[i] + detuneGlideCoefficient * difference;
+        partialFrequencies[i] = noteFrequency * detuneFactors[i];
+        detuneChanged[(size_t)i] = true;
+    }
+
+    if (modulationRoutes != nullptr && orbitSources != nullptr)
+    {
+        std::copy_n(orbitSources, ModulationMatrix::numOrbitSources, modulationSources.begin() + ModulationMatrix::firstOrbitSource);
+
+        //All the routes in one pass, the gain and tremolo depth are read by applyLFO
+        ModulationMatrix::evaluate(*modulationRoutes, modulationSources.data(), modulationValues.data());
+    }
+
+    bool rateChanged = false;
+
+    for (int i = 0; i < numRenderedPartials; ++i)
+    {
+        auto pitch = modulationValues[(size_t)ModulationMatrix::getDestinationIndex(ModulationMatrix::pitch, i)];
+        auto pan = modulationValues[(size_t)ModulationMatrix::getDestinationIndex(ModulationMatrix::pan, i)];
+        auto rate = modulationValues[(size_t)ModulationMatrix::getDestinationIndex(ModulationMatrix::tremoloRate, i)];
+
+        //+-1 of pitch modulation is +-1 octave
+        if ((pitch != appliedPitch[(size_t)i] || detuneChanged[(size_t)i]) && compositeTable == nullptr)
+        {
+            appliedPitch[(size_t)i] = pitch;
+            processorChains[i].get<oscIndex>().setFrequency(partialFrequencies[i] * std::exp2((double)pitch));
+        }
+
+        if (pan != appliedPan[(size_t)i])
+        {
+            appliedPan[(size_t)i] = pan;
+            processorChains[i].get<panIndex>().setPan(juce::jlimit(-1.0f, 1.0f, voicePan + pan));
+        }
+
+        if (rate != appliedRate[(size_t)i])
+        {
+            appliedRate[(size_t)i] = rate;
+            rateChanged = true;
+        }
+    }
+
+    if (rateChanged)
+        updateLFOIncrements();
 }
 
 void SynthVoice::setLFODepths(const std::vector<double>& lfoDepths)
@@ -270,6 +817,16 @@ void SynthVoice::setLFODepths(const std::vector<double>& lfoDepths)
     }
 }
 
+void SynthVoice::setOrbitPartials(const double* detunes, const float* gains, int count)
+{
+    orbitPartials.setPartials(detunes, gains, count);
+}
+
+void SynthVoice::setOrbitCrossover(const int crossover)
+{
+    orbitCrossover = crossover;
+}
+
 void SynthVoice::updateADSR(int i, const float attack, const float decay, const float sustain, const float release)
 {
     adsrParams[i].attack = attack;
@@ -277,25 +834,61 @@ void SynthVoice::updateADSR(int i, const float attack, const float decay, const
     adsrParams[i].sustain = sustain;
     adsrParams[i].release = release;
     adsr[i].setParameters(adsrParams[i]);
+
+    if (i == 0)
+    {
+        orbitAdsr.setParameters(adsrParams[i]);
+        modulationEnvelope.setParameters(adsrParams[i]);
+    }
 }
 
 void SynthVoice::setWaveType(const int partialIndex, const int choice)
 {
+    processorChains[partialIndex].get<oscIndex>().setWaveType(choice);
+}
 
+void SynthVoice::setWavetable(const int partialIndex, const Wavetable* table, const float framePosition)
+{
+    processorChains[partialIndex].get<oscIndex>().setWavetable(table, framePosition);
+}
 
-    switch (choice)
-    {
-    case SINE: //Sin wave
-        processorChains[partialIndex].get<oscIndex>().initialise([](float x) { return std::sin(x); });
-        break;
-    case SAW: //Saw wave
-        processorChains[partialIndex].get<oscIndex>().initialise([](float x) { return x / juce::MathConstants<float>::pi; });
-        break;
-    case SQUARE: //Square wave
-        processorChains[partialIndex].get<oscIndex>().initialise([](float x) { return x < 0.0f ? -1.0f : 1.0f; });
-        break;
-    }
+void SynthVoice::setSineTier(const int tier)
+{
+    if (tier == patchSineTier)
+        return;
+
+    patchSineTier = tier;
+    updateSineTiers();
+}
+
+void SynthVoice::updateSineTiers()
+{
+    auto tier = juce::jmax(patchSineTier, minSineTier);
 
+    for (int i = 0; i < numPartials; ++i)
+        processorChains[i].get<oscIndex>().setSineTier(tier);
 }
 
+void SynthVoice::setQuality(const CpuGovernor::Quality& quality)
+{
+    numRenderedPartials = juce::jmin(numPartials, quality.maxPartials);
+    stealReleasedVoices = quality.stealReleasedVoices;
 
+    if ((size_t)quality.lfoUpdateInterval != lfoUpdateInterval)
+    {
+        lfoUpdateInterval = (size_t)quality.lfoUpdateInterval;
+        lfoUpdateCounter = juce::jmin(lfoUpdateCounter, lfoUpdateInterval);
+
+        controlRate = getSampleRate() / lfoUpdateInterval;
+        updateLFOIncrements();
+        updateDetuneGlide();
+
+        modulationEnvelope.setSampleRate(controlRate);
+    }
+
+    if (quality.minSineTier != minSineTier)
+    {
+        minSineTier = quality.minSineTier;
+        updateSineTiers();
+    }
+}
@@ -11,12 +11,19 @@
 #pragma once
 #include <JuceHeader.h>
 #include "SynthSound.h"
+#include "WavetableLibrary.h"
+#include "SharedResources.h"
+#include "CpuGovernor.h"
+#include "PartialOscillator.h"
+#include "OrbitPartials.h"
+#include "ModulationMatrix.h"
+#include "CompositeWavetable.h"
 
 class SynthVoice : public juce::SynthesiserVoice
 {
 public:
 
-    SynthVoice(int numPartials);
+    SynthVoice(int numPartials, SharedResources::SineTable::Ptr lfoTable);
     
 
     bool canPlaySound(juce::SynthesiserSound*) override;
@@ -29,14 +36,19 @@ public:
 
     void controllerMoved(int controllerNumber, int newControllerValue) override;
 
+    void channelPressureChanged(int newChannelPressureValue) override;
+
     void renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override;
 
     void prepareToPlay(double sampleRate, int samplesPerBlock, int outputChannelsNumber);
 
+    //Gain of the whole voice (the modulation matrix scales each partial on top of it)
     void setGain(float gainValue);
 
+    //Centre of the pan of all the partials
     void setPan(float panValue);
 
+    //A playing note glides to the new detunes (so that dragging the seed doesn't step the partials), a new one starts on them
     void setFreqDetunes(const std::vector<double>& freqDetunes);
 
     void setLFORates(const std::vector<double>& lfoRates);
@@ -49,46 +61,232 @@ public:
     enum chainElements
     {
         oscIndex,
-        gainIndex,
         panIndex
     };
 
     void setWaveType(const int partialIndex, const int choice);
 
+    //Only swaps a pointer, so it is safe to call from the audio thread (nullptr falls back to the previous wave type)
+    void setWavetable(const int partialIndex, const Wavetable* table, const float framePosition);
+
+    //Accuracy of the sine partials, as PartialOscillator::SineTier (the CPU governor can force a cheaper one)
+    void setSineTier(const int tier);
+
+    //Extra partials further along the orbit (the arrays belong to the part and are read in every block)
+    void setOrbitPartials(const double* detunes, const float* gains, int count);
+
+    //Number of audible orbit partials above which a new note uses the inverse FFT engine instead of the oscillator bank
+    void setOrbitCrossover(const int crossover);
+
+    //Routes of the part and values of its orbit sources (both belong to the part and are read at control rate)
+    void setModulation(const ModulationMatrix::CompiledRoutes* routes, const float* orbitSources);
+
+    //Composite table of the part for the notes that start (nullptr: the partials are rendered one by one).
+    //A note playing a table goes back to the partials, with the same phases, when the part stops offering it
+    void setCompositeTable(const Wavetable* table, const CompositeWavetable::Settings& settings);
+
+    //One buffer per partial, with the channels of the output buffer (nullptr, or a buffer without channels: the partial
+    //is added to the output buffer). They belong to the part and are only valid for the current block
+    void setPartialOutputs(juce::AudioBuffer<float>* outputs) noexcept { partialOutputs = outputs; }
+
+    //Tremolo LFOs of a part, computed once per block for all its voices (so they stay in phase)
+    struct GlobalLFO
+    {
+        int firstTick = 1; //sample of the first update in the block, 1..interval after the start of the chunk being rendered
+                           //(an update at the end belongs to the chunk)
+        int interval = 100; //samples between two updates
+        int numTicks = 0;
+        const float* values = nullptr; //LFO output (-1..1) of partial i at update t: values[t * numPartials + i]
+    };
+
+    //nullptr: the voice runs its own free-running LFOs. The global LFO belongs to the part and is only valid for the
+    //current block; the voice still applies its own depth, gain and modulation (but not the rate modulation)
+    void setGlobalLFO(const GlobalLFO* lfo) noexcept { globalLFO = lfo; }
+
+    //Pitch bend range in semitones, glide time in seconds (0: off), tremolo depth of the mod wheel.
+    //The last note frequency belongs to the part: a new note glides from it and replaces it
+    void setExpression(int bendRange, double glideSeconds, float wheelDepth, double* lastNoteFrequency);
+
     void applyLFO(int i);
+
+    //Set by the CPU governor every block (realtime safe, nothing is allocated)
+    void setQuality(const CpuGovernor::Quality& quality);
+
+    //Sum of the gains of the rendered partials times their envelopes at the end of the last segment, used to steal
+    //the quietest voice (a note whose envelopes are still rising counts at full level)
+    float getLevel() const noexcept { return level; }
+
+    //Approximate size of the voice and of its buffers (for the memory report)
+    size_t getSizeInBytes() const;
     
     //Public to be able to access it in the plugin processor
     juce::OwnedArray<juce::AudioBuffer<float>> synthBuffers; //Local buffers to temporarily store synth output (one for each partial)
 
 private:
 
-    enum waveTypes
-    {
-        SINE,
-        SAW,
-        SQUARE
-    };
-
     int numPartials;
 
-    std::vector< juce::dsp::ProcessorChain<juce::dsp::Oscillator<float>, juce::dsp::Gain<float>, juce::dsp::Panner<float>>> processorChains;
+    std::vector< juce::dsp::ProcessorChain<PartialOscillator, juce::dsp::Panner<float>>> processorChains;
 
     std::vector<juce::ADSR> adsr;
     std::vector<juce::ADSR::Parameters> adsrParams;
 
-    std::vector < juce::dsp::Oscillator<float>> lfos;
+    //The panner outputs mono or stereo
+    static constexpr int maxChannels = 2;
+
+    //Gain of each partial (level and tremolo), applied with its envelope by the DSP kernels
+    std::vector<float> tremoloGains;
+
+    //Envelope of the current sub-block
+    std::vector<float> envelopeBuffer;
+
+    //Multiplies the channels of buffer from startSample by envelopeBuffer and gain
+    void applyEnvelope(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, float gain) noexcept;
+
+    //The LFOs read the sine table shared by all the voices of all the plugin instances
+    SharedResources::SineTable::Ptr lfoTable;
+    std::vector<double> lfoPhases; //-pi..pi
+    std::vector<double> lfoIncrements;
+
+    double controlRate = 0; //rate at which the LFOs are evaluated (sample rate / lfoUpdateInterval)
+
+    void updateLFOIncrements();
+
+    //Gain of partial i at the current LFO position (tremolo and modulation), then the step to the next position
+    float getTremoloGain(int i) const;
+    void advanceLFO(int i);
+
+    //The composite table gets the mean of the tremolo gains of the partials, weighted by their level
+    void applyCompositeLFO();
+
+    const Wavetable* offeredCompositeTable = nullptr;
+    CompositeWavetable::Settings offeredCompositeSettings;
+
+    //Table played by the current note (nullptr: additive)
+    const Wavetable* compositeTable = nullptr;
+    CompositeWavetable::Settings compositeSettings;
+
+    void leaveCompositeMode();
+
+    //Evaluates the modulation matrix (once per LFO update) and applies the destinations that changed
+    void updateModulation();
+
+    const ModulationMatrix::CompiledRoutes* modulationRoutes = nullptr;
+    const float* orbitSources = nullptr;
+
+    std::array<float, ModulationMatrix::numSources> modulationSources{};
+    std::array<float, ModulationMatrix::numDestinations> modulationValues{};
+
+    //Pitch, pan and tremolo rate values applied to the partials, so that they are only recomputed when they change
+    std::array<float, ModulationMatrix::numPartials> appliedPitch{}, appliedPan{}, appliedRate{};
+
+    //Envelope source, evaluated at control rate
+    juce::ADSR modulationEnvelope;
+
+    float voiceGain = 1.0f;
+    float voicePan = 0.0f;
 
 
     std::vector<float> lfoRates;
     std::vector<float> lfoDepths;
 
     static constexpr size_t lfoUpdateRate = 100;
+
+    size_t lfoUpdateInterval = lfoUpdateRate; //raised by the CPU governor
     
     size_t lfoUpdateCounter = lfoUpdateRate;
 
+    //Quality settings from the CPU governor
+    int numRenderedPartials;
+    int minSineTier = 0;
+    bool stealReleasedVoices = false;
+
+    int patchSineTier = PartialOscillator::polynomial;
+
+    //Released voices stolen by the CPU governor fade out over this many samples
+    static constexpr int stealFadeSamples = 256;
+    int stealFadeRemaining = 0;
+
+    float level = 0.0f;
+    std::array<float, ModulationMatrix::numPartials> lastEnvelopes{};
+
+    //Gain times envelope of partial i, at full envelope while it rises
+    float trackPartialLevel(int i, float envelope) noexcept;
+
+    //Partials rendered again by the CPU governor fade in over this many samples
+    static constexpr int partialFadeInSamples = 256;
+    int lastRenderedPartials = 0;
+    int fadeInFrom = 0;
+    int fadeInRemaining = 0;
+
+    //End of the last segment rendered in synthBuffers (the segments of a block follow each other)
+    int renderedEnd = 0;
+
+    //Size of the scratch buffers, and position of the output at their first sample
+    int preparedBlockSize = 1;
+    int scratchOffset = 0;
+
+    //Renders outputStart..outputStart + numSamples of the output at startSample in the scratch buffers
+    void renderSegment(juce::AudioBuffer<float>& outputBuffer, int outputStart, int startSample, int numSamples);
+
+    void updateSineTiers();
+
     std::vector<float> fixedGains;
 
-    std::vector<float> detuneFactors;
+    std::vector<float> detuneFactors; //current values, they follow targetDetunes at control rate
+    std::vector<float> targetDetunes;
+
+    //Time constant of the detune glide
+    static constexpr double detuneGlideTime = 0.03;
+    float detuneGlideCoefficient = 1.0f;
+
+    void updateDetuneGlide();
+
+    double noteFrequency = 0;
+    std::vector<double> partialFrequencies;
+
+    //The pitch bend and the glide are one multiplier of all the frequencies of the voice, both smoothed in octaves.
+    //For each sub-block, the multiplier goes linearly from its previous value to the new one, and the phase warp
+    //(the sum of the multiplier over the previous samples) is computed once and read by all the partials
+    int pitchBendRange = 2;
+    int pitchWheelPosition = 8192;
+    double bendOctaves = 0, targetBendOctaves = 0;
+    double glideOctaves = 0; //from the note, decays to 0
+    double glideTime = 0;
+    double* lastNoteFrequency = nullptr;
+    double frequencyMultiplier = 1;
+
+    //Time constant of the pitch bend smoothing
+    static constexpr double bendSmoothingTime = 0.005;
+
+    std::vector<double> phaseWarp;
+
+    double getBendOctaves() const noexcept { return pitchBendRange * (pitchWheelPosition - 8192) / (12.0 * 8192.0); }
+
+    //Advances the bend and the glide by a sub-block, nullptr when the multiplier stays at 1
+    const double* updatePhaseWarp(int numSamples);
+
+    float modWheelDepth = 0.0f;
+
+    juce::AudioBuffer<float>* partialOutputs = nullptr;
+
+    const GlobalLFO* globalLFO = nullptr;
+
+    //Values of the global LFO at the last update
+    std::array<float, ModulationMatrix::numPartials> globalLFOOutputs{};
+    bool hasGlobalLFOOutputs = false;
+
+    //Samples from startSample to the next update of the global LFO
+    int getSamplesToGlobalTick(int startSample) const noexcept;
+
+    //Takes the values of the global LFO update at the given position of the block
+    void readGlobalLFO(int position) noexcept;
+
+    //The orbit partials follow the envelope settings of the fundamental
+    OrbitPartials orbitPartials;
+    juce::ADSR orbitAdsr;
+    juce::AudioBuffer<float> orbitBuffer;
+    int orbitCrossover = 32;
 
     bool isPrepared = false;
 
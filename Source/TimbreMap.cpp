@@ -0,0 +1,430 @@
+/*
+  ==============================================================================
+
+    TimbreMap.cpp
+    Created: 22 Oct 2026 9:48:40am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "TimbreMap.h"
+#include "SharedResources.h"
+#include "SynthPart.h"
+
+namespace
+{
+    //Header of the index file, the quantised descriptors follow it
+    struct IndexHeader
+    {
+        char magic[4];
+        juce::int32 version;
+        juce::int32 gridSize;
+        juce::int32 numFractals;
+        juce::int32 numDescriptors;
+        juce::int32 reserved;
+        float minimum[4];
+        float maximum[4];
+        char padding[8];
+    };
+
+    static_assert(sizeof(IndexHeader) == 64, "The index header must keep the values aligned");
+    static_assert(TimbreMap::numDescriptors <= 4, "The header has room for 4 descriptors");
+
+    static constexpr juce::int32 indexVersion = 1;
+
+    //Short note with the default patch: C3 for a quarter of a second at a low sample rate
+    static constexpr double analysisSampleRate = 22050;
+    static constexpr int noteNumber = 48;
+    static constexpr int fftOrder = 12;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int analysisStart = 1024; //skip the attack
+    static constexpr int noteLength = analysisStart + fftSize;
+
+    //Index of the first descriptor of a grid point (row 0 is y = -1, column 0 is x = -1)
+    inline size_t getValueIndex(int fractal, int row, int column) noexcept
+    {
+        return (((size_t)fractal * TimbreMap::gridSize + (size_t)row) * TimbreMap::gridSize + (size_t)column) * TimbreMap::numDescriptors;
+    }
+
+    //A private synth with a single voice, rendering notes exactly as a part does
+    class PointAnalyser
+    {
+    public:
+
+        explicit PointAnalyser(SharedResources::SineTable::Ptr lfoTable)
+            : fft(fftOrder), window((size_t)fftSize, juce::dsp::WindowingFunction<float>::hann)
+        {
+            voice = new SynthVoice(processor_consts::NUM_PARTIALS, lfoTable);
+            synth.addVoice(voice);
+            synth.addSound(new SynthSound());
+            synth.setCurrentPlaybackSampleRate(analysisSampleRate);
+
+            buffer.setSize(1, noteLength);
+            spectrum.resize(2 * fftSize);
+        }
+
+        TimbreMap::Descriptors analyse(int fractal, double x, double y)
+        {
+            SynthPart::generateFractalSuccession(SynthPart::getFractalFunction(fractal), { x, y }, points);
+            SynthPart::generateLFORates(points, lfoRates);
+            SynthPart::generateFreqDetunes(points, detunes);
+
+            //Start every note from silence, with the default envelopes of the parameters
+            voice->prepareToPlay(analysisSampleRate, noteLength, 1);
+
+            for (int j = 0; j < processor_consts::NUM_PARTIALS; j++)
+                voice->updateADSR(j, 0.01f, 0.1f, 1.0f, 0.4f);
+
+            voice->setFreqDetunes(detunes);
+            voice->setLFORates(lfoRates);
+
+            juce::MidiBuffer midi;
+            midi.addEvent(juce::MidiMessage::noteOn(1, noteNumber, 1.0f), 0);
+
+            buffer.clear();
+            synth.renderNextBlock(buffer, midi, 0, noteLength);
+            synth.allNotesOff(0, false);
+
+            TimbreMap::Descriptors descriptors;
+            auto fundamental = juce::MidiMessage::getMidiNoteInHertz(noteNumber);
+
+            //Spectral centroid of the sustained part of the note
+            std::fill(spectrum.begin(), spectrum.end(), 0.0f);
+            std::copy_n(buffer.getReadPointer(0, analysisStart), fftSize, spectrum.begin());
+            window.multiplyWithWindowingTable(spectrum.data(), (size_t)fftSize);
+            fft.performFrequencyOnlyForwardTransform(spectrum.data());
+
+            double weightedSum = 0, magnitudeSum = 0;
+
+            for (int bin = 1; bin <= fftSize / 2; ++bin)
+            {
+                weightedSum += bin * analysisSampleRate / fftSize * spectrum[(size_t)bin];
+                magnitudeSum += spectrum[(size_t)bin];
+            }
+
+            auto centroid = magnitudeSum > 0 ? weightedSum / magnitudeSum : fundamental;
+            descriptors[TimbreMap::brightness] = (float)std::log2(centroid / fundamental);
+
+            //The partial frequencies and LFO rates are known exactly, weighted by the gains of the partials
+            double distanceSum = 0, rateSum = 0, gainSum = 0;
+
+            for (size_t i = 0; i < processor_consts::NUM_PARTIALS; i++)
+            {
+                auto gain = (double)CompositeWavetable::getPartialGain((int)i);
+                auto harmonic = juce::jmax(1.0, std::round(detunes[i]));
+
+                distanceSum += gain * juce::jmin(0.5, std::abs(detunes[i] - harmonic));
+                rateSum += gain * lfoRates[i];
+                gainSum += gain;
+            }
+
+            descriptors[TimbreMap::inharmonicity] = (float)(distanceSum / gainSum);
+            descriptors[TimbreMap::tremoloRate] = (float)(rateSum / gainSum);
+
+            //Points where the mapping breaks down (e.g. no imaginary part for the LFO rates)
+            for (auto& value : descriptors)
+            {
+                if (!std::isfinite(value))
+                    value = 0;
+            }
+
+            return descriptors;
+        }
+
+    private:
+
+        juce::Synthesiser synth;
+        SynthVoice* voice;
+
+        juce::AudioBuffer<float> buffer;
+
+        juce::dsp::FFT fft;
+        juce::dsp::WindowingFunction<float> window;
+        std::vector<float> spectrum;
+
+        std::vector<std::complex<double>> points = std::vector<std::complex<double>>(processor_consts::NUM_PARTIALS);
+        std::vector<double> lfoRates = std::vector<double>(processor_consts::NUM_PARTIALS);
+        std::vector<double> detunes = std::vector<double>(processor_consts::NUM_PARTIALS);
+    };
+}
+
+TimbreMap::TimbreMap(SharedResources& sharedResources)
+    : juce::Thread("Timbre map"), sharedResources(sharedResources), indexFile(getDefaultFile())
+{
+}
+
+TimbreMap::~TimbreMap()
+{
+    //The jobs check threadShouldExit after every point
+    stopThread(10000);
+}
+
+juce::File TimbreMap::getDefaultFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("DelayLama").getChildFile("Fractasizer").getChildFile("TimbreMap.ftm");
+}
+
+void TimbreMap::load()
+{
+    if (!isLoaded() && !isBuilding() && mapIndex(indexFile))
+        sendChangeMessage();
+}
+
+void TimbreMap::build()
+{
+    if (isBuilding())
+        return;
+
+    completedPoints.store(0);
+    startThread(2); //below the audio and message threads, it can take a while
+}
+
+bool TimbreMap::isLoaded() const
+{
+    const juce::ScopedLock sl(lock);
+    return values != nullptr;
+}
+
+void TimbreMap::run()
+{
+    auto numPoints = numFractals * gridSize * gridSize;
+    std::vector<float> results((size_t)numPoints * numDescriptors);
+
+    auto lfoTable = sharedResources.getLFOSineTable();
+
+    {
+        //One job per row, every job has its own synth
+        juce::ThreadPool pool(juce::SystemStats::getNumCpus());
+        pool.setThreadPriorities(2);
+
+        for (int fractal = 0; fractal < numFractals; ++fractal)
+        {
+            for (int row = 0; row < gridSize; ++row)
+            {
+                pool.addJob([this, &results, lfoTable, fractal, row]
+                {
+                    PointAnalyser analyser(lfoTable);
+
+                    for (int column = 0; column < gridSize && !threadShouldExit(); ++column)
+                    {
+                        auto descriptors = analyser.analyse(fractal, getCoordinate(column), getCoordinate(row));
+                        std::copy(descriptors.begin(), descriptors.end(), results.begin() + (std::ptrdiff_t)getValueIndex(fractal, row, column));
+
+                        ++completedPoints;
+                    }
+                });
+            }
+        }
+
+        while (pool.getNumJobs() > 0)
+        {
+            if (threadShouldExit())
+            {
+                pool.removeAllJobs(true, 10000);
+                return;
+            }
+
+            wait(100);
+        }
+    }
+
+    //Quantise every descriptor on its own range (16 bits are far more than the heatmaps and queries need)
+    IndexHeader header{};
+    std::memcpy(header.magic, "FTM1", 4);
+    header.version = indexVersion;
+    header.gridSize = gridSize;
+    header.numFractals = numFractals;
+    header.numDescriptors = numDescriptors;
+
+    for (int d = 0; d < numDescriptors; ++d)
+    {
+        header.minimum[d] = std::numeric_limits<float>::max();
+        header.maximum[d] = std::numeric_limits<float>::lowest();
+
+        for (size_t i = (size_t)d; i < results.size(); i += numDescriptors)
+        {
+            header.minimum[d] = juce::jmin(header.minimum[d], results[i]);
+            header.maximum[d] = juce::jmax(header.maximum[d], results[i]);
+        }
+    }
+
+    std::vector<juce::uint16> quantised(results.size());
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        auto d = i % numDescriptors;
+        auto range = header.maximum[d] - header.minimum[d];
+        auto normalised = range > 0 ? (results[i] - header.minimum[d]) / range : 0.0f;
+
+        quantised[i] = (juce::uint16)juce::roundToInt(juce::jlimit(0.0f, 1.0f, normalised) * 65535.0f);
+    }
+
+    indexFile.getParentDirectory().createDirectory();
+
+    //Write to a temporary file first, so that a half written index is never mapped
+    juce::TemporaryFile temp(indexFile);
+    {
+        juce::FileOutputStream out(temp.getFile());
+
+        if (!out.openedOk())
+            return;
+
+        out.write(&header, sizeof(IndexHeader));
+        out.write(quantised.data(), quantised.size() * sizeof(juce::uint16));
+        out.flush();
+
+        if (out.getStatus().failed())
+            return;
+    }
+
+    //The old index can't be replaced while it is mapped (on Windows)
+    {
+        const juce::ScopedLock sl(lock);
+        values = nullptr;
+        mappedIndex.reset();
+    }
+
+    if (temp.overwriteTargetFileWithTemporary())
+        mapIndex(indexFile);
+
+    sendChangeMessage();
+}
+
+bool TimbreMap::mapIndex(const juce::File& file)
+{
+    if (!file.existsAsFile())
+        return false;
+
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+
+    if (mapped->getData() == nullptr || mapped->getSize() < sizeof(IndexHeader))
+        return false;
+
+    IndexHeader header;
+    std::memcpy(&header, mapped->getData(), sizeof(IndexHeader));
+
+    //Reject the indexes of another format or of another grid
+    if (std::memcmp(header.magic, "FTM1", 4) != 0
+        || header.version != indexVersion
+        || header.gridSize != gridSize
+        || header.numFractals != numFractals
+        || header.numDescriptors != numDescriptors)
+        return false;
+
+    auto expectedSize = sizeof(IndexHeader) + (size_t)numFractals * gridSize * gridSize * numDescriptors * sizeof(juce::uint16);
+
+    if (mapped->getSize() < expectedSize)
+        return false;
+
+    const juce::ScopedLock sl(lock);
+
+    for (int d = 0; d < numDescriptors; ++d)
+    {
+        minimum[(size_t)d] = header.minimum[d];
+        maximum[(size_t)d] = header.maximum[d];
+    }
+
+    values = static_cast<const juce::uint16*>(juce::addBytesToPointer(mapped->getData(), sizeof(IndexHeader)));
+    mappedIndex = std::move(mapped);
+
+    return true;
+}
+
+float TimbreMap::getNormalisedValue(int fractal, int row, int column, int descriptor) const noexcept
+{
+    return values[getValueIndex(fractal, row, column) + (size_t)descriptor] / 65535.0f;
+}
+
+juce::Image TimbreMap::createHeatmap(int fractal, int descriptor) const
+{
+    const juce::ScopedLock sl(lock);
+
+    if (values == nullptr)
+        return {};
+
+    juce::Image heatmap(juce::Image::ARGB, gridSize, gridSize, true);
+
+    for (int row = 0; row < gridSize; ++row)
+    {
+        for (int column = 0; column < gridSize; ++column)
+        {
+            auto value = getNormalisedValue(fractal, row, column, descriptor);
+            heatmap.setPixelAt(column, gridSize - 1 - row, juce::Colour::fromHSV((1.0f - value) * 0.66f, 0.9f, 1.0f, 0.5f));
+        }
+    }
+
+    return heatmap;
+}
+
+TimbreMap::Descriptors TimbreMap::analysePoint(int fractal, double x, double y) const
+{
+    PointAnalyser analyser(sharedResources.getLFOSineTable());
+    return analyser.analyse(fractal, x, y);
+}
+
+juce::Array<TimbreMap::Match> TimbreMap::findSimilar(int fractal, double x, double y, int maxResults) const
+{
+    auto target = analysePoint(fractal, x, y);
+
+    const juce::ScopedLock sl(lock);
+
+    juce::Array<Match> matches;
+
+    if (values == nullptr || maxResults <= 0)
+        return matches;
+
+    Descriptors normalisedTarget;
+
+    for (size_t d = 0; d < numDescriptors; ++d)
+    {
+        auto range = maximum[d] - minimum[d];
+        normalisedTarget[d] = range > 0 ? (target[d] - minimum[d]) / range : 0.0f;
+    }
+
+    //The points right next to the query sound like it anyway
+    auto queryColumn = (x + 1.0) * 0.5 * gridSize;
+    auto queryRow = (y + 1.0) * 0.5 * gridSize;
+
+    for (int row = 0; row < gridSize; ++row)
+    {
+        for (int column = 0; column < gridSize; ++column)
+        {
+            if (std::abs(column + 0.5 - queryColumn) < 3 && std::abs(row + 0.5 - queryRow) < 3)
+                continue;
+
+            float distance = 0;
+
+            for (int d = 0; d < numDescriptors; ++d)
+            {
+                auto difference = getNormalisedValue(fractal, row, column, d) - normalisedTarget[(size_t)d];
+                distance += difference * difference;
+            }
+
+            //Keep the best ones sorted
+            if (matches.size() == maxResults && distance >= matches.getLast().distance)
+                continue;
+
+            int position = matches.size();
+            while (position > 0 && matches.getReference(position - 1).distance > distance)
+                --position;
+
+            matches.insert(position, { getCoordinate(column), getCoordinate(row), distance });
+
+            if (matches.size() > maxResults)
+                matches.removeLast();
+        }
+    }
+
+    for (auto& match : matches)
+        match.distance = std::sqrt(match.distance);
+
+    return matches;
+}
+
+size_t TimbreMap::getMappedSize() const
+{
+    const juce::ScopedLock sl(lock);
+    return mappedIndex != nullptr ? mappedIndex->getSize() : 0;
+}
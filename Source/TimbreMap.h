@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    TimbreMap.h
+    Created: 22 Oct 2026 9:48:16am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+class SharedResources;
+
+//Map of the timbres over the seed plane of each fractal, to find good points without trial and error.
+//An offline job sweeps a grid of seed points on all the cores: for every point a short note is rendered with the
+//same mapping as the synth, then a few descriptors are computed. The result is a small index file that is
+//memory mapped, so the heatmaps and the nearest timbre queries don't compute anything.
+//Not meant for the audio thread (the index is guarded by a lock).
+class TimbreMap : public juce::ChangeBroadcaster, private juce::Thread
+{
+public:
+
+    enum Descriptor
+    {
+        brightness, //spectral centroid of the note, in octaves above its fundamental
+        inharmonicity, //mean distance of the partials from the harmonic series (0 harmonic, 0.5 worst)
+        tremoloRate, //mean LFO rate, in Hz
+        numDescriptors
+    };
+
+    using Descriptors = std::array<float, numDescriptors>;
+
+    //Seed points per side, over -1..1 like the INITIAL_POINT parameters
+    static constexpr int gridSize = 128;
+    static constexpr int numFractals = 3;
+
+    struct Match
+    {
+        double x;
+        double y;
+        float distance; //in normalised descriptor units
+    };
+
+    explicit TimbreMap(SharedResources& sharedResources);
+    ~TimbreMap() override;
+
+    //Maps the index built in a previous session, if there is one
+    void load();
+
+    //Starts the sweep in the background, a change message is sent when the new index is mapped
+    void build();
+
+    bool isBuilding() const { return isThreadRunning(); }
+    bool isLoaded() const;
+
+    //0..1 while building
+    float getBuildProgress() const noexcept { return (float)completedPoints.load() / (float)(numFractals * gridSize * gridSize); }
+
+    //One translucent pixel per grid point (top row: y = 1), blue for low values up to red. Invalid if not loaded.
+    juce::Image createHeatmap(int fractal, int descriptor) const;
+
+    //Renders and analyses one seed point (takes a few milliseconds)
+    Descriptors analysePoint(int fractal, double x, double y) const;
+
+    //Grid points that sound like the given seed point, closest first (the neighbourhood of the point is skipped).
+    //A brute force search over the mapped index.
+    juce::Array<Match> findSimilar(int fractal, double x, double y, int maxResults) const;
+
+    size_t getMappedSize() const;
+
+    static juce::File getDefaultFile();
+
+    //Grid point to seed coordinate
+    static double getCoordinate(int index) noexcept { return -1.0 + (index + 0.5) * 2.0 / gridSize; }
+
+private:
+
+    void run() override;
+
+    //Descriptors of a grid point normalised to 0..1, from the mapped index (lock held)
+    float getNormalisedValue(int fractal, int row, int column, int descriptor) const noexcept;
+
+    bool mapIndex(const juce::File& file);
+
+    SharedResources& sharedResources;
+
+    juce::File indexFile;
+
+    std::atomic<int> completedPoints{ 0 };
+
+    mutable juce::CriticalSection lock;
+    std::unique_ptr<juce::MemoryMappedFile> mappedIndex;
+    const juce::uint16* values = nullptr;
+    Descriptors minimum{};
+    Descriptors maximum{};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TimbreMap)
+};
@@ -0,0 +1,242 @@
+/*
+  ==============================================================================
+
+    TruePeakLimiter.cpp
+    Created: 25 Oct 2026 9:42:35am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "TruePeakLimiter.h"
+
+void TruePeakLimiter::prepare(double newSampleRate, int samplesPerBlock, int newNumChannels)
+{
+    sampleRate = newSampleRate;
+    numChannels = juce::jlimit(0, maxChannels, newNumChannels);
+    lookahead = juce::jmax(1, juce::roundToInt(lookaheadSeconds * sampleRate));
+
+    //Windowed sinc (Blackman) for the value at fraction p / 4 after the sample of tap filterDelay - 1,
+    //normalised to unity gain at DC
+    for (int p = 0; p < oversampling; ++p)
+    {
+        double values[numTaps];
+        double sum = 0;
+
+        for (int k = 0; k < numTaps; ++k)
+        {
+            auto distance = (double)(filterDelay - 1 - k) + (double)p / oversampling;
+            auto x = juce::MathConstants<double>::pi * distance;
+            auto sinc = distance == 0 ? 1.0 : std::sin(x) / x;
+
+            auto w = distance / filterDelay;
+            auto window = 0.42 + 0.5 * std::cos(juce::MathConstants<double>::pi * w) + 0.08 * std::cos(juce::MathConstants<double>::twoPi * w);
+
+            values[k] = sinc * window;
+            sum += values[k];
+        }
+
+        for (int k = 0; k < numTaps; ++k)
+            coefficients[(size_t)(k * oversampling + p)] = (float)(values[k] / sum);
+    }
+
+    for (int channel = 0; channel < maxChannels; ++channel)
+    {
+        history[(size_t)channel].assign(channel < numChannels ? (size_t)(2 * numTaps) : 0, 0.0f);
+        delayLines[(size_t)channel].assign(channel < numChannels ? (size_t)getLatencySamples() : 0, 0.0f);
+    }
+
+    //The queue never holds more than one gain per sample of the window
+    minimumGains.assign((size_t)lookahead, 1.0f);
+    minimumIndexes.assign((size_t)lookahead, 0);
+    heldGains.assign((size_t)lookahead, 1.0f);
+    gains.assign((size_t)juce::jmax(1, samplesPerBlock), 1.0f);
+
+    reset();
+}
+
+void TruePeakLimiter::reset() noexcept
+{
+    for (auto& channelHistory : history)
+        std::fill(channelHistory.begin(), channelHistory.end(), 0.0f);
+
+    for (auto& line : delayLines)
+        std::fill(line.begin(), line.end(), 0.0f);
+
+    historyPosition = 0;
+    delayPosition = 0;
+
+    releasedGain = 1.0f;
+    previousPeak = 0.0f;
+    minimumFront = 0;
+    minimumSize = 0;
+    sampleIndex = 0;
+
+    std::fill(heldGains.begin(), heldGains.end(), 1.0f);
+    heldPosition = 0;
+    heldSum = lookahead;
+}
+
+void TruePeakLimiter::setParameters(float newCeiling, float releaseSeconds) noexcept
+{
+    ceiling = newCeiling;
+    releaseCoefficient = (float)(1.0 - std::exp(-1.0 / (juce::jmax(0.001f, releaseSeconds) * sampleRate)));
+}
+
+float TruePeakLimiter::getTruePeak(int channel, float sample) noexcept
+{
+    auto* samples = history[(size_t)channel].data();
+
+    samples[historyPosition] = sample;
+    samples[historyPosition + numTaps] = sample;
+
+    //The oldest of the last numTaps inputs is just after the one written
+    const auto* taps = samples + historyPosition + 1;
+    alignas(16) float phases[oversampling] = {};
+
+    for (int k = 0; k < numTaps; ++k)
+    {
+        const auto* tapCoefficients = coefficients.data() + k * oversampling;
+
+        for (int p = 0; p < oversampling; ++p)
+            phases[p] += taps[k] * tapCoefficients[p];
+    }
+
+    return juce::jmax(juce::jmax(std::abs(phases[0]), std::abs(phases[1])), juce::jmax(std::abs(phases[2]), std::abs(phases[3])));
+}
+
+float TruePeakLimiter::getSmoothedGain(float peak) noexcept
+{
+    //An output sample is an end of the interpolated intervals before and after it
+    auto intervalPeak = juce::jmax(peak, previousPeak);
+    previousPeak = peak;
+
+    auto target = intervalPeak > ceiling ? ceiling / intervalPeak : 1.0f;
+
+    //Instant attack (the lookahead smooths it), one pole release
+    releasedGain = target < releasedGain ? target : releasedGain + releaseCoefficient * (target - releasedGain);
+
+    //Sliding minimum over the last lookahead gains: each gain enters and leaves the queue once.
+    //The expired front goes first, so the queue has room for the new gain
+    auto capacity = (int)minimumGains.size();
+
+    if (minimumSize > 0 && minimumIndexes[(size_t)minimumFront] <= sampleIndex - lookahead)
+    {
+        minimumFront = (minimumFront + 1) % capacity;
+        --minimumSize;
+    }
+
+    while (minimumSize > 0 && minimumGains[(size_t)((minimumFront + minimumSize - 1) % capacity)] >= releasedGain)
+        --minimumSize;
+
+    auto back = (minimumFront + minimumSize) % capacity;
+    minimumGains[(size_t)back] = releasedGain;
+    minimumIndexes[(size_t)back] = sampleIndex;
+    ++minimumSize;
+
+    ++sampleIndex;
+
+    auto held = minimumGains[(size_t)minimumFront];
+
+    //Moving average over the lookahead: a ramp that reaches the held gain when its peak comes out
+    heldSum += held - heldGains[(size_t)heldPosition];
+    heldGains[(size_t)heldPosition] = held;
+    heldPosition = heldPosition + 1 == lookahead ? 0 : heldPosition + 1;
+
+    return (float)(heldSum / lookahead);
+}
+
+void TruePeakLimiter::process(juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    auto channels = juce::jmin(numChannels, buffer.getNumChannels());
+
+    if (channels == 0 || gains.empty())
+        return;
+
+    //Blocks bigger than announced are processed in pieces
+    for (int start = 0; start < numSamples; start += (int)gains.size())
+        processChunk(buffer, start, juce::jmin(numSamples - start, (int)gains.size()), channels);
+}
+
+void TruePeakLimiter::processChunk(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, int channels) noexcept
+{
+    auto latency = getLatencySamples();
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        float peak = 0.0f;
+
+        for (int channel = 0; channel < channels; ++channel)
+        {
+            auto* samples = buffer.getWritePointer(channel, startSample);
+            auto& line = delayLines[(size_t)channel];
+
+            peak = juce::jmax(peak, getTruePeak(channel, samples[n]));
+
+            //The output is the input of latency samples ago
+            auto delayed = line[(size_t)delayPosition];
+            line[(size_t)delayPosition] = samples[n];
+            samples[n] = delayed;
+        }
+
+        historyPosition = historyPosition + 1 == numTaps ? 0 : historyPosition + 1;
+        delayPosition = delayPosition + 1 == latency ? 0 : delayPosition + 1;
+
+        gains[(size_t)n] = getSmoothedGain(peak);
+    }
+
+    for (int channel = 0; channel < channels; ++channel)
+        juce::FloatVectorOperations::multiply(buffer.getWritePointer(channel, startSample), gains.data(), numSamples);
+}
+
+size_t TruePeakLimiter::getSizeInBytes() const
+{
+    size_t size = sizeof(*this);
+
+    for (int channel = 0; channel < maxChannels; ++channel)
+        size += (history[(size_t)channel].size() + delayLines[(size_t)channel].size()) * sizeof(float);
+
+    size += (minimumGains.size() + heldGains.size() + gains.size()) * sizeof(float) + minimumIndexes.size() * sizeof(juce::int64);
+
+    return size;
+}
+
+#if JUCE_UNIT_TESTS
+
+//Held gain against the minimum of the window computed the slow way, through a long rising release
+class TruePeakLimiterTest : public juce::UnitTest
+{
+public:
+    TruePeakLimiterTest() : juce::UnitTest("TruePeakLimiter", "FractalSynthesizer") {}
+
+    void runTest() override
+    {
+        beginTest("Sliding minimum");
+
+        TruePeakLimiter limiter;
+        limiter.prepare(48000, 512, 1);
+        limiter.setParameters(0.5f, 0.5f);
+
+        juce::Random random(1);
+        std::vector<float> releasedGains;
+
+        for (int n = 0; n < 20000; ++n)
+        {
+            //A few loud peaks, each followed by thousands of samples of release
+            auto peak = n % 5000 == 0 ? 4.0f : (n % 5000 > 2500 ? random.nextFloat() : 0.0f);
+
+            limiter.getSmoothedGain(peak);
+            releasedGains.push_back(limiter.releasedGain);
+
+            auto first = (size_t)juce::jmax(0, n + 1 - limiter.lookahead);
+            auto minimum = *std::min_element(releasedGains.begin() + (std::ptrdiff_t)first, releasedGains.end());
+
+            expect(limiter.minimumSize <= (int)limiter.minimumGains.size());
+            expectEquals(limiter.minimumGains[(size_t)limiter.minimumFront], minimum);
+        }
+    }
+};
+
+static TruePeakLimiterTest truePeakLimiterTest;
+
+#endif
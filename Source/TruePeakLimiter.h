@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    TruePeakLimiter.h
+    Created: 25 Oct 2026 9:42:17am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//Lookahead limiter on the true peaks (4 times oversampled) of the output, with a fixed latency
+class TruePeakLimiter
+{
+public:
+
+    static constexpr int oversampling = 4;
+    static constexpr int numTaps = 12; //per phase
+    static constexpr int maxChannels = 2;
+
+    //Not realtime safe
+    void prepare(double sampleRate, int samplesPerBlock, int numChannels);
+    void reset() noexcept;
+
+    //ceiling: linear true peak limit, release in seconds
+    void setParameters(float newCeiling, float releaseSeconds) noexcept;
+
+    void process(juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+
+    //Delay of the output, in samples
+    int getLatencySamples() const noexcept { return lookahead + filterDelay - 1; }
+
+    size_t getSizeInBytes() const;
+
+private:
+
+    static constexpr double lookaheadSeconds = 0.0015;
+
+    //The interpolated phases are centred between the middle taps
+    static constexpr int filterDelay = numTaps / 2;
+
+    float getTruePeak(int channel, float sample) noexcept;
+    float getSmoothedGain(float peak) noexcept;
+
+    //At most gains.size() samples
+    void processChunk(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, int channels) noexcept;
+
+    double sampleRate = 44100;
+    int numChannels = 0;
+    int lookahead = 0;
+
+    //Tap k of the 4 phases at k * oversampling. The phases are a plain 4 float loop that the compiler turns into one
+    //128 bit multiply-add (SSE or NEON): juce::dsp::SIMDRegister follows the widest native set, 8 floats with AVX
+    alignas(16) std::array<float, numTaps * oversampling> coefficients{};
+
+    //Last numTaps inputs of each channel, written twice so that they are always contiguous
+    std::array<std::vector<float>, maxChannels> history;
+    int historyPosition = 0;
+
+    //Input delayed by the latency
+    std::array<std::vector<float>, maxChannels> delayLines;
+    int delayPosition = 0;
+
+    float ceiling = 1.0f;
+    float releaseCoefficient = 0.0f;
+    float releasedGain = 1.0f;
+    float previousPeak = 0.0f;
+
+    //Minimum of the gains over the last lookahead samples: increasing queue of (gain, sample index)
+    std::vector<float> minimumGains;
+    std::vector<juce::int64> minimumIndexes;
+    int minimumFront = 0, minimumSize = 0;
+    juce::int64 sampleIndex = 0;
+
+    //Moving average of the held gain over the lookahead
+    std::vector<float> heldGains;
+    int heldPosition = 0;
+    double heldSum = 0;
+
+    std::vector<float> gains; //of the current block
+
+    friend class TruePeakLimiterTest;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TruePeakLimiter)
+};
@@ -0,0 +1,378 @@
+/*
+  ==============================================================================
+
+    WavetableLibrary.cpp
+    Created: 18 Oct 2026 10:12:47am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#include "WavetableLibrary.h"
+
+namespace
+{
+    //Header of the cache files, the band-limited frames follow it (64 bytes keep the float data aligned)
+    struct CacheHeader
+    {
+        char magic[4];
+        juce::int32 version;
+        juce::int32 frameSize;
+        juce::int32 numMipLevels;
+        juce::int32 numFrames;
+        juce::int32 reserved;
+        juce::int64 sourceModificationTime;
+        juce::int64 sourceSize;
+        char padding[24];
+    };
+
+    static_assert(sizeof(CacheHeader) == 64, "The cache header must keep the frames aligned");
+
+    static constexpr juce::int32 cacheVersion = 1;
+
+    static constexpr int fftOrder = 11;
+
+    static_assert((1 << fftOrder) == Wavetable::frameSize, "fftOrder must match the frame size");
+
+    //Longer files are truncated
+    static constexpr int maxFramesPerTable = 256;
+
+    //Files shorter than this (and not a multiple of the frame size) are treated as a single cycle
+    static constexpr int maxSingleCycleLength = 8192;
+}
+
+//==============================================================================
+Wavetable::Wavetable(const juce::String& name, std::unique_ptr<juce::MemoryMappedFile> mappedCache, const float* data, int numFrames)
+    : name(name), mappedFile(std::move(mappedCache)), data(data), numFrames(numFrames)
+{
+}
+
+int Wavetable::getMipLevelForFrequency(double frequency, double sampleRate) noexcept
+{
+    auto maxHarmonics = sampleRate * 0.5 / juce::jmax(frequency, 1.0);
+
+    int level = 0;
+
+    while (level < numMipLevels - 1 && (double)((frameSize / 2) >> level) > maxHarmonics)
+        ++level;
+
+    return level;
+}
+
+size_t Wavetable::getMappedSize() const noexcept
+{
+    return mappedFile != nullptr ? mappedFile->getSize() : 0;
+}
+
+//==============================================================================
+WavetableLibrary::WavetableLibrary() : juce::Thread("Wavetable loader")
+{
+    for (auto& slot : slots)
+        slot.store(nullptr);
+
+    formatManager.registerBasicFormats();
+
+    directory = getDefaultDirectory();
+    cacheDirectory = getDefaultCacheDirectory();
+}
+
+WavetableLibrary::~WavetableLibrary()
+{
+    stopThread(4000);
+}
+
+juce::File WavetableLibrary::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("DelayLama").getChildFile("Fractasizer").getChildFile("Wavetables");
+}
+
+juce::File WavetableLibrary::getDefaultCacheDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("DelayLama").getChildFile("Fractasizer").getChildFile("WavetableCache");
+}
+
+void WavetableLibrary::setDirectory(const juce::File& newDirectory)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        directory = newDirectory;
+    }
+
+    rescan();
+}
+
+void WavetableLibrary::rescan()
+{
+    if (isThreadRunning())
+        notify();
+    else
+        startThread(2); //low priority, the tables are never needed in a hurry
+}
+
+const Wavetable* WavetableLibrary::getTable(int index) const noexcept
+{
+    if (index < 0 || index >= maxTables)
+        return nullptr;
+
+    return slots[(size_t)index].load(std::memory_order_acquire);
+}
+
+juce::StringArray WavetableLibrary::getTableNames() const
+{
+    const juce::ScopedLock sl(lock);
+
+    juce::StringArray names;
+
+    for (auto& path : knownFiles)
+        names.add(juce::File(path).getFileNameWithoutExtension());
+
+    return names;
+}
+
+size_t WavetableLibrary::getMappedSize() const
+{
+    const juce::ScopedLock sl(lock);
+
+    size_t total = 0;
+
+    for (auto* table : ownedTables)
+        total += table->getMappedSize();
+
+    return total;
+}
+
+void WavetableLibrary::run()
+{
+    while (!threadShouldExit())
+    {
+        juce::File currentDirectory;
+        {
+            const juce::ScopedLock sl(lock);
+            currentDirectory = directory;
+        }
+
+        cacheDirectory.createDirectory();
+
+        auto files = currentDirectory.findChildFiles(juce::File::findFiles, false, "*.wav;*.aif;*.aiff");
+        files.sort();
+
+        //Reserve the slots in file order first, so that the WAVETABLE parameters always address the same files
+        juce::Array<int> pendingSlots;
+        {
+            const juce::ScopedLock sl(lock);
+
+            for (auto& file : files)
+            {
+                if (knownFiles.contains(file.getFullPathName()) || knownFiles.size() >= maxTables)
+                    continue;
+
+                pendingSlots.add(knownFiles.size());
+                knownFiles.add(file.getFullPathName());
+            }
+
+            numTables.store(knownFiles.size(), std::memory_order_release);
+        }
+
+        //First pass only maps the tables that are already cached (instant), the second one builds the missing caches
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (auto slot : pendingSlots)
+            {
+                if (threadShouldExit())
+                    return;
+
+                if (getTable(slot) != nullptr)
+                    continue;
+
+                juce::File source;
+                {
+                    const juce::ScopedLock sl(lock);
+                    source = juce::File(knownFiles[slot]);
+                }
+
+                auto cacheFile = cacheDirectory.getChildFile(source.getFileNameWithoutExtension() + "_"
+                    + juce::String::toHexString(source.getFullPathName().hashCode64()) + ".fwt");
+
+                auto table = mapCache(source, cacheFile);
+
+                if (table == nullptr && pass == 1 && buildCache(source, cacheFile))
+                    table = mapCache(source, cacheFile);
+
+                if (table != nullptr)
+                {
+                    const juce::ScopedLock sl(lock);
+                    ownedTables.add(table);
+                    slots[(size_t)slot].store(table.get(), std::memory_order_release);
+                }
+            }
+        }
+
+        wait(-1);
+    }
+}
+
+Wavetable::Ptr WavetableLibrary::mapCache(const juce::File& source, const juce::File& cacheFile)
+{
+    if (!cacheFile.existsAsFile())
+        return nullptr;
+
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(cacheFile, juce::MemoryMappedFile::readOnly);
+
+    if (mapped->getData() == nullptr || mapped->getSize() < sizeof(CacheHeader))
+        return nullptr;
+
+    CacheHeader header;
+    std::memcpy(&header, mapped->getData(), sizeof(CacheHeader));
+
+    //Reject caches of another format or of an older version of the source file
+    if (std::memcmp(header.magic, "FWT1", 4) != 0
+        || header.version != cacheVersion
+        || header.frameSize != Wavetable::frameSize
+        || header.numMipLevels != Wavetable::numMipLevels
+        || header.numFrames <= 0
+        || header.sourceModificationTime != source.getLastModificationTime().toMilliseconds()
+        || header.sourceSize != source.getSize())
+        return nullptr;
+
+    auto expectedSize = sizeof(CacheHeader)
+        + (size_t)header.numMipLevels * (size_t)header.numFrames * Wavetable::frameSize * sizeof(float);
+
+    if (mapped->getSize() < expectedSize)
+        return nullptr;
+
+    auto* data = static_cast<const float*>(juce::addBytesToPointer(mapped->getData(), sizeof(CacheHeader)));
+
+    return new Wavetable(source.getFileNameWithoutExtension(), std::move(mapped), data, header.numFrames);
+}
+
+bool WavetableLibrary::buildCache(const juce::File& source, const juce::File& cacheFile)
+{
+    //Memory map the source too when the format allows it
+    std::unique_ptr<juce::AudioFormatReader> reader;
+
+    if (source.hasFileExtension("wav"))
+    {
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader(wavFormat.createMemoryMappedReader(source));
+
+        if (mappedReader != nullptr && mappedReader->mapEntireFile())
+            reader = std::move(mappedReader);
+    }
+
+    if (reader == nullptr)
+        reader.reset(formatManager.createReaderFor(source));
+
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+        return false;
+
+    auto length = (int)juce::jmin(reader->lengthInSamples, (juce::int64)Wavetable::frameSize * maxFramesPerTable);
+
+    juce::AudioBuffer<float> sourceBuffer(1, length);
+    reader->read(&sourceBuffer, 0, length, 0, true, false);
+
+    auto* sourceData = sourceBuffer.getReadPointer(0);
+
+    //Split in frames: files made of whole frames are multi frame tables,
+    //short files are a single cycle that is resampled (linearly) to the frame size
+    int numFrames;
+    std::vector<float> frames;
+
+    if (length % Wavetable::frameSize == 0 || length > maxSingleCycleLength)
+    {
+        numFrames = length / Wavetable::frameSize;
+        frames.assign(sourceData, sourceData + (size_t)numFrames * Wavetable::frameSize);
+    }
+    else
+    {
+        numFrames = 1;
+        frames.resize(Wavetable::frameSize);
+
+        for (int i = 0; i < Wavetable::frameSize; ++i)
+        {
+            auto position = (double)i * length / Wavetable::frameSize;
+            auto index = (int)position;
+            auto frac = (float)(position - index);
+            auto next = (index + 1) % length;
+            frames[(size_t)i] = sourceData[index] + frac * (sourceData[next] - sourceData[index]);
+        }
+    }
+
+    if (numFrames <= 0)
+        return false;
+
+    //Band limit every frame by zeroing the harmonics above the limit of each mip level
+    std::vector<float> mips((size_t)Wavetable::numMipLevels * (size_t)numFrames * Wavetable::frameSize);
+
+    juce::dsp::FFT fft(fftOrder);
+    std::vector<float> spectrum(2 * Wavetable::frameSize);
+    std::vector<float> work(2 * Wavetable::frameSize);
+
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        if (threadShouldExit())
+            return false;
+
+        std::fill(spectrum.begin(), spectrum.end(), 0.0f);
+        std::copy_n(frames.begin() + (size_t)frame * Wavetable::frameSize, Wavetable::frameSize, spectrum.begin());
+
+        fft.performRealOnlyForwardTransform(spectrum.data());
+
+        //Remove DC
+        spectrum[0] = 0.0f;
+        spectrum[1] = 0.0f;
+
+        for (int level = 0; level < Wavetable::numMipLevels; ++level)
+        {
+            auto harmonics = (Wavetable::frameSize / 2) >> level;
+
+            work = spectrum;
+
+            for (int bin = harmonics + 1; bin < Wavetable::frameSize - harmonics; ++bin)
+            {
+                work[(size_t)(2 * bin)] = 0.0f;
+                work[(size_t)(2 * bin + 1)] = 0.0f;
+            }
+
+            fft.performRealOnlyInverseTransform(work.data());
+
+            std::copy_n(work.begin(), Wavetable::frameSize,
+                mips.begin() + ((size_t)level * (size_t)numFrames + (size_t)frame) * Wavetable::frameSize);
+        }
+    }
+
+    //Normalise on the full bandwidth level
+    auto range = juce::FloatVectorOperations::findMinAndMax(mips.data(), numFrames * Wavetable::frameSize);
+    auto peak = juce::jmax(std::abs(range.getStart()), std::abs(range.getEnd()));
+
+    if (peak > 0.0f)
+        juce::FloatVectorOperations::multiply(mips.data(), 1.0f / peak, (int)mips.size());
+
+    CacheHeader header{};
+    std::memcpy(header.magic, "FWT1", 4);
+    header.version = cacheVersion;
+    header.frameSize = Wavetable::frameSize;
+    header.numMipLevels = Wavetable::numMipLevels;
+    header.numFrames = numFrames;
+    header.sourceModificationTime = source.getLastModificationTime().toMilliseconds();
+    header.sourceSize = source.getSize();
+
+    //Write to a temporary file first, so that a half written cache is never mapped
+    juce::TemporaryFile temp(cacheFile);
+    {
+        juce::FileOutputStream out(temp.getFile());
+
+        if (!out.openedOk())
+            return false;
+
+        out.write(&header, sizeof(CacheHeader));
+        out.write(mips.data(), mips.size() * sizeof(float));
+        out.flush();
+
+        if (out.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
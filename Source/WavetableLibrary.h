@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    WavetableLibrary.h
+    Created: 18 Oct 2026 10:12:31am
+    Author:  Ricky
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+//A single or multi frame wavetable whose band-limited mip levels live in a memory mapped cache file.
+//The sample data is never copied: getFrame returns pointers straight into the mapped file.
+class Wavetable : public juce::ReferenceCountedObject
+{
+public:
+
+    using Ptr = juce::ReferenceCountedObjectPtr<Wavetable>;
+
+    //Number of samples of a single cycle (every mip level keeps the same length)
+    static constexpr int frameSize = 2048;
+
+    //Level 0 keeps frameSize / 2 harmonics, every following level halves them (down to a pure sine)
+    static constexpr int numMipLevels = 11;
+
+    Wavetable(const juce::String& name, std::unique_ptr<juce::MemoryMappedFile> mappedCache, const float* data, int numFrames);
+
+    const juce::String& getName() const noexcept { return name; }
+
+    int getNumFrames() const noexcept { return numFrames; }
+
+    //Returns the first sample of the given frame for the given mip level
+    const float* getFrame(int mipLevel, int frame) const noexcept
+    {
+        return data + ((size_t)mipLevel * (size_t)numFrames + (size_t)frame) * frameSize;
+    }
+
+    //Returns the first mip level whose highest harmonic stays below nyquist when played at the given frequency
+    static int getMipLevelForFrequency(double frequency, double sampleRate) noexcept;
+
+    //Size of the mapped data, used by the memory report
+    size_t getMappedSize() const noexcept;
+
+private:
+
+    juce::String name;
+
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+
+    const float* data;
+
+    int numFrames;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Wavetable)
+};
+
+
+//Scans a folder of wav files and turns each of them into a Wavetable.
+//Mip levels are computed on a background thread and cached on disk, so that the next time the library
+//is loaded the tables are only memory mapped.
+//Tables are never removed once published, so the audio thread can keep raw pointers to them
+//and switching table is just a pointer swap.
+class WavetableLibrary : private juce::Thread
+{
+public:
+
+    //Max number of tables that can be addressed by the WAVETABLE parameters
+    static constexpr int maxTables = 128;
+
+    WavetableLibrary();
+    ~WavetableLibrary() override;
+
+    //Sets the folder to scan and starts (or restarts) the background scan
+    void setDirectory(const juce::File& newDirectory);
+
+    //Scans the current folder again, new files are appended after the existing ones
+    void rescan();
+
+    //Lock free, safe to call from the audio thread. Returns nullptr if the slot is not loaded (yet)
+    const Wavetable* getTable(int index) const noexcept;
+
+    int getNumTables() const noexcept { return numTables.load(std::memory_order_acquire); }
+
+    juce::StringArray getTableNames() const;
+
+    //Total bytes of mapped table data
+    size_t getMappedSize() const;
+
+    static juce::File getDefaultDirectory();
+
+    static juce::File getDefaultCacheDirectory();
+
+private:
+
+    void run() override;
+
+    Wavetable::Ptr mapCache(const juce::File& source, const juce::File& cacheFile);
+
+    bool buildCache(const juce::File& source, const juce::File& cacheFile);
+
+    juce::File directory;
+    juce::File cacheDirectory;
+
+    juce::CriticalSection lock;
+
+    juce::StringArray knownFiles; //source paths, in slot order
+
+    juce::ReferenceCountedArray<Wavetable> ownedTables;
+
+    std::array<std::atomic<Wavetable*>, maxTables> slots;
+
+    std::atomic<int> numTables{ 0 };
+
+    juce::AudioFormatManager formatManager;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WavetableLibrary)
+};